@@ -0,0 +1,70 @@
+//=============================================================================
+// FILE:
+//      counter_threads.c
+//
+// DESCRIPTION:
+//      Benchmark input for the counter modes of DynamicCallCounter. Every
+//      thread calls three small functions in a tight loop, so that their
+//      counters are as hot (and as contended) as counters get. The program
+//      prints the time the threads took and how often each function was
+//      called to stderr; run_counter_bench.sh compares both with what the
+//      instrumented program counted.
+//
+// USAGE:
+//      counter_threads [<threads> [<calls per thread>]]
+//
+// License: MIT
+//=============================================================================
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+#define NOINLINE __attribute__((noinline))
+
+static long CallsPerThread = 4000000;
+
+NOINLINE long hot_a(long X) { return X * 3 + 1; }
+NOINLINE long hot_b(long X) { return X ^ (X >> 7); }
+NOINLINE long hot_c(long X) { return X + 11; }
+
+static void *run(void *Arg) {
+  long Acc = (long)Arg;
+  for (long I = 0; I < CallsPerThread; I++) {
+    Acc = hot_a(Acc);
+    Acc = hot_b(Acc);
+    if (I % 4 == 0)
+      Acc = hot_c(Acc);
+  }
+  return (void *)Acc;
+}
+
+int main(int Argc, char **Argv) {
+  int NumThreads = (Argc > 1) ? atoi(Argv[1]) : 32;
+  if (Argc > 2)
+    CallsPerThread = atol(Argv[2]);
+
+  pthread_t *Threads = malloc(NumThreads * sizeof(pthread_t));
+  struct timespec Start, End;
+  clock_gettime(CLOCK_MONOTONIC, &Start);
+  for (long T = 0; T < NumThreads; T++)
+    pthread_create(&Threads[T], NULL, run, (void *)T);
+  long Checksum = 0;
+  for (int T = 0; T < NumThreads; T++) {
+    void *Result;
+    pthread_join(Threads[T], &Result);
+    Checksum += (long)Result;
+  }
+  clock_gettime(CLOCK_MONOTONIC, &End);
+  free(Threads);
+
+  long Calls = (long)NumThreads * CallsPerThread;
+  fprintf(stderr, "time %.6f\n",
+          (End.tv_sec - Start.tv_sec) + (End.tv_nsec - Start.tv_nsec) / 1e9);
+  fprintf(stderr, "expected hot_a %ld\n", Calls);
+  fprintf(stderr, "expected hot_b %ld\n", Calls);
+  fprintf(stderr, "expected hot_c %ld\n", (long)NumThreads *
+                                              ((CallsPerThread + 3) / 4));
+  fprintf(stderr, "checksum %ld\n", Checksum);
+  return 0;
+}
@@ -0,0 +1,74 @@
+#!/bin/sh
+#==============================================================================
+# FILE:
+#    run_counter_bench.sh
+#
+# DESCRIPTION:
+#    Compares the counter modes of DynamicCallCounter (plain, atomic and
+#    sharded) on counter_threads.c: the run time relative to the program
+#    without instrumentation, and the calls counted relative to the calls
+#    made. Every variant is run REPEAT times and the fastest run is reported.
+#
+# USAGE:
+#    LLVM_DIR=<llvm install> BUILD_DIR=<llvm-tutor build> \
+#      ./run_counter_bench.sh [<threads> [<calls per thread>]]
+#
+# License: MIT
+#==============================================================================
+set -e
+
+THREADS=${1:-32}
+CALLS=${2:-4000000}
+REPEAT=${REPEAT:-3}
+LLVM_DIR=${LLVM_DIR:?set LLVM_DIR to the LLVM installation}
+BUILD_DIR=${BUILD_DIR:?set BUILD_DIR to the llvm-tutor build directory}
+SRC_DIR=$(cd "$(dirname "$0")" && pwd)
+WORK=$(mktemp -d)
+trap 'rm -rf "$WORK"' EXIT
+
+# The same unoptimized bitcode for every variant, optimized after
+# instrumentation
+"$LLVM_DIR/bin/clang" -O2 -Xclang -disable-llvm-passes -emit-llvm -c \
+  "$SRC_DIR/counter_threads.c" -o "$WORK/base.bc"
+
+build() {
+  "$LLVM_DIR/bin/clang" -O2 "$1" -o "$2" -lpthread
+}
+
+# Prints the fastest of REPEAT runs of $1; the output of the fastest run is
+# left in $1.out and $1.err
+run() {
+  BEST=
+  for I in $(seq "$REPEAT"); do
+    "$1" "$THREADS" "$CALLS" > "$1.out.$I" 2> "$1.err.$I"
+    TIME=$(awk '$1 == "time" { print $2 }' "$1.err.$I")
+    if [ -z "$BEST" ] || awk "BEGIN { exit !($TIME < $BEST) }"; then
+      BEST=$TIME
+      cp "$1.out.$I" "$1.out"
+      cp "$1.err.$I" "$1.err"
+    fi
+  done
+  echo "$BEST"
+}
+
+build "$WORK/base.bc" "$WORK/none"
+BASE=$(run "$WORK/none")
+
+printf "%d threads, %d calls per thread\n\n" "$THREADS" "$CALLS"
+printf "%-8s %10s %10s %12s\n" MODE TIME OVERHEAD ACCURACY
+printf "%-8s %10.3f %10s %12s\n" none "$BASE" - -
+for MODE in plain atomic sharded; do
+  "$LLVM_DIR/bin/opt" -load "$BUILD_DIR/lib/libDynamicCallCounter.so" \
+    -legacy-dynamic-cc -fast-counter-mode=$MODE "$WORK/base.bc" \
+    -o "$WORK/$MODE.bc"
+  build "$WORK/$MODE.bc" "$WORK/$MODE"
+  TIME=$(run "$WORK/$MODE")
+
+  # The accuracy of the worst counter: counted / expected
+  ACCURACY=$(awk '
+    FNR == NR { if ($1 == "expected") Expected[$2] = $3; next }
+    ($1 in Expected) { Ratio = $2 / Expected[$1]; if (Min == "" || Ratio < Min) Min = Ratio }
+    END { printf "%.4f", Min }' "$WORK/$MODE.err" "$WORK/$MODE.out")
+  printf "%-8s %10.3f %9.2fx %12s\n" "$MODE" "$TIME" \
+    "$(awk "BEGIN { print $TIME / $BASE }")" "$ACCURACY"
+done
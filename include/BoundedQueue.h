@@ -0,0 +1,100 @@
+//==============================================================================
+// FILE:
+//    BoundedQueue.h
+//
+// DESCRIPTION:
+//    A bounded multi-producer multi-consumer lock-free queue (D. Vyukov's
+//    array-based design). Every slot carries a sequence number that tells
+//    producers and consumers whether it is free or full for the current lap,
+//    so push and pop only need one compare-and-swap on the shared position
+//    and never take a lock. Neither operation blocks: push fails when the
+//    queue is full and pop fails when it is empty, and the caller decides
+//    whether to retry, back off or do something else.
+//
+// License: MIT
+//==============================================================================
+#ifndef LLVM_TUTOR_BOUNDED_QUEUE_H
+#define LLVM_TUTOR_BOUNDED_QUEUE_H
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <utility>
+
+template <typename T> class BoundedQueue {
+public:
+  // Capacity is rounded up to a power of two
+  explicit BoundedQueue(size_t Capacity) {
+    size_t Size = 2;
+    while (Size < Capacity)
+      Size *= 2;
+    Mask = Size - 1;
+    Slots.reset(new Slot[Size]);
+    for (size_t Idx = 0; Idx < Size; Idx++)
+      Slots[Idx].Sequence.store(Idx, std::memory_order_relaxed);
+  }
+
+  BoundedQueue(const BoundedQueue &) = delete;
+  BoundedQueue &operator=(const BoundedQueue &) = delete;
+
+  // Moves Value into the queue. Returns false (and leaves Value alone) if
+  // the queue is full.
+  bool push(T &Value) {
+    size_t Pos = Tail.load(std::memory_order_relaxed);
+    for (;;) {
+      Slot &S = Slots[Pos & Mask];
+      size_t Seq = S.Sequence.load(std::memory_order_acquire);
+      intptr_t Diff = intptr_t(Seq) - intptr_t(Pos);
+      if (Diff == 0) {
+        if (Tail.compare_exchange_weak(Pos, Pos + 1,
+                                       std::memory_order_relaxed)) {
+          S.Value = std::move(Value);
+          S.Sequence.store(Pos + 1, std::memory_order_release);
+          return true;
+        }
+      } else if (Diff < 0) {
+        return false;
+      } else {
+        Pos = Tail.load(std::memory_order_relaxed);
+      }
+    }
+  }
+
+  // Moves the oldest element into Value. Returns false if the queue is
+  // empty.
+  bool pop(T &Value) {
+    size_t Pos = Head.load(std::memory_order_relaxed);
+    for (;;) {
+      Slot &S = Slots[Pos & Mask];
+      size_t Seq = S.Sequence.load(std::memory_order_acquire);
+      intptr_t Diff = intptr_t(Seq) - intptr_t(Pos + 1);
+      if (Diff == 0) {
+        if (Head.compare_exchange_weak(Pos, Pos + 1,
+                                       std::memory_order_relaxed)) {
+          Value = std::move(S.Value);
+          S.Sequence.store(Pos + Mask + 1, std::memory_order_release);
+          return true;
+        }
+      } else if (Diff < 0) {
+        return false;
+      } else {
+        Pos = Head.load(std::memory_order_relaxed);
+      }
+    }
+  }
+
+private:
+  struct Slot {
+    std::atomic<size_t> Sequence;
+    T Value;
+  };
+
+  std::unique_ptr<Slot[]> Slots;
+  size_t Mask;
+  // Producers and consumers update different cache lines
+  alignas(64) std::atomic<size_t> Tail{0};
+  alignas(64) std::atomic<size_t> Head{0};
+};
+
+#endif
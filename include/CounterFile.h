@@ -0,0 +1,46 @@
+//==============================================================================
+// FILE:
+//    CounterFile.h
+//
+// DESCRIPTION:
+//    The layout of the counter files of DynamicCallCounter. With
+//    `-fast-counter-file=<path>`, an instrumented program maps such a file
+//    (MAP_SHARED) when it starts and increments its call counters in place,
+//    so the counts can be read while the program runs and are still there
+//    if it is killed. A path in /dev/shm makes it a POSIX shared memory
+//    segment. The environment variable FAST_CC_FILE overrides the path at
+//    run time.
+//
+//    All fields are in the byte order of the instrumented program:
+//    ```
+//      char     Magic[8]         "FASTCC\0\0"
+//      uint32_t Version          1
+//      uint32_t NumRows          R
+//      uint64_t NumCounters      N, one counter per instrumented function
+//      uint64_t RowSize          S >= N
+//      uint64_t NamesOffset      the offset of Names in the file
+//      uint64_t NamesSize
+//      (zero padding up to CounterFileHeaderSize)
+//      uint64_t Counters[R][S]   at CounterFileHeaderSize
+//      char     Names[NamesSize] N NUL-terminated function names, in the
+//                                order of the counters
+//    ```
+//    The calls of function F are the sum of Counters[0 .. R-1][F]; there is
+//    more than one row in sharded mode only.
+//
+// License: MIT
+//==============================================================================
+#ifndef LLVM_TUTOR_COUNTER_FILE_H
+#define LLVM_TUTOR_COUNTER_FILE_H
+
+#include <cstdint>
+
+constexpr char CounterFileMagic[8] = {'F', 'A', 'S', 'T', 'C', 'C', 0, 0};
+constexpr uint32_t CounterFileVersion = 1;
+// The counters start on a cache line of their own
+constexpr uint64_t CounterFileHeaderSize = 64;
+
+// The environment variable that overrides the path of the counter file
+constexpr const char *CounterFileEnvVar = "FAST_CC_FILE";
+
+#endif
@@ -0,0 +1,55 @@
+//==============================================================================
+// FILE:
+//    CoverageProfile.h
+//
+// DESCRIPTION:
+//    Declares CoverageProfile, the execution counts of a test run, used to
+//    skip (or down-weight) mutation points that the tests never reach.
+//    Mutants of such points survive by construction, so building and
+//    testing them is wasted work.
+//
+//    A profile is a text file with one count per line, either per function
+//    or per basic block:
+//    ```
+//      <function> <count>
+//      <function> <bbID> <count>
+//    ```
+//    where <bbID> numbers the blocks of the function as in mutation points.
+//    The per-function form is what DynamicCallCounter prints, so its output
+//    can be used as is (the header lines are skipped). A function without
+//    block counts is executed in all of its blocks if it was called at all;
+//    functions missing from the profile were never executed.
+//
+// License: MIT
+//==============================================================================
+#ifndef LLVM_TUTOR_COVERAGE_PROFILE_H
+#define LLVM_TUTOR_COVERAGE_PROFILE_H
+
+#include "llvm/ADT/StringMap.h"
+#include "llvm/ADT/StringRef.h"
+
+#include <cstdint>
+#include <vector>
+
+class CoverageProfile {
+public:
+  // Loads (and adds to the current counts) the profile at Path. Returns
+  // false and prints a diagnostic if it cannot be read.
+  bool load(llvm::StringRef Path);
+
+  // Whether block BBID of function Func was executed
+  bool isExecuted(llvm::StringRef Func, unsigned BBID) const;
+
+  bool empty() const { return Functions.empty(); }
+
+private:
+  struct FunctionCounts {
+    uint64_t Calls = 0;
+    // Empty for per-function profiles
+    std::vector<uint64_t> Blocks;
+  };
+
+  llvm::StringMap<FunctionCounts> Functions;
+};
+
+#endif
@@ -0,0 +1,93 @@
+//==============================================================================
+// FILE:
+//    EnumerationCache.h
+//
+// DESCRIPTION:
+//    Declares EnumerationCache, a persistent cache of the mutation points of
+//    functions, keyed by a structural hash of the function. Between two
+//    builds most functions do not change; their points are taken from the
+//    cache and only the functions whose hash is new are enumerated again.
+//
+//    The hash covers everything the points of a function depend on: its
+//    blocks, the opcodes, types, predicates and source lines of its
+//    instructions, and their operands (local values by position, constants
+//    by value, globals by name). It does not cover the position of the
+//    function in the module, the stable IDs of its points or the file name
+//    of its debug locations; those are read from the module on a hit.
+//
+//    Cache files are little-endian:
+//    ```
+//      char     Magic[8]      "FASTEC\0\0"
+//      uint32_t Version       2
+//      uint32_t Reserved      0
+//      uint64_t TableHash     getOperatorTableHash()
+//      uint64_t NumFunctions
+//      then, for every function:
+//        uint64_t Hash
+//        uint64_t NumPoints   N
+//        uint32_t Row[N][8]   BBID, InsID, Category, Opcode, Predicate,
+//                             NumMutants, Line, Column
+//    ```
+//    The points of a function also depend on the mutation operators. A file
+//    written with other operator tables (TableHash) or in another version of
+//    the format is ignored, i.e. it is a cold cache, and is replaced on the
+//    next save.
+//
+//    Saving a cache keeps the entries it was loaded with, so one file can
+//    serve several modules. Delete it to drop functions that are gone. The
+//    file is written next to the old one and renamed over it, so a build
+//    that dies while saving never leaves a truncated cache behind.
+//
+// License: MIT
+//==============================================================================
+#ifndef LLVM_TUTOR_ENUMERATION_CACHE_H
+#define LLVM_TUTOR_ENUMERATION_CACHE_H
+
+#include "StaticCallCounter.h"
+
+#include "llvm/ADT/ArrayRef.h"
+#include "llvm/ADT/DenseMap.h"
+#include "llvm/ADT/StringRef.h"
+#include "llvm/IR/Function.h"
+
+#include <cstdint>
+#include <mutex>
+#include <utility>
+#include <vector>
+
+// The structural hash of F. Functions with the same hash have the same
+// mutation points (up to their funcID, stable IDs and file names).
+uint64_t hashFunction(const llvm::Function &F);
+
+// All members can be called from several threads.
+class EnumerationCache {
+public:
+  // Loads (and adds to the current entries) the cache at Path. A missing
+  // or stale file is an empty cache. Returns false and prints a diagnostic
+  // if the file is malformed.
+  bool load(llvm::StringRef Path);
+  // Writes all entries to Path. Returns false and prints a diagnostic on
+  // failure.
+  bool save(llvm::StringRef Path) const;
+
+  // Appends the cached points of the function with hash Hash to Points and
+  // returns true, or returns false if the function is not cached. Only the
+  // fields stored in the cache are set (no FuncID, stable ID or file name).
+  bool lookup(uint64_t Hash, ResultStaticCC &Points);
+  // Caches Points as the points of the function with hash Hash
+  void insert(uint64_t Hash, llvm::ArrayRef<MutationPointRecord> Points);
+
+  uint64_t getNumHits() const;
+  uint64_t getNumMisses() const;
+
+private:
+  mutable std::mutex Lock;
+  // The points of all cached functions, back to back
+  std::vector<MutationPointRecord> Records;
+  // Hash -> (first record, number of records)
+  llvm::DenseMap<uint64_t, std::pair<size_t, size_t>> Functions;
+  uint64_t NumHits = 0;
+  uint64_t NumMisses = 0;
+};
+
+#endif
@@ -10,9 +10,19 @@
 #ifndef LLVM_TUTOR_INSTRUMENT_BASIC_H
 #define LLVM_TUTOR_INSTRUMENT_BASIC_H
 
+#include "CoverageProfile.h"
+#include "MutantRNG.h"
+#include "MutationOperators.h"
+#include "MutationPoint.h"
+#include "MutationTransaction.h"
+
+#include "llvm/ADT/ArrayRef.h"
 #include "llvm/IR/PassManager.h"
 #include "llvm/Pass.h"
 
+#include <string>
+#include <vector>
+
 //------------------------------------------------------------------------------
 // New PM interface
 //------------------------------------------------------------------------------
@@ -20,6 +30,36 @@ struct InjectFuncCall : public llvm::PassInfoMixin<InjectFuncCall> {
   llvm::PreservedAnalyses run(llvm::Module &M,
                               llvm::ModuleAnalysisManager &);
   bool runOnModule(llvm::Module &M);
+
+  // Writes one mutant of M per entry of Batch. M itself is not modified.
+  // Random operators of entry K are drawn from MutantRNG(Seed, index + K).
+  bool runBatch(llvm::Module &M, const std::vector<MutationPoint> &Batch,
+                uint64_t Seed);
+
+  // Picks one mutation point by reservoir sampling and mutates it. With a
+  // Coverage profile, points in unexecuted blocks are skipped or thinned out.
+  bool runSample(llvm::Module &M, MutantRNG &RNG,
+                 const CoverageProfile *Coverage = nullptr);
+
+  // Attaches stable IDs to all mutation points of M and writes them out
+  bool runEnumerate(llvm::Module &M);
+
+  // Compiles every mutant of every point into M (mutant schemata)
+  bool runSchemata(llvm::Module &M);
+
+  // Mutates every instruction of Targets (a higher-order mutant) into Txn,
+  // each with the operator of its point (-1 picks one at random from RNG).
+  // Loops caches the loop structure for the structural operators across
+  // calls. The mutant is dropped (nothing is applied and 0 is returned) if
+  // its mutations cannot be applied together, see selectMutations.
+  // Otherwise appends "<point> <replacement>" to Applied for every mutation
+  // and returns their number.
+  static unsigned
+  mutateInstructions(llvm::ArrayRef<std::pair<llvm::Instruction *,
+                                              MutationPoint>> Targets,
+                     MutationTransaction &Txn, MutantRNG &RNG,
+                     std::vector<std::string> &Applied,
+                     LoopInfoCache *Loops = nullptr);
 };
 
 //------------------------------------------------------------------------------
@@ -0,0 +1,64 @@
+//==============================================================================
+// FILE:
+//    MutantRNG.h
+//
+// DESCRIPTION:
+//    A counter-based random number generator for mutant selection.
+//
+//    Every random number is a pure function of (campaign seed, mutant index,
+//    draw number): the pair (Seed, Index) is hashed into a key and the n-th
+//    draw is the SplitMix64 finaliser applied to key + n * golden ratio.
+//    There is no global state, so:
+//      * mutant K of a campaign can be regenerated in O(1) from (Seed, K),
+//      * threads or processes generating disjoint mutant indices never need
+//        to coordinate,
+//      * two mutants started in the same second are no longer identical.
+//
+// License: MIT
+//==============================================================================
+#ifndef LLVM_TUTOR_MUTANT_RNG_H
+#define LLVM_TUTOR_MUTANT_RNG_H
+
+#include <cstdint>
+
+class MutantRNG {
+public:
+  MutantRNG(uint64_t Seed, uint64_t Index)
+      : Seed(Seed), Index(Index),
+        Key(mix(Seed ^ mix(Index + Golden))) {}
+
+  // The next 64-bit random number
+  uint64_t next() { return mix(Key + (++Counter) * Golden); }
+
+  // A random number in [0, N). N must not be 0.
+  uint64_t uniform(uint64_t N) { return next() % N; }
+
+  // A random number in [0, 1)
+  double uniformReal() { return (next() >> 11) * (1.0 / (1ULL << 53)); }
+
+  // UniformRandomBitGenerator interface, for the <random> distributions
+  using result_type = uint64_t;
+  static constexpr uint64_t min() { return 0; }
+  static constexpr uint64_t max() { return ~uint64_t(0); }
+  uint64_t operator()() { return next(); }
+
+  uint64_t getSeed() const { return Seed; }
+  uint64_t getIndex() const { return Index; }
+
+private:
+  static constexpr uint64_t Golden = 0x9e3779b97f4a7c15ULL;
+
+  // The SplitMix64 finaliser
+  static uint64_t mix(uint64_t X) {
+    X = (X ^ (X >> 30)) * 0xbf58476d1ce4e5b9ULL;
+    X = (X ^ (X >> 27)) * 0x94d049bb133111ebULL;
+    return X ^ (X >> 31);
+  }
+
+  uint64_t Seed;
+  uint64_t Index;
+  uint64_t Key;
+  uint64_t Counter = 0;
+};
+
+#endif
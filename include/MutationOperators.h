@@ -0,0 +1,230 @@
+//==============================================================================
+// FILE:
+//    MutationOperators.h
+//
+// DESCRIPTION:
+//    Declares the table-driven mutation operator engine.
+//
+//    The operators are the categories listed in table1.c. For every binary
+//    opcode and every icmp predicate a compile-time table holds the operator
+//    category and the opcodes/predicates it can be replaced with, e.g.:
+//      add       -> sub, mul, sdiv, srem        (category 3)
+//      icmp slt  -> sle, sge, sgt, eq, ne       (category 14)
+//    Looking up the row of an instruction is a single array index, so
+//    dispatch costs the same regardless of how many operators exist. The
+//    same rows drive the enumeration of mutation points (getNumMutants), the
+//    in-place mutation (applyMutation) and mutant schemata
+//    (createMutantValue).
+//
+//    The constant operators (categories 20 - 22) mutate integer constant
+//    operands. A second table, indexed by opcode, lists the operands that
+//    hold program values (e.g. the value of a store, but not its address;
+//    the arguments of a call, but not of an intrinsic; nothing of a GEP or
+//    an alloca), so that indices, alignments and similar operands are never
+//    mutated. The mutants of an instruction are its operator mutants
+//    followed by the mutants of each of its constant operands, and applying
+//    a constant mutant is a single setOperand.
+//
+//    The structural operators (categories 23 - 26) are in-place edits of
+//    branches and selects: swapping the successors of a conditional branch
+//    or the operands of a select, and retargeting an unconditional branch
+//    from the loop latch to the loop exit (continue -> break) or back. They
+//    never clone or rebuild the CFG. The loops are found through LoopInfo,
+//    which a LoopInfoCache computes once per function for all mutants.
+//
+// License: MIT
+//==============================================================================
+#ifndef LLVM_TUTOR_MUTATION_OPERATORS_H
+#define LLVM_TUTOR_MUTATION_OPERATORS_H
+
+#include "MutantRNG.h"
+#include "MutationPoint.h"
+#include "MutationTransaction.h"
+
+#include "llvm/ADT/ArrayRef.h"
+#include "llvm/ADT/DenseMap.h"
+#include "llvm/ADT/SmallVector.h"
+#include "llvm/Analysis/LoopInfo.h"
+#include "llvm/IR/Constants.h"
+#include "llvm/IR/Dominators.h"
+#include "llvm/IR/IRBuilder.h"
+#include "llvm/IR/InstrTypes.h"
+#include "llvm/IR/Instruction.h"
+#include "llvm/IR/Instructions.h"
+#include "llvm/IR/Module.h"
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+// Operator categories, numbered as in table1.c
+enum MutationCategory : uint8_t {
+  MC_None = 0,
+  MC_Neg = 1,
+  MC_Not = 2,
+  MC_Add = 3,
+  MC_Sub = 4,
+  MC_Mul = 5,
+  MC_Div = 6,
+  MC_Mod = 7,
+  MC_BitAnd = 8,
+  MC_BitOr = 9,
+  MC_BitXor = 10,
+  MC_Shl = 11,
+  MC_LShr = 12,
+  MC_AShr = 13,
+  MC_Lt = 14,
+  MC_Le = 15,
+  MC_Ge = 16,
+  MC_Gt = 17,
+  MC_Eq = 18,
+  MC_Neq = 19,
+  MC_ConstSpecial = 20,
+  MC_ConstAdjust = 21,
+  MC_ConstRandom = 22,
+  MC_SwapBranches = 23,
+  MC_ContinueToBreak = 24,
+  MC_BreakToContinue = 25,
+  MC_SwapSelect = 26,
+};
+
+// One row of the operator table. Replacements holds opcodes for binary
+// operators and predicates for icmp (structural operators have a single,
+// implicit replacement).
+struct MutationOperator {
+  uint8_t Category;
+  uint8_t NumReplacements;
+  unsigned Replacements[5];
+};
+
+// The dominator tree and loops of every function of a module, computed on
+// first use. They describe the unmutated functions, which is what every
+// mutant of a batch starts from (mutants are reverted before the next one is
+// applied), so one cache serves the whole batch.
+class LoopInfoCache {
+public:
+  const llvm::DominatorTree &getDomTree(const llvm::Function &F);
+  const llvm::LoopInfo &getLoopInfo(const llvm::Function &F);
+
+private:
+  struct FunctionInfo {
+    explicit FunctionInfo(llvm::Function &F) : DT(F), LI(DT) {}
+    llvm::DominatorTree DT;
+    llvm::LoopInfo LI;
+  };
+  FunctionInfo &get(const llvm::Function &F);
+
+  llvm::DenseMap<const llvm::Function *, std::unique_ptr<FunctionInfo>>
+      Functions;
+};
+
+// Returns the operator row that applies to I, or nullptr if I is not a
+// mutation point. Loops is only needed for unconditional branches; without
+// it, the loops of the function are computed for this call only.
+const MutationOperator *getMutationOperator(const llvm::Instruction &I,
+                                            LoopInfoCache *Loops = nullptr);
+
+// The block an unconditional branch is retargeted to by the
+// continue/break operators, or nullptr if Br is neither
+llvm::BasicBlock *getBranchRetarget(const llvm::BranchInst &Br,
+                                    LoopInfoCache &Loops);
+
+// An integer constant operand of an instruction that can be mutated
+struct ConstantOperand {
+  llvm::Instruction *Ins;
+  unsigned OperandIdx;
+  llvm::ConstantInt *Value;
+};
+
+// Appends the mutable constant operands of I to Operands, in operand order
+void getConstantOperands(llvm::Instruction &I,
+                         llvm::SmallVectorImpl<ConstantOperand> &Operands);
+
+// The mutable constant operands of all instructions of a module, computed
+// once. Entries of one instruction are contiguous.
+class ConstantOperandTable {
+public:
+  explicit ConstantOperandTable(llvm::Module &M);
+
+  llvm::ArrayRef<ConstantOperand> lookup(const llvm::Instruction &I) const;
+  size_t size() const { return Entries.size(); }
+  llvm::ArrayRef<ConstantOperand> entries() const { return Entries; }
+
+private:
+  llvm::SmallVector<ConstantOperand, 0> Entries;
+  // The first entry and the number of entries of every instruction
+  llvm::DenseMap<const llvm::Instruction *, std::pair<unsigned, unsigned>>
+      Ranges;
+};
+
+// Returns the number of mutants of I (0 if I is not a mutation point)
+unsigned getNumMutants(const llvm::Instruction &I,
+                       LoopInfoCache *Loops = nullptr);
+
+// A hash of the operator table and the constant operand table. Anything
+// derived from them (e.g. cached mutation points) is stale when it changes.
+uint64_t getOperatorTableHash();
+
+// Returns the category of the mutation point I, as stored in point files:
+// the category of its operator row, MC_ConstSpecial (the category of its
+// first mutant) if it only has constant mutants, or MC_None if I is not a
+// mutation point
+uint8_t getMutationCategory(const llvm::Instruction &I,
+                            LoopInfoCache *Loops = nullptr);
+
+// Applies mutant Sel of I in place, recording the edit in Txn. Returns false
+// if I is not a mutation point or Sel is out of range.
+bool applyMutation(llvm::Instruction &I, unsigned Sel,
+                   MutationTransaction &Txn, LoopInfoCache *Loops = nullptr);
+
+// If mutant Sel of I is a constant mutant, returns the constant it puts in
+// operand OperandIdx of I. Returns nullptr for operator mutants.
+llvm::ConstantInt *getConstantMutant(const llvm::Instruction &I, unsigned Sel,
+                                     unsigned &OperandIdx,
+                                     LoopInfoCache *Loops = nullptr);
+
+// Emits (at the insertion point of Builder) a value that computes mutant Sel
+// of I without modifying I. IsSelected is an i1 that is true iff the mutant
+// is active at runtime; it guards the divisor of division/remainder mutants
+// so that inactive mutants never trap. Returns nullptr for the mutants of
+// constant operands (see getConstantMutant) and of branches, which are not
+// values.
+llvm::Value *createMutantValue(llvm::IRBuilder<> &Builder,
+                               llvm::Instruction &I, unsigned Sel,
+                               llvm::Value *IsSelected);
+
+// Human readable description of mutant Sel of I, e.g. "icmp slt -> sle"
+std::string describeMutation(const llvm::Instruction &I, unsigned Sel,
+                             LoopInfoCache *Loops = nullptr);
+
+// Whether mutant Sel of I adds or removes CFG edges (break <-> continue).
+// Retargets are only checked against the loops of the unmutated function,
+// so a function can take at most one of them per mutant.
+bool changesCFG(const llvm::Instruction &I, unsigned Sel,
+                LoopInfoCache *Loops = nullptr);
+
+// The mutations of one (possibly higher-order) mutant: the points of the
+// mutant, the instructions they resolve to (nullptr if out of range) and,
+// once selected, the mutant applied at each of them
+struct MutantPlan {
+  std::vector<std::pair<llvm::Instruction *, MutationPoint>> Targets;
+  std::vector<unsigned> Sels;
+};
+
+// Selects the mutant of every target of Plan (selectMutant). A mutant is
+// applied whole or not at all: returns false and describes the conflict in
+// Error if a point is out of range or not a mutation point, if two points
+// are the same instruction or if a function would get two mutations that
+// change its CFG.
+bool selectMutations(MutantPlan &Plan, MutantRNG &RNG, LoopInfoCache *Loops,
+                     std::string &Error);
+
+// Applies the mutations selected by selectMutations, recording the edits in
+// Txn, and appends "<point> <mutant>" for each of them to Applied (the list
+// recorded by setMutantMetadata)
+void applyMutations(const MutantPlan &Plan, MutationTransaction &Txn,
+                    LoopInfoCache *Loops, std::vector<std::string> &Applied);
+
+#endif
@@ -0,0 +1,230 @@
+//==============================================================================
+// FILE:
+//    MutationPoint.h
+//
+// DESCRIPTION:
+//    Declares the mutation point record shared by the mutation passes and
+//    tools, together with the helpers that read mutation point files.
+//
+//    A mutation point is identified either
+//      * positionally, by the triple (funcID, bbID, insID): the index of the
+//        function within the module, the index of the basic block within
+//        that function and the index of the instruction within that basic
+//        block. Declarations count as functions.
+//      * or by a stable 64-bit ID, attached to the instruction as
+//        `!fast.mp !{i64 <ID>}` metadata by the enumerator. Stable IDs move
+//        with the instruction, so they survive passes that reorder or add
+//        code between enumeration and mutation.
+//
+//    Text point files (e.g. `fast_mutate.txt`) contain one point per line:
+//    ```
+//      (funcID, bbID, insID) [<operator>] [# comment]
+//      mp:<ID> [<operator>] [# comment]
+//    ```
+//    The optional <operator> selects one of the replacements available for
+//    the instruction at that point (used by batch lists).
+//
+//    Binary point files hold the same points in a form that can be memory
+//    mapped and indexed in place, without parsing or per-entry allocation.
+//    All fields are little-endian:
+//    ```
+//      char     Magic[8]      "FASTMP\0\0"
+//      uint32_t Version       1
+//      uint32_t Flags         bit 0: the StableID column is present
+//      uint64_t NumPoints     N
+//      uint64_t Reserved      0
+//      uint32_t FuncID[N]
+//      uint32_t BBID[N]
+//      uint32_t InsID[N]
+//      uint32_t Category[N]   operator category (see MutationOperators.h),
+//                             0 if unknown
+//      uint64_t StableID[N]   only if Flags bit 0 is set
+//    ```
+//    Operators are not stored; binary files are point files, not batch lists.
+//
+// License: MIT
+//==============================================================================
+#ifndef LLVM_TUTOR_MUTATION_POINT_H
+#define LLVM_TUTOR_MUTATION_POINT_H
+
+#include "MutantRNG.h"
+
+#include "llvm/ADT/ArrayRef.h"
+#include "llvm/ADT/DenseMap.h"
+#include "llvm/ADT/StringRef.h"
+#include "llvm/IR/Instruction.h"
+#include "llvm/IR/Module.h"
+#include "llvm/Support/Endian.h"
+#include "llvm/Support/MemoryBuffer.h"
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+struct MutationPoint {
+  static constexpr uint64_t NoStableID = ~uint64_t(0);
+
+  uint32_t FuncID = 0;
+  uint32_t BBID = 0;
+  uint32_t InsID = 0;
+  // If set, the point is identified by this ID rather than by its position
+  uint64_t StableID = NoStableID;
+  // The replacement to apply at this point, -1 means "pick one at random"
+  int Operator = -1;
+
+  bool hasStableID() const { return StableID != NoStableID; }
+};
+
+// The metadata kind that carries stable mutation point IDs
+constexpr const char *StableIDMDKind = "fast.mp";
+
+// Reads the stable ID attached to I into ID. Returns false if I has none.
+bool getStableID(const llvm::Instruction &I, uint64_t &ID);
+// As above, with the metadata kind already resolved (getMDKindID). Unlike
+// the version above, it does not write to the LLVMContext, so it can be used
+// on several functions of a module concurrently.
+bool getStableID(const llvm::Instruction &I, unsigned KindID, uint64_t &ID);
+
+// Attaches stable ID `ID` to I
+void setStableID(llvm::Instruction &I, uint64_t ID);
+
+// Records the (campaign seed, mutant index) pair a mutant was generated from,
+// and optionally the mutations it consists of ("<point> <operator>"), as
+// module metadata:
+//    !fast.mutant = !{!0}
+//    !0 = !{i64 <seed>, i64 <index>, !"<mutation 1>", ...}
+void setMutantMetadata(llvm::Module &M, uint64_t Seed, uint64_t Index,
+                       llvm::ArrayRef<std::string> Mutations = {});
+
+// Removes the metadata added by setMutantMetadata
+void eraseMutantMetadata(llvm::Module &M);
+
+// Formats Point the way it is written in point files
+std::string formatPoint(const MutationPoint &Point);
+
+// Parses one line of a text point file. Returns false if it is malformed.
+bool parseMutationPoint(const std::string &Line, MutationPoint &Point);
+
+// Reads the text point file at Path into Points. Returns false (and prints
+// a diagnostic) if the file cannot be opened or contains a malformed line.
+bool readMutationPointFile(llvm::StringRef Path,
+                           std::vector<MutationPoint> &Points);
+
+// Writes Points (and their operator categories, parallel to Points) as a
+// binary point file. Returns false and prints a diagnostic on failure.
+bool writeBinaryPointFile(llvm::StringRef Path,
+                          llvm::ArrayRef<MutationPoint> Points,
+                          llvm::ArrayRef<uint32_t> Categories);
+
+// A read-only list of mutation points. Binary point files (recognised by
+// their magic) are memory mapped and indexed in place; text point files are
+// parsed into memory.
+class MutationPointList {
+public:
+  // Opens the point file at Path. Returns false and prints a diagnostic on
+  // failure.
+  bool open(llvm::StringRef Path);
+
+  size_t size() const;
+  bool empty() const { return size() == 0; }
+  MutationPoint operator[](size_t Idx) const;
+  // The operator category of point Idx, 0 if unknown
+  uint32_t getCategory(size_t Idx) const;
+
+private:
+  bool openBinary(llvm::StringRef Path);
+
+  // Binary point files: the mapped file and its columns
+  std::unique_ptr<llvm::MemoryBuffer> Buffer;
+  size_t NumPoints = 0;
+  const llvm::support::ulittle32_t *FuncIDs = nullptr;
+  const llvm::support::ulittle32_t *BBIDs = nullptr;
+  const llvm::support::ulittle32_t *InsIDs = nullptr;
+  const llvm::support::ulittle32_t *Categories = nullptr;
+  const llvm::support::ulittle64_t *StableIDs = nullptr;
+
+  // Text point files
+  std::vector<MutationPoint> TextPoints;
+};
+
+// The operator of a drawn point: an arbitrary non-negative number, reduced by
+// selectMutant once the instruction (and so its number of mutants) is known
+int drawOperator(MutantRNG &RNG);
+
+// The mutant of an instruction with NumMutants (> 0) mutants that Operator
+// selects. An Operator of -1 (a point or batch list entry without operator)
+// selects a random mutant, drawn from RNG.
+unsigned selectMutant(int Operator, unsigned NumMutants, MutantRNG &RNG);
+
+// Draws random points from Points for mutants FirstIndex .. FirstIndex +
+// Count - 1 of the campaign Seed, Order distinct points per mutant (Order > 1
+// gives higher-order mutants). The result holds the points of mutant 0,
+// then those of mutant 1 and so on. The points and the operators of mutant K
+// only depend on (Seed, FirstIndex + K), see MutantRNG.h: every point is
+// drawn followed by its operator (drawOperator). All generators (the single
+// and batch modes of InjectFuncCall, fast-mutgen, fast-mutobj and fast-mutd)
+// draw through this function, so mutant K is the same whichever generated
+// it, alone or as part of a batch.
+std::vector<MutationPoint> drawMutationPoints(const MutationPointList &Points,
+                                              uint64_t Seed,
+                                              uint64_t FirstIndex,
+                                              uint64_t Count,
+                                              unsigned Order = 1);
+
+// Draws point indices with probabilities proportional to their weights
+// (e.g. to prefer covered points). Points of weight 0 are never drawn.
+class WeightedPointSampler {
+public:
+  explicit WeightedPointSampler(llvm::ArrayRef<double> Weights);
+
+  // Whether no point can be drawn (all weights are 0)
+  bool empty() const { return Cumulative.empty() || Cumulative.back() <= 0; }
+  // Draws an index from RNG (a single draw), the sampler must not be empty
+  size_t draw(MutantRNG &RNG) const;
+
+private:
+  std::vector<double> Cumulative;
+};
+
+// As above, drawing the points from Sampler instead of uniformly
+std::vector<MutationPoint>
+drawMutationPoints(const MutationPointList &Points,
+                   const WeightedPointSampler &Sampler, uint64_t Seed,
+                   uint64_t FirstIndex, uint64_t Count, unsigned Order = 1);
+
+// A flat index of all instructions in a module, so that points can be
+// resolved in O(1) instead of walking the module. Every instruction gets a
+// dense ID (its position in module order); per-function and per-block offsets
+// map (funcID, bbID, insID) to that ID. Points with a stable ID are resolved
+// through a hash map built from the `!fast.mp` metadata in the same walk.
+//
+// The index is built once per loaded module and can be shared by every
+// mutant generated from it: mutations applied through a MutationTransaction
+// and reverted afterwards leave it valid. It has to be rebuilt if the module
+// is changed permanently.
+class MutationPointIndex {
+public:
+  explicit MutationPointIndex(llvm::Module &M);
+
+  // Returns the instruction Point refers to, or nullptr if the point is out
+  // of range (or its stable ID does not exist in the module).
+  llvm::Instruction *lookup(const MutationPoint &Point) const;
+
+  // The total number of instructions (i.e. dense IDs) in the module
+  size_t size() const { return Instructions.size(); }
+
+private:
+  // All instructions, in module order
+  std::vector<llvm::Instruction *> Instructions;
+  // Dense ID of the first instruction of every block, in module order, plus
+  // a trailing sentinel
+  std::vector<uint32_t> BlockOffsets;
+  // Index into BlockOffsets of the first block of every function, plus a
+  // trailing sentinel
+  std::vector<uint32_t> FuncOffsets;
+  // Stable ID -> instruction
+  llvm::DenseMap<uint64_t, llvm::Instruction *> StableIDs;
+};
+
+#endif
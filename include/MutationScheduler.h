@@ -0,0 +1,140 @@
+//==============================================================================
+// FILE:
+//    MutationScheduler.h
+//
+// DESCRIPTION:
+//    Declares MutationScheduler, a feedback-driven picker of mutation points
+//    and operators.
+//
+//    Every (point, operator) pair is an arm of a multi-armed bandit. The
+//    outcome of running a mutant against the tests is turned into a reward
+//    in [0, 1]:
+//      * killed    t / (t + Tau), where t is the time it took to kill it.
+//                  Mutants that die in the first test are worth little,
+//                  mutants that need a long run to be killed are worth more,
+//      * survived  S / (1 + s), where s is the number of earlier survivals
+//                  of the arm and S the survival reward (0.5 by default).
+//                  A first survivor reveals a gap in the tests (or is
+//                  equivalent); an arm that keeps surviving keeps producing
+//                  the same useless mutant, so its mean reward decays like
+//                  log(s) / s and it loses priority,
+//      * timeout   0.1, it costs the whole time budget,
+//      * crash     0, the mutant is broken (trivially detected).
+//    Points are picked first (from the statistics of all their operators),
+//    then an operator of the picked point, either by UCB1 or by Thompson
+//    sampling on a Beta posterior (sampled from MutantRNG, so that the picks
+//    do not depend on the standard library). Arms that were never played are
+//    tried first. Picks that have no outcome yet count as plays with reward
+//    0, so a batch of picks does not pile up on one arm. The statistics are
+//    keyed by the point packed into 64 bits (see getKey), so no string is
+//    built per point and pick.
+//
+//    The statistics are persisted in a text file, one line per arm:
+//    ```
+//      # FASTSCHED 1
+//      <point> <operator> <killed> <survived> <timeouts> <crashes> <reward>
+//          <kill-ms>
+//    ```
+//    where <reward> and <kill-ms> are sums over all outcomes of the arm.
+//
+// License: MIT
+//==============================================================================
+#ifndef LLVM_TUTOR_MUTATION_SCHEDULER_H
+#define LLVM_TUTOR_MUTATION_SCHEDULER_H
+
+#include "MutantRNG.h"
+#include "MutationPoint.h"
+
+#include "llvm/ADT/ArrayRef.h"
+#include "llvm/ADT/DenseMap.h"
+#include "llvm/ADT/StringRef.h"
+
+#include <cstdint>
+#include <vector>
+
+class MutationScheduler {
+public:
+  enum Policy { UCB, Thompson };
+  enum Outcome { Killed, Survived, Timeout, Crash };
+
+  // The statistics of one arm
+  struct ArmStats {
+    uint64_t Killed = 0;
+    uint64_t Survived = 0;
+    uint64_t Timeouts = 0;
+    uint64_t Crashes = 0;
+    double Reward = 0;
+    double KillMillis = 0;
+    // Picks without an outcome yet (not persisted)
+    uint64_t Pending = 0;
+
+    uint64_t getNumOutcomes() const {
+      return Killed + Survived + Timeouts + Crashes;
+    }
+    uint64_t getNumPlays() const { return getNumOutcomes() + Pending; }
+  };
+
+  explicit MutationScheduler(Policy P = UCB, double Tau = 100,
+                             double SurvivalReward = 0.5)
+      : SchedPolicy(P), Tau(Tau), SurvivalReward(SurvivalReward) {}
+
+  // Loads (and adds to the current statistics) the state file at Path.
+  // A missing file is an empty state. Returns false and prints a diagnostic
+  // if the file is malformed.
+  bool load(llvm::StringRef Path);
+  // Writes the statistics to Path. Returns false and prints a diagnostic on
+  // failure.
+  bool save(llvm::StringRef Path) const;
+
+  // Records the outcome of the mutant (Point, Operator). Millis is the time
+  // it took to kill it (only used for Killed). Returns false and prints a
+  // diagnostic if Point has no key.
+  bool record(const MutationPoint &Point, unsigned Operator, Outcome O,
+              double Millis);
+
+  // Picks one of Points and returns its index. If Weights is not empty, it
+  // has one weight per point: points of weight 0 are never picked and the
+  // scores of the others are scaled by their weight. Points without a key
+  // are never picked either. Points must not be empty.
+  size_t pickPoint(const MutationPointList &Points, MutantRNG &RNG,
+                   llvm::ArrayRef<double> Weights = {});
+  // Picks one of the NumOperators operators of Point, which has to be the
+  // point returned by the last pickPoint
+  unsigned pickOperator(const MutationPoint &Point, unsigned NumOperators,
+                        MutantRNG &RNG);
+
+  // Parses "killed", "survived", "timeout" or "crash". Returns false for
+  // anything else.
+  static bool parseOutcome(llvm::StringRef Name, Outcome &O);
+
+  // The key of Point in the statistics: a stable ID with the top bit set, or
+  // (funcID, bbID, insID) in 21 bits each. Returns false if the point does
+  // not fit.
+  static bool getKey(const MutationPoint &Point, uint64_t &Key);
+  // The point of a key returned by getKey
+  static MutationPoint getPoint(uint64_t Key);
+
+  // The statistics of all arms, by point
+  struct PointStats {
+    ArmStats Total;
+    std::vector<ArmStats> Operators;
+  };
+  const llvm::DenseMap<uint64_t, PointStats> &getStats() const {
+    return Stats;
+  }
+
+private:
+  // The score of an arm, the arm with the highest score is played
+  double score(const ArmStats &Arm, uint64_t Plays, MutantRNG &RNG) const;
+  PointStats &getPointStats(uint64_t Key) { return Stats[Key]; }
+  void addOutcome(ArmStats &Arm, Outcome O, double Millis, double Reward);
+
+  Policy SchedPolicy;
+  double Tau;
+  double SurvivalReward;
+  // Keyed by getKey(Point)
+  llvm::DenseMap<uint64_t, PointStats> Stats;
+  uint64_t TotalPlays = 0;
+};
+
+#endif
@@ -0,0 +1,73 @@
+//==============================================================================
+// FILE:
+//    MutationTransaction.h
+//
+// DESCRIPTION:
+//    Declares MutationTransaction, an undo log for in-place IR mutations.
+//
+//    Every edit made through a transaction records enough state to undo it:
+//      * the old predicate of a compare instruction,
+//      * the old value of a rewired operand,
+//      * the instruction that was replaced (it is detached, not deleted).
+//    revert() rolls the edits back in reverse order, which restores the
+//    module exactly as it was (including the original Instruction objects).
+//    This lets batch generation mutate, serialise and roll back one shared
+//    module instead of cloning it for every mutant.
+//
+//    Edits that are neither reverted nor explicitly committed are committed
+//    when the transaction is destroyed.
+//
+// License: MIT
+//==============================================================================
+#ifndef LLVM_TUTOR_MUTATION_TRANSACTION_H
+#define LLVM_TUTOR_MUTATION_TRANSACTION_H
+
+#include "llvm/ADT/SmallVector.h"
+#include "llvm/IR/InstrTypes.h"
+#include "llvm/IR/Instruction.h"
+
+#include <vector>
+
+class MutationTransaction {
+public:
+  MutationTransaction() = default;
+  MutationTransaction(const MutationTransaction &) = delete;
+  MutationTransaction &operator=(const MutationTransaction &) = delete;
+  ~MutationTransaction() { commit(); }
+
+  // Changes the predicate of Cmp to Pred
+  void setPredicate(llvm::CmpInst &Cmp, llvm::CmpInst::Predicate Pred);
+  // Changes operand Idx of I to V
+  void setOperand(llvm::Instruction &I, unsigned Idx, llvm::Value *V);
+  // Inserts New in place of Old and rewires all uses of Old to New. Old is
+  // detached from its block but kept alive so that it can be restored.
+  void replaceInstruction(llvm::Instruction &Old, llvm::Instruction *New);
+
+  // Undoes all recorded edits (in reverse order) and clears the log
+  void revert();
+  // Keeps all recorded edits, frees the replaced instructions and clears the
+  // log
+  void commit();
+
+  bool empty() const { return Log.empty(); }
+
+private:
+  enum class EditKind { Predicate, Operand, Replace };
+
+  struct Edit {
+    EditKind Kind;
+    llvm::Instruction *Ins;
+    // EditKind::Predicate
+    llvm::CmpInst::Predicate OldPredicate;
+    // EditKind::Operand
+    unsigned OperandIdx;
+    llvm::Value *OldValue;
+    // EditKind::Replace: Ins is the detached original, New its replacement
+    llvm::Instruction *New;
+    llvm::SmallVector<llvm::Value *, 4> OldOperands;
+  };
+
+  std::vector<Edit> Log;
+};
+
+#endif
@@ -0,0 +1,106 @@
+//==============================================================================
+// FILE:
+//    ProgramIndex.h
+//
+// DESCRIPTION:
+//    Declares ProgramIndex, the mutation points of a whole program that is
+//    made of many modules (translation units), each with its own point file.
+//    Points in a point file have no module identity; the index gives every
+//    module a contiguous range of program-wide point IDs, so that a single
+//    campaign can draw from all modules and still only has to load the one
+//    module each mutant is in.
+//
+//    Modules are drawn with probabilities proportional to their weights (by
+//    default their number of points, i.e. every point of the program is
+//    equally likely) by a binary search over the cumulative weights, then a
+//    point is drawn uniformly within the module. Both take O(log M) for M
+//    modules, as does resolving a program-wide ID.
+//
+//    Index files are text files, one module per line, with tab separated
+//    fields:
+//    ```
+//      <first ID> <number of points> <weight> <module> <point file>
+//    ```
+//    The ranges have to be contiguous and in order. Relative paths are
+//    relative to the directory of the index file. Lines starting with `#`
+//    are comments.
+//
+// License: MIT
+//==============================================================================
+#ifndef LLVM_TUTOR_PROGRAM_INDEX_H
+#define LLVM_TUTOR_PROGRAM_INDEX_H
+
+#include "MutantRNG.h"
+
+#include "llvm/ADT/StringRef.h"
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// One module of the program
+struct ProgramModule {
+  std::string ModulePath;
+  std::string PointFile;
+  // Its points have the IDs FirstPoint .. FirstPoint + NumPoints - 1
+  uint64_t FirstPoint = 0;
+  uint64_t NumPoints = 0;
+  double Weight = 0;
+};
+
+// A point of the program: the index of its module in the ProgramIndex and
+// the index of the point in the module's point file
+struct ProgramPoint {
+  size_t Module = 0;
+  uint64_t Point = 0;
+  // The replacement to apply, as in MutationPoint
+  int Operator = -1;
+};
+
+class ProgramIndex {
+public:
+  // Appends a module, its points get the IDs that follow those of the
+  // previous module. A negative Weight stands for NumPoints.
+  void addModule(llvm::StringRef ModulePath, llvm::StringRef PointFile,
+                 uint64_t NumPoints, double Weight = -1);
+
+  // Reads the index at Path (replacing the current modules). Returns false
+  // and prints a diagnostic if it cannot be read or is malformed.
+  bool load(llvm::StringRef Path);
+  // Writes the index to Path. Returns false and prints a diagnostic on
+  // failure.
+  bool save(llvm::StringRef Path) const;
+
+  size_t size() const { return Modules.size(); }
+  const ProgramModule &operator[](size_t Idx) const { return Modules[Idx]; }
+  // The number of points of all modules
+  uint64_t getNumPoints() const {
+    return Modules.empty() ? 0
+                           : Modules.back().FirstPoint +
+                                 Modules.back().NumPoints;
+  }
+
+  // Maps the program-wide ID to its point. Returns false if it is out of
+  // range.
+  bool resolve(uint64_t ID, ProgramPoint &Point) const;
+
+  // Whether no point can be drawn (no module has points and a weight)
+  bool empty() const { return Cumulative.empty() || Cumulative.back() <= 0; }
+  // Draws a point from RNG, the index must not be empty
+  ProgramPoint draw(MutantRNG &RNG) const;
+
+private:
+  std::vector<ProgramModule> Modules;
+  // The cumulative module weights
+  std::vector<double> Cumulative;
+};
+
+// Draws the points of mutants FirstIndex .. FirstIndex + Count - 1 of the
+// campaign Seed, one per mutant. As with drawMutationPoints, the point and
+// the operator of mutant K only depend on (Seed, FirstIndex + K).
+std::vector<ProgramPoint> drawProgramPoints(const ProgramIndex &Index,
+                                            uint64_t Seed,
+                                            uint64_t FirstIndex,
+                                            uint64_t Count);
+
+#endif
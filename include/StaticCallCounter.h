@@ -3,32 +3,74 @@
 //    StaticCallCounter.h
 //
 // DESCRIPTION:
-//    Declares the StaticCallCounter Pass
+//    Declares the StaticCallCounter Pass, the mutation point enumerator.
+//    It is an analysis: the result lists every eligible mutation point of
+//    the module, in module order, with what is known about it statically.
 //
 // License: MIT
 //========================================================================
 #ifndef LLVM_TUTOR_STATICCALLCOUNTER_H
 #define LLVM_TUTOR_STATICCALLCOUNTER_H
 
-#include "llvm/IR/CallSite.h"
+#include "MutationPoint.h"
+
+#include "llvm/ADT/StringRef.h"
 #include "llvm/IR/Module.h"
 #include "llvm/IR/PassManager.h"
 #include "llvm/Pass.h"
 #include "llvm/Support/raw_ostream.h"
 
-using ResultStaticCC = llvm::DenseMap<const llvm::Function *, unsigned>;
+#include <cstdint>
+#include <vector>
+
+// One eligible mutation point and its static description
+struct MutationPointRecord {
+  // (funcID, bbID, insID), plus the stable ID if the point has one
+  MutationPoint Point;
+  // The operator category (see MutationOperators.h). Points that only have
+  // constant mutants are MC_ConstSpecial, the category of their first one.
+  uint8_t Category = 0;
+  // The opcode of the instruction, and its predicate for compares (0
+  // otherwise)
+  unsigned Opcode = 0;
+  unsigned Predicate = 0;
+  // The number of mutants of the point (operator and constant mutants)
+  unsigned NumMutants = 0;
+  // The DILocation of the instruction, Line is 0 if it has none. File
+  // points into the module's debug info.
+  llvm::StringRef File;
+  unsigned Line = 0;
+  unsigned Column = 0;
+};
+
+using ResultStaticCC = std::vector<MutationPointRecord>;
+
+class EnumerationCache;
 
 //------------------------------------------------------------------------------
 // New PM interface
 //------------------------------------------------------------------------------
 struct StaticCallCounter : public llvm::AnalysisInfoMixin<StaticCallCounter> {
   using Result = ResultStaticCC;
+
+  // Functions are enumerated on NumThreads threads (0: one per core). The
+  // result does not depend on the number of threads. With a Cache, the
+  // points of functions found in it are taken from it, and the points of
+  // the other functions are added to it.
+  explicit StaticCallCounter(unsigned NumThreads = 0,
+                             EnumerationCache *Cache = nullptr)
+      : NumThreads(NumThreads), Cache(Cache) {}
+
   Result run(llvm::Module &M, llvm::ModuleAnalysisManager &);
   Result runOnModule(llvm::Module &M);
 
   // A special type used by analysis passes to provide an address that
   // identifies that particular analysis pass type.
   static llvm::AnalysisKey Key;
+
+private:
+  unsigned NumThreads;
+  EnumerationCache *Cache;
 };
 
 //------------------------------------------------------------------------------
@@ -36,22 +78,24 @@ struct StaticCallCounter : public llvm::AnalysisInfoMixin<StaticCallCounter> {
 //------------------------------------------------------------------------------
 struct LegacyStaticCallCounter : public llvm::ModulePass {
   static char ID;
-  LegacyStaticCallCounter() : llvm::ModulePass(ID) {}
+  LegacyStaticCallCounter();
   bool runOnModule(llvm::Module &M) override;
   // The print method must be implemented by Legacy analys passes in order to
   // print a human readable version of the analysis results:
   //  http://llvm.org/docs/WritingAnLLVMPass.html#the-print-method
   void print(llvm::raw_ostream &OutS, llvm::Module const *M) const override;
 
-  ResultStaticCC DirectCalls;
+  ResultStaticCC Points;
   StaticCallCounter Impl;
 };
 
 //------------------------------------------------------------------------------
 // Helper functions
 //------------------------------------------------------------------------------
-// Pretty-prints the result of this analysis
-void printStaticCCResult(llvm::raw_ostream &OutS,
-                         const ResultStaticCC &DirectCalls);
+// Prints the result of this analysis as a point file, one point per line:
+//    <point> # <category> <opcode> [<predicate>] [<file>:<line>:<col>]
+// where <point> is mp:<ID> for points with a stable ID and
+// (funcID, bbID, insID) for the others.
+void printStaticCCResult(llvm::raw_ostream &OutS, const ResultStaticCC &Points);
 
 #endif
@@ -0,0 +1,64 @@
+//==============================================================================
+// FILE:
+//    CoverageProfile.cpp
+//
+// DESCRIPTION:
+//    Implements CoverageProfile, see CoverageProfile.h.
+//
+// License: MIT
+//==============================================================================
+#include "CoverageProfile.h"
+
+#include <fstream>
+#include <iostream>
+#include <regex>
+#include <string>
+
+using namespace llvm;
+
+bool CoverageProfile::load(StringRef Path) {
+  std::ifstream File(Path.str());
+  if (!File.is_open()) {
+    std::cerr << "Failed to open coverage profile " << Path.str() << "\n";
+    return false;
+  }
+
+  // <function> [<bbID>] <count>. Anything else (e.g. the header printed by
+  // DynamicCallCounter) is skipped.
+  static const std::regex Pattern("\\s*(\\S+)\\s+(\\d+)(?:\\s+(\\d+))?\\s*");
+
+  std::string Line;
+  while (std::getline(File, Line)) {
+    std::smatch Matches;
+    if (Line.empty() || Line[0] == '#' ||
+        !std::regex_match(Line, Matches, Pattern))
+      continue;
+
+    FunctionCounts &Counts = Functions[Matches[1].str()];
+    if (!Matches[3].matched) {
+      Counts.Calls += std::stoull(Matches[2]);
+      continue;
+    }
+
+    unsigned BBID = std::stoul(Matches[2]);
+    uint64_t Count = std::stoull(Matches[3]);
+    if (Counts.Blocks.size() <= BBID)
+      Counts.Blocks.resize(BBID + 1);
+    Counts.Blocks[BBID] += Count;
+    // The entry block is executed once per call
+    if (BBID == 0)
+      Counts.Calls += Count;
+  }
+  return true;
+}
+
+bool CoverageProfile::isExecuted(StringRef Func, unsigned BBID) const {
+  auto It = Functions.find(Func);
+  if (It == Functions.end())
+    return false;
+
+  const FunctionCounts &Counts = It->getValue();
+  if (Counts.Blocks.empty())
+    return Counts.Calls > 0;
+  return BBID < Counts.Blocks.size() && Counts.Blocks[BBID] > 0;
+}
@@ -0,0 +1,310 @@
+//==============================================================================
+// FILE:
+//    EnumerationCache.cpp
+//
+// DESCRIPTION:
+//    Implements EnumerationCache and the structural function hash, see
+//    EnumerationCache.h.
+//
+// License: MIT
+//==============================================================================
+#include "EnumerationCache.h"
+#include "MutationOperators.h"
+
+#include "llvm/ADT/SmallString.h"
+#include "llvm/IR/Constants.h"
+#include "llvm/IR/DebugInfoMetadata.h"
+#include "llvm/IR/Instructions.h"
+#include "llvm/Support/EndianStream.h"
+#include "llvm/Support/FileSystem.h"
+#include "llvm/Support/MemoryBuffer.h"
+#include "llvm/Support/raw_ostream.h"
+#include "llvm/Support/xxhash.h"
+
+using namespace llvm;
+
+static const char CacheMagic[8] = {'F', 'A', 'S', 'T', 'E', 'C', 0, 0};
+static const uint32_t CacheVersion = 2;
+static const size_t CacheHeaderSize = 32;
+static const size_t CacheRowSize = 8 * sizeof(uint32_t);
+
+//-----------------------------------------------------------------------------
+// Structural hash
+//-----------------------------------------------------------------------------
+namespace {
+// Serializes the structure of a function into a byte string, which is then
+// hashed in one go
+class FunctionHasher {
+public:
+  explicit FunctionHasher(const Function &F)
+      : OS(Bytes), W(OS, support::little) {
+    // Local values are referred to by their position, which has to be known
+    // before the first use (e.g. in PHIs)
+    uint32_t Number = 0;
+    for (const Argument &Arg : F.args())
+      Numbers[&Arg] = Number++;
+    for (const BasicBlock &BB : F) {
+      Numbers[&BB] = Number++;
+      for (const Instruction &I : BB)
+        Numbers[&I] = Number++;
+    }
+  }
+
+  uint64_t hash(const Function &F) {
+    W.write<uint64_t>(F.arg_size());
+    for (const BasicBlock &BB : F) {
+      W.write<uint64_t>(BB.size());
+      for (const Instruction &I : BB)
+        addInstruction(I);
+    }
+    uint64_t Hash = xxHash64(OS.str());
+    // The two largest values are the empty and tombstone keys of DenseMap
+    return (Hash >= ~uint64_t(0) - 1) ? Hash - 2 : Hash;
+  }
+
+private:
+  enum Tag : uint8_t {
+    T_Local,
+    T_ConstantInt,
+    T_Global,
+    T_ConstantExpr,
+    T_Other,
+  };
+
+  void addType(const Type *Ty) {
+    W.write<uint8_t>(Ty->getTypeID());
+    if (Ty->isIntegerTy())
+      W.write<uint32_t>(Ty->getIntegerBitWidth());
+  }
+
+  void addString(StringRef Str) { W.write<uint64_t>(xxHash64(Str)); }
+
+  void addValue(const Value *V) {
+    auto It = Numbers.find(V);
+    if (It != Numbers.end()) {
+      W.write<uint8_t>(T_Local);
+      W.write<uint32_t>(It->second);
+    } else if (auto *C = dyn_cast<ConstantInt>(V)) {
+      W.write<uint8_t>(T_ConstantInt);
+      const APInt &Value = C->getValue();
+      W.write<uint32_t>(Value.getBitWidth());
+      for (unsigned Idx = 0; Idx < Value.getNumWords(); Idx++)
+        W.write<uint64_t>(Value.getRawData()[Idx]);
+    } else if (auto *GV = dyn_cast<GlobalValue>(V)) {
+      W.write<uint8_t>(T_Global);
+      addString(GV->getName());
+    } else if (auto *CE = dyn_cast<ConstantExpr>(V)) {
+      W.write<uint8_t>(T_ConstantExpr);
+      W.write<uint32_t>(CE->getOpcode());
+      W.write<uint32_t>(CE->getNumOperands());
+      for (const Value *Op : CE->operand_values())
+        addValue(Op);
+    } else {
+      W.write<uint8_t>(T_Other);
+      W.write<uint32_t>(V->getValueID());
+      addType(V->getType());
+    }
+  }
+
+  void addInstruction(const Instruction &I) {
+    W.write<uint32_t>(I.getOpcode());
+    addType(I.getType());
+    if (auto *Cmp = dyn_cast<CmpInst>(&I))
+      W.write<uint32_t>(Cmp->getPredicate());
+
+    // The file name is read from the module on a hit
+    const DILocation *Loc = I.getDebugLoc().get();
+    W.write<uint32_t>(Loc ? Loc->getLine() : 0);
+    W.write<uint32_t>(Loc ? Loc->getColumn() : 0);
+
+    W.write<uint32_t>(I.getNumOperands());
+    for (const Value *Op : I.operand_values())
+      addValue(Op);
+    // Incoming blocks are not operands
+    if (auto *Phi = dyn_cast<PHINode>(&I))
+      for (const BasicBlock *BB : Phi->blocks())
+        addValue(BB);
+  }
+
+  SmallString<4096> Bytes;
+  raw_svector_ostream OS;
+  support::endian::Writer W;
+  DenseMap<const Value *, uint32_t> Numbers;
+};
+} // namespace
+
+uint64_t hashFunction(const Function &F) {
+  return FunctionHasher(F).hash(F);
+}
+
+//-----------------------------------------------------------------------------
+// Cache files
+//-----------------------------------------------------------------------------
+bool EnumerationCache::load(StringRef Path) {
+  if (!sys::fs::exists(Path))
+    return true;
+
+  auto BufferOrErr = MemoryBuffer::getFile(Path, /*FileSize=*/-1,
+                                           /*RequiresNullTerminator=*/false);
+  if (!BufferOrErr) {
+    errs() << "Failed to open enumeration cache " << Path << ": "
+           << BufferOrErr.getError().message() << "\n";
+    return false;
+  }
+
+  const char *Data = (*BufferOrErr)->getBufferStart();
+  const char *End = (*BufferOrErr)->getBufferEnd();
+  if (size_t(End - Data) < CacheHeaderSize ||
+      StringRef(Data, sizeof(CacheMagic)) !=
+          StringRef(CacheMagic, sizeof(CacheMagic))) {
+    errs() << "Not an enumeration cache: " << Path << "\n";
+    return false;
+  }
+
+  // A cache of another format or other operators is stale, not broken: it
+  // is ignored and overwritten on the next save
+  using namespace support;
+  uint32_t Version = endian::read32le(Data + 8);
+  if (Version != CacheVersion ||
+      endian::read64le(Data + 16) != getOperatorTableHash()) {
+    errs() << "Ignoring stale enumeration cache " << Path << "\n";
+    return true;
+  }
+  uint64_t NumFunctions = endian::read64le(Data + 24);
+
+  std::lock_guard<std::mutex> Guard(Lock);
+  const char *Ptr = Data + CacheHeaderSize;
+  for (uint64_t Func = 0; Func < NumFunctions; Func++) {
+    if (size_t(End - Ptr) < 2 * sizeof(uint64_t)) {
+      errs() << "Truncated enumeration cache " << Path << "\n";
+      return false;
+    }
+    uint64_t Hash = endian::read64le(Ptr);
+    uint64_t NumPoints = endian::read64le(Ptr + 8);
+    Ptr += 2 * sizeof(uint64_t);
+    if (NumPoints > size_t(End - Ptr) / CacheRowSize) {
+      errs() << "Truncated enumeration cache " << Path << "\n";
+      return false;
+    }
+
+    Functions[Hash] = std::make_pair(Records.size(), size_t(NumPoints));
+    for (uint64_t Idx = 0; Idx < NumPoints; Idx++, Ptr += CacheRowSize) {
+      MutationPointRecord Record;
+      Record.Point.BBID = endian::read32le(Ptr);
+      Record.Point.InsID = endian::read32le(Ptr + 4);
+      Record.Category = endian::read32le(Ptr + 8);
+      Record.Opcode = endian::read32le(Ptr + 12);
+      Record.Predicate = endian::read32le(Ptr + 16);
+      Record.NumMutants = endian::read32le(Ptr + 20);
+      Record.Line = endian::read32le(Ptr + 24);
+      Record.Column = endian::read32le(Ptr + 28);
+      Records.push_back(Record);
+    }
+  }
+  return true;
+}
+
+bool EnumerationCache::save(StringRef Path) const {
+  // Written to a temporary file and renamed, so that a concurrent build
+  // reads either the old or the new cache, and a failed save leaves the old
+  // one intact
+  SmallString<128> TmpPath;
+  int FD;
+  std::error_code EC =
+      sys::fs::createUniqueFile(Path + ".tmp%%%%%%", FD, TmpPath);
+  if (EC) {
+    errs() << "Failed to create " << Path << ": " << EC.message() << "\n";
+    return false;
+  }
+
+  raw_fd_ostream Out(FD, /*shouldClose=*/true);
+  std::lock_guard<std::mutex> Guard(Lock);
+  support::endian::Writer W(Out, support::little);
+  Out.write(CacheMagic, sizeof(CacheMagic));
+  W.write<uint32_t>(CacheVersion);
+  W.write<uint32_t>(0);
+  W.write<uint64_t>(getOperatorTableHash());
+  W.write<uint64_t>(Functions.size());
+
+  for (const auto &Entry : Functions) {
+    W.write<uint64_t>(Entry.first);
+    W.write<uint64_t>(Entry.second.second);
+    for (const MutationPointRecord &Record :
+         makeArrayRef(Records).slice(Entry.second.first,
+                                     Entry.second.second)) {
+      W.write<uint32_t>(Record.Point.BBID);
+      W.write<uint32_t>(Record.Point.InsID);
+      W.write<uint32_t>(Record.Category);
+      W.write<uint32_t>(Record.Opcode);
+      W.write<uint32_t>(Record.Predicate);
+      W.write<uint32_t>(Record.NumMutants);
+      W.write<uint32_t>(Record.Line);
+      W.write<uint32_t>(Record.Column);
+    }
+  }
+
+  Out.close();
+  if (Out.has_error()) {
+    errs() << "Failed to write " << Path << ": " << Out.error().message()
+           << "\n";
+    Out.clear_error();
+    sys::fs::remove(TmpPath);
+    return false;
+  }
+  if ((EC = sys::fs::rename(TmpPath, Path))) {
+    errs() << "Failed to write " << Path << ": " << EC.message() << "\n";
+    sys::fs::remove(TmpPath);
+    return false;
+  }
+  return true;
+}
+
+//-----------------------------------------------------------------------------
+// Lookups
+//-----------------------------------------------------------------------------
+bool EnumerationCache::lookup(uint64_t Hash, ResultStaticCC &Points) {
+  std::lock_guard<std::mutex> Guard(Lock);
+  auto It = Functions.find(Hash);
+  if (It == Functions.end()) {
+    NumMisses++;
+    return false;
+  }
+
+  NumHits++;
+  auto Cached = makeArrayRef(Records).slice(It->second.first,
+                                            It->second.second);
+  Points.insert(Points.end(), Cached.begin(), Cached.end());
+  return true;
+}
+
+void EnumerationCache::insert(uint64_t Hash,
+                              ArrayRef<MutationPointRecord> Points) {
+  std::lock_guard<std::mutex> Guard(Lock);
+  if (Functions.count(Hash))
+    return;
+
+  Functions[Hash] = std::make_pair(Records.size(), Points.size());
+  for (const MutationPointRecord &Record : Points) {
+    // Only what the cache file stores, see lookup
+    MutationPointRecord Cached;
+    Cached.Point.BBID = Record.Point.BBID;
+    Cached.Point.InsID = Record.Point.InsID;
+    Cached.Category = Record.Category;
+    Cached.Opcode = Record.Opcode;
+    Cached.Predicate = Record.Predicate;
+    Cached.NumMutants = Record.NumMutants;
+    Cached.Line = Record.Line;
+    Cached.Column = Record.Column;
+    Records.push_back(Cached);
+  }
+}
+
+uint64_t EnumerationCache::getNumHits() const {
+  std::lock_guard<std::mutex> Guard(Lock);
+  return NumHits;
+}
+
+uint64_t EnumerationCache::getNumMisses() const {
+  std::lock_guard<std::mutex> Guard(Lock);
+  return NumMisses;
+}
@@ -3,28 +3,79 @@
 //    InjectFuncCall.cpp
 //
 // DESCRIPTION:
-//    For each function defined in the input IR module, InjectFuncCall inserts
-//    a call to printf (from the C standard I/O library). The injected IR code
-//    corresponds to the following function call in ANSI C:
-//    ```C
-//      printf("(llvm-tutor) Hello from: %s\n(llvm-tutor)   number of arguments: %d\n",
-//             FuncName, FuncNumArgs);
+//    Mutates the input IR module. InjectFuncCall reads the mutation points
+//    listed in `fast_mutate.txt` (a text or binary point file, see
+//    MutationPoint.h for the formats), picks one of them at random and
+//    replaces the operator at that point with one of its mutants, e.g.:
+//    ```IR
+//      %5 = icmp slt i32 %4, 10   ==>   %5 = icmp sge i32 %4, 10
 //    ```
-//    This code is inserted at the beginning of each function, i.e. before any
-//    other instruction is executed.
 //
-//    To illustrate, for `void foo(int a, int b, int c)`, the code added by InjectFuncCall
-//    will generated the following output at runtime:
-//    ```
-//    (llvm-tutor) Hello World from: foo
-//    (llvm-tutor)   number of arguments: 3
-//    ```
+//    In batch mode the pass generates many mutants from a single parse of
+//    the input module: every entry of the batch list (or every random pick
+//    when a count is given) is applied to the module in place, written to
+//    its own bitcode file, `<batch-dir>/mutant-<k>.bc`, and then rolled back
+//    through a MutationTransaction. The input module is left untouched.
+//    `<batch-dir>/mutants.txt` records which point and operator every mutant
+//    file corresponds to.
+//
+//    In sample mode no point file is needed: the eligible instructions are
+//    enumerated while walking the module, one of them is picked by reservoir
+//    sampling and mutated, all in that single walk and with O(1) memory.
+//
+//    In enumerate mode every mutation point gets a stable ID, attached as
+//    `!fast.mp` metadata, and the points are written as `mp:<ID>` lines.
+//    Run it once per build; the annotated module and its point list can be
+//    reused by later pipeline stages, since the IDs move with the
+//    instructions.
+//
+//    In schemata mode every mutant of every eligible point is compiled into
+//    the module at once. Each point becomes a chain of `select`s on the
+//    global `__fast_mutant_id`, which is read from the FAST_MUTANT_ID
+//    environment variable at startup (0, the default, runs the original
+//    program). One build then serves the whole campaign. The manifest maps
+//    each mutant ID to its (funcID, bbID, insID) point and operator.
+//
+//    With `-fast-order=<k>` every mutant is a higher-order mutant made of k
+//    mutations at distinct points, applied together in one pass (in batch
+//    lists every k consecutive entries form one mutant). The points are all
+//    resolved before any of them is mutated.
+//
+//    With `-fast-coverage=<profile>` points in blocks the tests never
+//    executed are dropped before any point is picked (their mutants would
+//    survive anyway), or kept with a lower weight given by
+//    `-fast-uncovered-weight`. The profile is per block or per function
+//    (e.g. the output of DynamicCallCounter), see CoverageProfile.h.
+//
+//    Random choices are drawn from a counter-based generator (MutantRNG.h)
+//    keyed by the campaign seed and the mutant index, so any mutant can be
+//    regenerated from `-fast-seed`/`-fast-mutant-index` alone, and
+//    independent runs or threads never share generator state. Both values
+//    are logged and attached to the mutant as `!fast.mutant` metadata.
 //
 // USAGE:
 //    1. Legacy pass manager:
 //      $ opt -load <BUILD_DIR>/lib/libInjectFuncCall.so --legacy-inject-func-call <bitcode-file>
 //    2. New pass maanger:
 //      $ opt -load-pass-plugin <BUILD_DIR>/lib/libInjectFunctCall.so -passes=-"inject-func-call" <bitcode-file>
+//    3. Batch mode (either pass manager):
+//      $ opt -load <BUILD_DIR>/lib/libInjectFuncCall.so --legacy-inject-func-call
+//        -fast-batch-list=<list-file> -fast-batch-dir=<dir> -disable-output <bitcode-file>
+//      $ opt -load <BUILD_DIR>/lib/libInjectFuncCall.so --legacy-inject-func-call
+//        -fast-batch-count=<N> -fast-batch-dir=<dir> -disable-output <bitcode-file>
+//    4. Sample mode (either pass manager):
+//      $ opt -load <BUILD_DIR>/lib/libInjectFuncCall.so --legacy-inject-func-call
+//        -fast-sample <bitcode-file> -o new.bc
+//    5. Enumerate mode (either pass manager):
+//      $ opt -load <BUILD_DIR>/lib/libInjectFuncCall.so --legacy-inject-func-call
+//        -fast-enumerate=fast_mutate.txt <bitcode-file> -o annotated.bc
+//    6. Schemata mode (either pass manager):
+//      $ opt -load <BUILD_DIR>/lib/libInjectFuncCall.so --legacy-inject-func-call
+//        -fast-schemata -fast-schemata-manifest=<file> <bitcode-file> -o meta.bc
+//      $ FAST_MUTANT_ID=<id> ./meta
+//    7. Regenerating a mutant (any of the random modes above):
+//      $ opt -load <BUILD_DIR>/lib/libInjectFuncCall.so --legacy-inject-func-call
+//        -fast-seed=<seed> -fast-mutant-index=<k> <bitcode-file> -o new.bc
 //
 // License: MIT
 //========================================================================
@@ -32,24 +83,117 @@
 #include <iostream>
 #include <fstream>
 #include <string>
-#include <regex>
 #include <random>
 #include <cstdio>
 #include <cstdarg>
 #include <cstdlib>
-#include <ctime>
 
 #include "InjectFuncCall.h"
+#include "MutantRNG.h"
+#include "MutationOperators.h"
+#include "MutationScheduler.h"
 
+#include "llvm/Bitcode/BitcodeWriter.h"
 #include "llvm/IR/IRBuilder.h"
 #include "llvm/IR/Constants.h"
 #include "llvm/Passes/PassPlugin.h"
 #include "llvm/Passes/PassBuilder.h"
+#include "llvm/Support/CommandLine.h"
+#include "llvm/Support/FileSystem.h"
+#include "llvm/Support/Path.h"
+#include "llvm/Support/raw_ostream.h"
+#include "llvm/Transforms/Utils/ModuleUtils.h"
 
 using namespace llvm;
 
 #define DEBUG_TYPE "inject-func-call"
 
+//-----------------------------------------------------------------------------
+// Command line options
+//-----------------------------------------------------------------------------
+static cl::opt<std::string> PointFile{
+    "fast-points", cl::desc("The mutation point file to pick points from"),
+    cl::value_desc("filename"), cl::init("fast_mutate.txt")};
+
+static cl::opt<std::string> BatchList{
+    "fast-batch-list",
+    cl::desc("Generate one mutant per (point, operator) entry of this file"),
+    cl::value_desc("filename"), cl::init("")};
+
+static cl::opt<unsigned> BatchCount{
+    "fast-batch-count",
+    cl::desc("Generate this many mutants from random points of the point "
+             "file"),
+    cl::value_desc("N"), cl::init(0)};
+
+static cl::opt<std::string> BatchDir{
+    "fast-batch-dir", cl::desc("The directory batch mutants are written to"),
+    cl::value_desc("directory"), cl::init(".")};
+
+static cl::opt<std::string> EnumerateFile{
+    "fast-enumerate",
+    cl::desc("Attach a stable ID to every mutation point and write the "
+             "points to this file"),
+    cl::value_desc("filename"), cl::init("")};
+
+static cl::opt<bool> Sample{
+    "fast-sample",
+    cl::desc("Pick the mutation point while walking the module (reservoir "
+             "sampling) instead of reading a point file"),
+    cl::init(false)};
+
+static cl::opt<bool> Schemata{
+    "fast-schemata",
+    cl::desc("Compile every mutant into the module, selected at runtime via "
+             "the FAST_MUTANT_ID environment variable"),
+    cl::init(false)};
+
+static cl::opt<std::string> SchemataManifest{
+    "fast-schemata-manifest",
+    cl::desc("The file that maps every schemata mutant ID to its point"),
+    cl::value_desc("filename"), cl::init("fast_schemata.txt")};
+
+static cl::opt<unsigned long long> Seed{
+    "fast-seed",
+    cl::desc("The campaign seed (a fresh one is drawn and logged if not "
+             "given)"),
+    cl::value_desc("seed"), cl::init(0)};
+
+static cl::opt<unsigned long long> MutantIndex{
+    "fast-mutant-index",
+    cl::desc("The index of the (first) mutant within the campaign"),
+    cl::value_desc("k"), cl::init(0)};
+
+static cl::opt<unsigned> Order{
+    "fast-order",
+    cl::desc("Apply this many mutations per mutant (higher-order mutants)"),
+    cl::value_desc("k"), cl::init(1)};
+
+static cl::opt<std::string> CoverageFile{
+    "fast-coverage",
+    cl::desc("Only pick points in blocks executed according to this "
+             "coverage profile (per block or per function)"),
+    cl::value_desc("filename"), cl::init("")};
+
+static cl::opt<double> UncoveredWeight{
+    "fast-uncovered-weight",
+    cl::desc("The weight of points in unexecuted blocks relative to "
+             "executed ones (0, the default, drops them)"),
+    cl::value_desc("w"), cl::init(0)};
+
+static cl::opt<std::string> SchedulerState{
+    "fast-scheduler",
+    cl::desc("Pick points and operators adaptively from the outcomes "
+             "recorded in this scheduler state file (see fast-sched)"),
+    cl::value_desc("filename"), cl::init("")};
+
+static cl::opt<MutationScheduler::Policy> SchedulerPolicy{
+    "fast-scheduler-policy", cl::desc("The adaptive scheduling policy"),
+    cl::values(clEnumValN(MutationScheduler::UCB, "ucb", "UCB1"),
+               clEnumValN(MutationScheduler::Thompson, "thompson",
+                          "Thompson sampling")),
+    cl::init(MutationScheduler::UCB)};
+
 // 日志函数 by cyh --- start
 class Logger {
   public:
@@ -73,420 +217,598 @@ class Logger {
 };
 // 日志函数 by cyh --- end
 
+// 初始化日志类
+static Logger logger(true);
+
+// The seed given on the command line, or a fresh one
+static uint64_t getCampaignSeed() {
+  if (Seed.getNumOccurrences())
+    return Seed;
+  std::random_device Device;
+  return (uint64_t(Device()) << 32) | Device();
+}
+
+// The weight of a point in block BBID of F: 1 if the block was executed,
+// UncoveredWeight otherwise
+static double getCoverageWeight(const CoverageProfile &Profile,
+                                const Function &F, unsigned BBID) {
+  return Profile.isExecuted(F.getName(), BBID) ? 1.0 : UncoveredWeight;
+}
+
+// The coverage weight of every entry of Points (0 for points that are not
+// in M). Exits if no point can be picked.
+static std::vector<double> getCoverageWeights(Module &M,
+                                              const MutationPointList &Points,
+                                              const CoverageProfile &Profile) {
+  // Points may be stable IDs, so their block is found from the instruction
+  DenseMap<const BasicBlock *, unsigned> BBIDs;
+  for (Function &F : M) {
+    unsigned bbID = 0;
+    for (BasicBlock &BB : F)
+      BBIDs[&BB] = bbID++;
+  }
+
+  MutationPointIndex Index(M);
+  std::vector<double> Weights(Points.size(), 0);
+  size_t NumCovered = 0;
+  for (size_t Idx = 0; Idx < Points.size(); Idx++) {
+    Instruction *Ins = Index.lookup(Points[Idx]);
+    if (!Ins)
+      continue;
+    const BasicBlock *BB = Ins->getParent();
+    const Function &F = *BB->getParent();
+    if (Profile.isExecuted(F.getName(), BBIDs[BB]))
+      NumCovered++;
+    Weights[Idx] = getCoverageWeight(Profile, F, BBIDs[BB]);
+  }
+
+  logger.log("%zu of %zu mutation points are covered\n", NumCovered,
+             Points.size());
+  if (WeightedPointSampler(Weights).empty()) {
+    std::cerr << "No covered mutation point in " << PointFile << "\n";
+    exit(1);
+  }
+  return Weights;
+}
+
+// Picks Count mutants of Order points (and operators) each from Points with
+// the adaptive scheduler, using MutantRNG(Seed, FirstIndex + K) for mutant K.
+// Same layout as drawMutationPoints. Unlike there, the picks are sequential:
+// the picks of mutants 0 .. K-1 count as pending plays when mutant K is
+// picked (so that a batch does not pile up on one arm), so mutant K depends
+// on the whole batch before it and a single mutant run with the same index
+// does not reproduce it. Weights, if not empty, are the coverage weights of
+// Points.
+static std::vector<MutationPoint>
+schedulePoints(Module &M, const MutationPointList &Points, uint64_t Seed,
+               uint64_t FirstIndex, uint64_t Count,
+               ArrayRef<double> Weights = {}) {
+  MutationScheduler Scheduler(SchedulerPolicy);
+  if (!Scheduler.load(SchedulerState))
+    exit(1);
+
+  MutationPointIndex Index(M);
+  LoopInfoCache Loops;
+  std::vector<MutationPoint> Batch;
+  for (uint64_t K = 0; K < Count; K++) {
+    MutantRNG RNG(Seed, FirstIndex + K);
+    for (unsigned J = 0; J < Order; J++) {
+      MutationPoint Point = Points[Scheduler.pickPoint(Points, RNG, Weights)];
+      Instruction *Ins = Index.lookup(Point);
+      if (unsigned NumMutants = Ins ? getNumMutants(*Ins, &Loops) : 0)
+        Point.Operator = Scheduler.pickOperator(Point, NumMutants, RNG);
+      Batch.push_back(Point);
+    }
+  }
+  return Batch;
+}
+
+// Creates `@__fast_mutant_id` and a constructor that initialises it from the
+// FAST_MUTANT_ID environment variable. It is equivalent to:
+// ```C
+//    int __fast_mutant_id = 0;
+//    void __fast_mutant_init() {
+//      char *Id = getenv("FAST_MUTANT_ID");
+//      if (Id)
+//        __fast_mutant_id = atoi(Id);
+//    }
+// ```
+// Both symbols are weak so that several schemata modules can be linked into
+// one program, and a harness can also write the global directly.
+static GlobalVariable *createMutantIDGlobal(Module &M) {
+  auto &CTX = M.getContext();
+  IntegerType *Int32Ty = Type::getInt32Ty(CTX);
+  PointerType *CharPtrTy = Type::getInt8PtrTy(CTX);
+
+  if (GlobalVariable *GV = M.getNamedGlobal("__fast_mutant_id"))
+    return GV;
+
+  auto *MutantID = new GlobalVariable(M, Int32Ty, /*isConstant=*/false,
+                                      GlobalValue::WeakAnyLinkage,
+                                      ConstantInt::get(Int32Ty, 0),
+                                      "__fast_mutant_id");
+
+  FunctionCallee Getenv = M.getOrInsertFunction(
+      "getenv", FunctionType::get(CharPtrTy, {CharPtrTy}, false));
+  FunctionCallee Atoi = M.getOrInsertFunction(
+      "atoi", FunctionType::get(Int32Ty, {CharPtrTy}, false));
+
+  Function *InitF = Function::Create(
+      FunctionType::get(Type::getVoidTy(CTX), {}, false),
+      GlobalValue::WeakAnyLinkage, "__fast_mutant_init", M);
+  BasicBlock *Entry = BasicBlock::Create(CTX, "entry", InitF);
+  BasicBlock *Set = BasicBlock::Create(CTX, "set", InitF);
+  BasicBlock *Ret = BasicBlock::Create(CTX, "ret", InitF);
+
+  IRBuilder<> Builder(Entry);
+  Value *Env = Builder.CreateCall(
+      Getenv, {Builder.CreateGlobalStringPtr("FAST_MUTANT_ID")});
+  Builder.CreateCondBr(Builder.CreateIsNull(Env), Ret, Set);
+
+  Builder.SetInsertPoint(Set);
+  Builder.CreateStore(Builder.CreateCall(Atoi, {Env}), MutantID);
+  Builder.CreateBr(Ret);
+
+  Builder.SetInsertPoint(Ret);
+  Builder.CreateRetVoid();
+
+  appendToGlobalCtors(M, InitF, /*Priority=*/0);
+  return MutantID;
+}
+
 //-----------------------------------------------------------------------------
 // InjectFuncCall implementation
 //-----------------------------------------------------------------------------
-bool InjectFuncCall::runOnModule(Module &M) {
-
-  // 初始化日志类
-  Logger logger(true);
+unsigned InjectFuncCall::mutateInstructions(
+    ArrayRef<std::pair<Instruction *, MutationPoint>> Targets,
+    MutationTransaction &Txn, MutantRNG &RNG,
+    std::vector<std::string> &Applied, LoopInfoCache *Loops) {
+  // 先为所有突变点选好算子并检查它们能否同时突变，不能则整个突变体作废，
+  // 而不是悄悄地生成一个阶数更低的突变体
+  MutantPlan Plan;
+  Plan.Targets.assign(Targets.begin(), Targets.end());
+  std::string Error;
+  if (!selectMutations(Plan, RNG, Loops, Error)) {
+    logger.log("mutant dropped: %s\n", Error.c_str());
+    return 0;
+  }
 
-  // 初始化随机数种子
-  srand(time(NULL)); // seed the random number generator with the current time
+  for (size_t Idx = 0; Idx < Plan.Sels.size(); Idx++)
+    logger.log("%s\n", describeMutation(*Plan.Targets[Idx].first,
+                                        Plan.Sels[Idx], Loops)
+                           .c_str());
+  applyMutations(Plan, Txn, Loops, Applied);
+  return Plan.Sels.size();
+}
 
-  // 一个三元组Vector，用来储存所有的突变点
-  std::vector<std::tuple<int, int, int>> MutationPoints;
+bool InjectFuncCall::runBatch(Module &M,
+                              const std::vector<MutationPoint> &Batch,
+                              uint64_t CampaignSeed) {
+  std::error_code EC = sys::fs::create_directories(BatchDir);
+  if (EC) {
+    std::cerr << "Failed to create batch directory " << BatchDir << "\n";
+    exit(1);
+  }
 
-  // 用来解析突变点文件的正则表达式 
-  std::regex pattern("\\((\\d+),\\s*(\\d+),\\s*(\\d+)\\)");
+  SmallString<128> LogPath(BatchDir);
+  sys::path::append(LogPath, "mutants.txt");
+  raw_fd_ostream BatchLog(LogPath, EC, sys::fs::OF_None);
+  if (EC) {
+    std::cerr << "Failed to open " << LogPath.str().str() << "\n";
+    exit(1);
+  }
+  BatchLog << "# seed " << CampaignSeed << " first-index " << MutantIndex
+           << "\n";
+
+  // Built once, shared by every mutant of the batch
+  MutationPointIndex Index(M);
+  LoopInfoCache Loops;
+
+  // Every Order consecutive entries form one mutant
+  unsigned NumMutants = 0;
+  for (size_t K = 0; K * Order < Batch.size(); K++) {
+    std::vector<std::pair<Instruction *, MutationPoint>> Targets;
+    for (size_t Idx = K * Order;
+         Idx < std::min<size_t>((K + 1) * Order, Batch.size()); Idx++)
+      Targets.emplace_back(Index.lookup(Batch[Idx]), Batch[Idx]);
+
+    // The mutations are applied to M in place and rolled back once the
+    // mutant has been written, so every mutant starts from the unmodified
+    // module. Mutant K only depends on (seed, first index + K).
+    MutantRNG RNG(CampaignSeed, MutantIndex + K);
+    MutationTransaction Txn;
+    std::vector<std::string> Applied;
+    if (mutateInstructions(Targets, Txn, RNG, Applied, &Loops) == 0)
+      continue;
 
-  // 读取 Mutation Point 文件
-  std::ifstream file("fast_mutate.txt"); // open the file
-  if (file.is_open()) { // check if the file was opened successfully
-    std::string line;
-    while (std::getline(file, line)) { // read each line of the file
-      std::smatch matches;
-      if (std::regex_match(line, matches, pattern)) {
-        std::tuple<int, int, int> point(std::stoi(matches[1]), std::stoi(matches[2]), std::stoi(matches[3]));
-        MutationPoints.push_back(point);
-      }
-      else {
-        std::cerr << "Regex cannot parse\n";
-        exit(1);
-      }
+    SmallString<128> MutantPath(BatchDir);
+    sys::path::append(MutantPath, "mutant-" + std::to_string(K) + ".bc");
+    raw_fd_ostream Out(MutantPath, EC, sys::fs::OF_None);
+    if (EC) {
+      std::cerr << "Failed to open " << MutantPath.str().str() << "\n";
+      exit(1);
     }
-    file.close(); // close the file when we're done
-  } else {
-    std::cerr << "Failed to open mutation point file\n";
+    setMutantMetadata(M, RNG.getSeed(), RNG.getIndex(), Applied);
+    WriteBitcodeToFile(M, Out);
+    eraseMutantMetadata(M);
+    Txn.revert();
+
+    BatchLog << sys::path::filename(MutantPath);
+    for (const std::string &Mutation : Applied)
+      BatchLog << " " << Mutation;
+    BatchLog << "\n";
+    NumMutants++;
+  }
+
+  logger.log("generated %u mutants in %s\n", NumMutants, BatchDir.c_str());
+  return false;
+}
+
+bool InjectFuncCall::runEnumerate(Module &M) {
+  std::ofstream Out(EnumerateFile);
+  if (!Out.is_open()) {
+    std::cerr << "Failed to open " << EnumerateFile << "\n";
     exit(1);
   }
 
-  int index = rand() % MutationPoints.size();
+  // Points that already carry an ID (e.g. the module was enumerated before)
+  // keep it, new points get IDs above the largest one in use
+  uint64_t NextID = 0;
+  for (auto &Func : M)
+    for (auto &BB : Func)
+      for (auto &Ins : BB) {
+        uint64_t ID;
+        if (getStableID(Ins, ID) && ID >= NextID)
+          NextID = ID + 1;
+      }
 
-  // 抽取随机突变点
-  std::tuple<int, int, int> random_point = MutationPoints[index];
+  bool Changed = false;
+  unsigned NumPoints = 0;
+  LoopInfoCache Loops;
+  uint32_t funcID = 0;
+  for (auto &Func : M) {
+    uint32_t bbID = 0;
+    for (auto &BB : Func) {
+      uint32_t insID = 0;
+      for (auto &Ins : BB) {
+        if (getNumMutants(Ins, &Loops) > 0) {
+          uint64_t ID;
+          if (!getStableID(Ins, ID)) {
+            ID = NextID++;
+            setStableID(Ins, ID);
+            Changed = true;
+          }
+          Out << "mp:" << ID << " # (" << funcID << ", " << bbID << ", "
+              << insID << ") " << Ins.getOpcodeName() << "\n";
+          NumPoints++;
+        }
+        insID++;
+      }
+      bbID++;
+    }
+    funcID++;
+  }
 
-  // If program reach here, means reading mutationPoint file successfully
-  logger.log("the mutation point selected is (%d, %d, %d)\n", 
-    std::get<0>(random_point), std::get<1>(random_point), std::get<2>(random_point));
+  logger.log("enumerated %u mutation points (%zu constant operands)\n",
+             NumPoints, ConstantOperandTable(M).size());
+  return Changed;
+}
 
-  // 初始化突变选择子
-  int mutate_sel = -1;
-  // 标注是否修改
-  bool modified = false;
+bool InjectFuncCall::runSchemata(Module &M) {
+  std::ofstream Manifest(SchemataManifest);
+  if (!Manifest.is_open()) {
+    std::cerr << "Failed to open " << SchemataManifest << "\n";
+    exit(1);
+  }
 
-  int funcID = 0;
-  
+  // A point to rewrite. Branches are resolved here, on the original CFG:
+  // rewriting a branch adds edges, after which the loops of the function no
+  // longer have the latch and exits the break/continue targets are read from
+  struct SchemataPoint {
+    Instruction *Ins;
+    MutationPoint Point;
+    BasicBlock *Retarget;
+    std::string BranchDescription;
+  };
+
+  // Collect the points first: the rewrite below inserts instructions and
+  // would shift the (funcID, bbID, insID) numbering of later points
+  std::vector<SchemataPoint> Points;
+  LoopInfoCache Loops;
+  uint32_t funcID = 0;
   for (auto &Func : M) {
+    uint32_t bbID = 0;
+    for (auto &BB : Func) {
+      uint32_t insID = 0;
+      for (auto &Ins : BB) {
+        if (getNumMutants(Ins, &Loops) > 0) {
+          SchemataPoint Entry{&Ins, MutationPoint(), nullptr, ""};
+          Entry.Point.FuncID = funcID;
+          Entry.Point.BBID = bbID;
+          Entry.Point.InsID = insID;
+          auto *Br = dyn_cast<BranchInst>(&Ins);
+          if (Br) {
+            if (Br->isUnconditional())
+              Entry.Retarget = getBranchRetarget(*Br, Loops);
+            Entry.BranchDescription = describeMutation(*Br, 0, &Loops);
+          }
+          if (!Br || Br->isConditional() || Entry.Retarget)
+            Points.push_back(std::move(Entry));
+        }
+        insID++;
+      }
+      bbID++;
+    }
+    funcID++;
+  }
 
-    if(funcID != std::get<0>(random_point)) {
-      funcID++;
+  if (Points.empty())
+    return false;
+
+  GlobalVariable *MutantID = createMutantIDGlobal(M);
+
+  // Rewrite every point into a chain of selects on the mutant ID:
+  //    %id = load i32, i32* @__fast_mutant_id
+  //    %is1 = icmp eq i32 %id, 1
+  //    %m1 = <mutant 1 of %orig>
+  //    %s1 = select i1 %is1, %m1, %orig
+  //    %is2 = icmp eq i32 %id, 2
+  //    %m2 = <mutant 2 of %orig>
+  //    %s2 = select i1 %is2, %m2, %s1
+  //    ...
+  // and use the last select wherever the original value was used. ID 0 is
+  // the original program. Constant mutants select the operand instead, in
+  // front of the instruction:
+  //    %c3 = select i1 %is3, i32 <new constant>, i32 <constant>
+  // and branches select their condition or successor:
+  //    %c4 = xor i1 %cond, %is4                     (swapped branches)
+  //    br i1 %is5, label %exit, label %latch        (continue -> break)
+  unsigned NextID = 1;
+  for (auto &Entry : Points) {
+    Instruction *Ins = Entry.Ins;
+    const MutationPoint &Point = Entry.Point;
+
+    // A branch has a single mutant and no value
+    if (auto *Br = dyn_cast<BranchInst>(Ins)) {
+      Manifest << NextID << " (" << Point.FuncID << ", " << Point.BBID << ", "
+               << Point.InsID << ") " << Entry.BranchDescription << "\n";
+
+      IRBuilder<> Builder(Br);
+      Value *ID = Builder.CreateLoad(Builder.getInt32Ty(), MutantID);
+      Value *IsSelected = Builder.CreateICmpEQ(ID, Builder.getInt32(NextID));
+      if (Br->isConditional()) {
+        Br->setCondition(Builder.CreateXor(Br->getCondition(), IsSelected));
+      } else {
+        Builder.CreateCondBr(IsSelected, Entry.Retarget, Br->getSuccessor(0));
+        Br->eraseFromParent();
+      }
+      NextID++;
       continue;
     }
 
-    int bbID = 0;
+    SmallVector<Use *, 8> OrigUses;
+    for (Use &U : Ins->uses())
+      OrigUses.push_back(&U);
+
+    // Rewriting an operand hides its constant from the operator table, so
+    // the constant mutants are resolved up front
+    unsigned NumMutants = getNumMutants(*Ins, &Loops);
+    std::vector<std::pair<ConstantInt *, unsigned>> ConstantMutants(
+        NumMutants);
+    std::vector<std::string> Descriptions;
+    for (unsigned Sel = 0; Sel < NumMutants; Sel++) {
+      ConstantMutants[Sel].first =
+          getConstantMutant(*Ins, Sel, ConstantMutants[Sel].second, &Loops);
+      Descriptions.push_back(describeMutation(*Ins, Sel, &Loops));
+    }
+
+    // A terminator (`ret 7`, the arguments of an invoke) only has constant
+    // mutants, which select the operand in front of it
+    IRBuilder<> Builder(Ins->isTerminator() ? Ins : Ins->getNextNode());
+    IRBuilder<> OperandBuilder(Ins);
+    Value *ID = nullptr;
+    Value *OperandID = nullptr;
+    Value *Selected = Ins;
+    for (unsigned Sel = 0; Sel < NumMutants; Sel++) {
+      if (ConstantInt *C = ConstantMutants[Sel].first) {
+        unsigned OperandIdx = ConstantMutants[Sel].second;
+        if (!OperandID)
+          OperandID =
+              OperandBuilder.CreateLoad(Builder.getInt32Ty(), MutantID);
+        Value *IsSelected =
+            OperandBuilder.CreateICmpEQ(OperandID, Builder.getInt32(NextID));
+        Ins->setOperand(OperandIdx,
+                        OperandBuilder.CreateSelect(
+                            IsSelected, C, Ins->getOperand(OperandIdx)));
+      } else {
+        assert(!Ins->isTerminator() && "value mutant of a terminator");
+        if (!ID)
+          ID = Builder.CreateLoad(Builder.getInt32Ty(), MutantID);
+        Value *IsSelected =
+            Builder.CreateICmpEQ(ID, Builder.getInt32(NextID));
+        Value *Mutant = createMutantValue(Builder, *Ins, Sel, IsSelected);
+        Selected = Builder.CreateSelect(IsSelected, Mutant, Selected);
+      }
 
-    for (auto &BB : Func) {
+      Manifest << NextID << " (" << Point.FuncID << ", " << Point.BBID << ", "
+               << Point.InsID << ") " << Descriptions[Sel] << "\n";
+      NextID++;
+    }
+
+    for (Use *U : OrigUses)
+      U->set(Selected);
+  }
+
+  logger.log("compiled %u mutants into the module\n", NextID - 1);
+  return true;
+}
 
-      if(bbID != std::get<1>(random_point)) {
+bool InjectFuncCall::runSample(Module &M, MutantRNG &RNG,
+                               const CoverageProfile *Coverage) {
+  // Reservoir sampling with a reservoir of Order slots: the first Order
+  // eligible instructions fill it, then the n-th one replaces a random slot
+  // with probability Order/n, which makes every subset of Order eligible
+  // instructions equally likely to be picked in a single walk. Instructions
+  // in unexecuted blocks are only eligible with probability UncoveredWeight
+  std::vector<std::pair<Instruction *, MutationPoint>> Picked;
+  uint64_t NumEligible = 0;
+  LoopInfoCache Loops;
+
+  uint32_t funcID = 0;
+  for (auto &Func : M) {
+    uint32_t bbID = 0;
+    for (auto &BB : Func) {
+      // 覆盖率过滤：未执行的基本块按权重保留（权重为 0 时整块跳过）
+      double Weight = Coverage ? getCoverageWeight(*Coverage, Func, bbID) : 1;
+      if (Weight <= 0) {
         bbID++;
         continue;
       }
 
-      int insID = 0;
-
+      uint32_t insID = 0;
       for (auto &Ins : BB) {
-
-        if(insID != std::get<2>(random_point)) {
-          insID++;
-          continue;
+        if (getNumMutants(Ins, &Loops) > 0 &&
+            (Weight >= 1 || RNG.uniformReal() < Weight)) {
+          MutationPoint Point;
+          Point.FuncID = funcID;
+          Point.BBID = bbID;
+          Point.InsID = insID;
+
+          uint64_t Slot = RNG.uniform(++NumEligible);
+          if (NumEligible <= Order)
+            Picked.emplace_back(&Ins, Point);
+          else if (Slot < Order)
+            Picked[Slot] = std::make_pair(&Ins, Point);
         }
+        insID++;
+      }
+      bbID++;
+    }
+    funcID++;
+  }
 
-        if (isa<ICmpInst>(&Ins)) {  
-          // MutationPoints.push_back(std::make_tuple(functionName, bbcounter, icounter));
-          // This is an icmp instruction
-          ICmpInst *icmpInst = cast<ICmpInst>(&Ins);
-          // Get the icmp predicate
-          CmpInst::Predicate predicate = icmpInst->getPredicate();
-          // Print the corresponding string representation of the predicate
-          switch (predicate) {
-            // 2 Not ! Drop the operator        作为 icmp ne 处理，即 value != 0
-            // 19 Neq != ==
-            case CmpInst::ICMP_NE:
-              icmpInst->setPredicate(CmpInst::ICMP_EQ);
-              modified = true;
-              logger.log("icmp ne\n");
-              break;
-            // 14 Lt < One of <=, >=, >, ==, !=
-            case CmpInst::ICMP_SLT:
-              mutate_sel = rand() % 5;
-              if(0 == mutate_sel)
-                icmpInst->setPredicate(CmpInst::ICMP_SLE);
-              else if(1 == mutate_sel)
-                icmpInst->setPredicate(CmpInst::ICMP_SGE);
-              else if(2 == mutate_sel)
-                icmpInst->setPredicate(CmpInst::ICMP_SGT);
-              else if(3 == mutate_sel)
-                icmpInst->setPredicate(CmpInst::ICMP_EQ);
-              else
-                icmpInst->setPredicate(CmpInst::ICMP_NE);
-              modified = true;
-              logger.log("icmp slt\n");
-              break;
-            case CmpInst::ICMP_ULT:
-              mutate_sel = rand() % 5;
-              if(0 == mutate_sel)
-                icmpInst->setPredicate(CmpInst::ICMP_ULE);
-              else if(1 == mutate_sel)
-                icmpInst->setPredicate(CmpInst::ICMP_UGE);
-              else if(2 == mutate_sel)
-                icmpInst->setPredicate(CmpInst::ICMP_UGT);
-              else if(3 == mutate_sel)
-                icmpInst->setPredicate(CmpInst::ICMP_EQ);
-              else
-                icmpInst->setPredicate(CmpInst::ICMP_NE);
-              modified = true;
-              logger.log("icmp ult\n");
-              break;
-            // 15 Le <= One of <, >=, >, ==, !=
-            case CmpInst::ICMP_SLE:
-              mutate_sel = rand() % 5;
-              if(0 == mutate_sel)
-                icmpInst->setPredicate(CmpInst::ICMP_SLT);
-              else if(1 == mutate_sel)
-                icmpInst->setPredicate(CmpInst::ICMP_SGE);
-              else if(2 == mutate_sel)
-                icmpInst->setPredicate(CmpInst::ICMP_SGT);
-              else if(3 == mutate_sel)
-                icmpInst->setPredicate(CmpInst::ICMP_EQ);
-              else
-                icmpInst->setPredicate(CmpInst::ICMP_NE);
-              modified = true;
-              logger.log("icmp sle\n");
-              break;
-            case CmpInst::ICMP_ULE:
-              mutate_sel = rand() % 5;
-              if(0 == mutate_sel)
-                icmpInst->setPredicate(CmpInst::ICMP_ULT);
-              else if(1 == mutate_sel)
-                icmpInst->setPredicate(CmpInst::ICMP_UGE);
-              else if(2 == mutate_sel)
-                icmpInst->setPredicate(CmpInst::ICMP_UGT);
-              else if(3 == mutate_sel)
-                icmpInst->setPredicate(CmpInst::ICMP_EQ);
-              else
-                icmpInst->setPredicate(CmpInst::ICMP_NE);
-              modified = true;
-              logger.log("icmp ule\n");
-              break;
-            // 16 Ge >= One of <, <=, >, ==, !=
-            case CmpInst::ICMP_SGE:
-              mutate_sel = rand() % 5;
-              if(0 == mutate_sel)
-                icmpInst->setPredicate(CmpInst::ICMP_SLT);
-              else if(1 == mutate_sel)
-                icmpInst->setPredicate(CmpInst::ICMP_SLE);
-              else if(2 == mutate_sel)
-                icmpInst->setPredicate(CmpInst::ICMP_SGT);
-              else if(3 == mutate_sel)
-                icmpInst->setPredicate(CmpInst::ICMP_EQ);
-              else
-                icmpInst->setPredicate(CmpInst::ICMP_NE);
-              modified = true;
-              logger.log("icmp sge\n");
-              break;
-            case CmpInst::ICMP_UGE:
-              mutate_sel = rand() % 5;
-              if(0 == mutate_sel)
-                icmpInst->setPredicate(CmpInst::ICMP_ULT);
-              else if(1 == mutate_sel)
-                icmpInst->setPredicate(CmpInst::ICMP_ULE);
-              else if(2 == mutate_sel)
-                icmpInst->setPredicate(CmpInst::ICMP_UGT);
-              else if(3 == mutate_sel)
-                icmpInst->setPredicate(CmpInst::ICMP_EQ);
-              else
-                icmpInst->setPredicate(CmpInst::ICMP_NE);
-              modified = true;
-              logger.log("icmp uge\n");
-              break;
-            // 17 Gt > One of <, <=, >=, ==, !=
-            case CmpInst::ICMP_SGT:
-              mutate_sel = rand() % 5;
-              if(0 == mutate_sel)
-                icmpInst->setPredicate(CmpInst::ICMP_SLT);
-              else if(1 == mutate_sel)
-                icmpInst->setPredicate(CmpInst::ICMP_SLE);
-              else if(2 == mutate_sel)
-                icmpInst->setPredicate(CmpInst::ICMP_SGE);
-              else if(3 == mutate_sel)
-                icmpInst->setPredicate(CmpInst::ICMP_EQ);
-              else
-                icmpInst->setPredicate(CmpInst::ICMP_NE);
-              modified = true;
-              logger.log("icmp sgt\n");
-              break;
-            case CmpInst::ICMP_UGT:
-              mutate_sel = rand() % 5;
-              if(0 == mutate_sel)
-                icmpInst->setPredicate(CmpInst::ICMP_ULT);
-              else if(1 == mutate_sel)
-                icmpInst->setPredicate(CmpInst::ICMP_ULE);
-              else if(2 == mutate_sel)
-                icmpInst->setPredicate(CmpInst::ICMP_UGE);
-              else if(3 == mutate_sel)
-                icmpInst->setPredicate(CmpInst::ICMP_EQ);
-              else
-                icmpInst->setPredicate(CmpInst::ICMP_NE);
-              modified = true;
-              logger.log("icmp ugt\n");
-              break;
-            // 18 Equality Eq == !=
-            case CmpInst::ICMP_EQ:
-              icmpInst->setPredicate(CmpInst::ICMP_NE);
-              modified = true;
-              logger.log("icmp eq\n");
-              break;
-            default:
-              logger.log("unknown icmp predicate\n");
-              continue;
-              break;
-          }
-        }
-        else if (auto *op = dyn_cast<UnaryOperator>(&Ins)) { 
-          errs() << "Unary operator: " << op->getOpcodeName() << "\n";
-        }
-        else {
+  if (Picked.empty()) {
+    logger.log("no mutation point in the module\n");
+    return false;
+  }
 
-        }
-        // else if (auto *op = dyn_cast<BinaryOperator>(&Ins)) { 
-        //   // 初始化 IRBuilder
-        //   IRBuilder<> builder(op);
-        //   Value* lhs = op->getOperand(0);
-        //   Value* rhs = op->getOperand(1);
-        //   Value* newop = NULL;
-
-        //   switch (op->getOpcode()) {
-        //     // 1 Unary Neg - Drop the operator  似乎作为 0 - operand 了，突变相当于改成 + 号
-        //     // 4 Sub - One of +, *, /, %
-        //     // TODO: 没有做有符号/无符号的区分
-        //     case Instruction::Sub:
-        //       mutate_sel = rand() % 4;
-        //       if(0 == mutate_sel)
-        //         newop = builder.CreateAdd(lhs, rhs);
-        //       else if(1 == mutate_sel)
-        //         newop = builder.CreateMul(lhs, rhs);
-        //       else if(2 == mutate_sel)
-        //         newop = builder.CreateSDiv(lhs, rhs);
-        //       else
-        //         newop = builder.CreateSRem(lhs, rhs);
-        //       logger.log("cyh: sub\n");
-        //       break;
-        //     // 3 Add + One of -, *, /, %
-        //     case Instruction::Add:
-        //       mutate_sel = rand() % 4;
-        //       if(0 == mutate_sel)
-        //         newop = builder.CreateSub(lhs, rhs);
-        //       else if(1 == mutate_sel)
-        //         newop = builder.CreateMul(lhs, rhs);
-        //       else if(2 == mutate_sel)
-        //         newop = builder.CreateSDiv(lhs, rhs);
-        //       else
-        //         newop = builder.CreateSRem(lhs, rhs);
-        //       logger.log("cyh: add\n");
-        //       break;
-        //     // 5 mul * one of +, -, /, %
-        //     case Instruction::Mul:
-        //       mutate_sel = rand() % 4;
-        //       if(0 == mutate_sel)
-        //         newop = builder.CreateAdd(lhs, rhs);
-        //       else if(1 == mutate_sel)
-        //         newop = builder.CreateSub(lhs, rhs);
-        //       else if(2 == mutate_sel)
-        //         newop = builder.CreateSDiv(lhs, rhs);
-        //       else
-        //         newop = builder.CreateSRem(lhs, rhs);
-        //       logger.log("cyh: mul\n");
-        //       break;
-        //     // 6 div / one of +, -, *, %
-        //     case Instruction::SDiv:
-        //       mutate_sel = rand() % 4;
-        //       if(0 == mutate_sel)
-        //         newop = builder.CreateAdd(lhs, rhs);
-        //       else if(1 == mutate_sel)
-        //         newop = builder.CreateSub(lhs, rhs);
-        //       else if(2 == mutate_sel)
-        //         newop = builder.CreateMul(lhs, rhs);
-        //       else
-        //         newop = builder.CreateSRem(lhs, rhs);
-        //       logger.log("cyh: sdiv\n");
-        //       break;
-        //     case Instruction::UDiv:
-        //       mutate_sel = rand() % 4;
-        //       if(0 == mutate_sel)
-        //         newop = builder.CreateAdd(lhs, rhs);
-        //       else if(1 == mutate_sel)
-        //         newop = builder.CreateSub(lhs, rhs);
-        //       else if(2 == mutate_sel)
-        //         newop = builder.CreateMul(lhs, rhs);
-        //       else
-        //         newop = builder.CreateURem(lhs, rhs);
-        //       logger.log("cyh: udiv\n");
-        //       break;
-        //     // 7 mod % one of +, -, *, /
-        //     case Instruction::SRem:
-        //       mutate_sel = rand() % 4;
-        //       if(0 == mutate_sel)
-        //         newop = builder.CreateAdd(lhs, rhs);
-        //       else if(1 == mutate_sel)
-        //         newop = builder.CreateSub(lhs, rhs);
-        //       else if(2 == mutate_sel)
-        //         newop = builder.CreateMul(lhs, rhs);
-        //       else
-        //         newop = builder.CreateSDiv(lhs, rhs);
-        //       logger.log("cyh: srem\n");
-        //       break;
-        //     case Instruction::URem:
-        //       mutate_sel = rand() % 4;
-        //       if(0 == mutate_sel)
-        //         newop = builder.CreateAdd(lhs, rhs);
-        //       else if(1 == mutate_sel)
-        //         newop = builder.CreateSub(lhs, rhs);
-        //       else if(2 == mutate_sel)
-        //         newop = builder.CreateMul(lhs, rhs);
-        //       else
-        //         newop = builder.CreateUDiv(lhs, rhs);
-        //       logger.log("cyh: urem\n");
-        //       break;
-        //     // 8 bitand & one of |, ˆ
-        //     case Instruction::And:
-        //       mutate_sel = rand() % 2;
-        //       if(0 == mutate_sel)
-        //         newop = builder.CreateOr(lhs, rhs);
-        //       else
-        //         newop = builder.CreateXor(lhs, rhs);
-        //       logger.log("cyh: and\n");
-        //       break;
-        //     // 9 bitor | one of &, ˆ
-        //     case Instruction::Or:
-        //       mutate_sel = rand() % 2;
-        //       if(0 == mutate_sel)
-        //         newop = builder.CreateAnd(lhs, rhs);
-        //       else
-        //         newop = builder.CreateXor(lhs, rhs);
-        //       logger.log("cyh: or\n");
-        //       break;
-        //     // 10 bitxor ˆ one of &, |
-        //     case Instruction::Xor:
-        //       mutate_sel = rand() % 2;
-        //       if(0 == mutate_sel)
-        //         newop = builder.CreateAnd(lhs, rhs);
-        //       else
-        //         newop = builder.CreateOr(lhs, rhs);
-        //       logger.log("cyh: xor\n");
-        //       break;
-        //     // 11 shl « one of »l, »a
-        //     case Instruction::Shl:
-        //       mutate_sel = rand() % 2;
-        //       if(0 == mutate_sel)
-        //         newop = builder.CreateLShr(lhs, rhs);
-        //       else
-        //         newop = builder.CreateAShr(lhs, rhs);
-        //       logger.log("cyh: shl\n");
-        //       break;
-        //     // 12 lshr »l shl «
-        //     case Instruction::LShr:
-        //       newop = builder.CreateShl(lhs, rhs);
-        //       logger.log("cyh: lshr\n");
-        //       break;
-        //     // 13 ashr »a shl «
-        //     case Instruction::AShr:
-        //       newop = builder.CreateShl(lhs, rhs);
-        //       logger.log("cyh: ashr\n");
-        //       break;
-        //     default:
-        //       errs() << "Binary operator: " << op->getOpcodeName() << "\n";
-        //       continue;
-        //       break;
-        //   }
-
-        //   // Everywhere the old instruction was used as an operand, use our
-        //   // new multiply instruction instead.
-        //   for (auto& U : op->uses()) {
-        //     User* user = U.getUser();  // A User is anything with operands.
-        //     user->setOperand(U.getOperandNo(), newop);
-        //   }
-
-        //   (&Ins)->eraseFromParent(); // 删除旧指令
-
-        //   modified = true;
-
-        // }
+  for (const auto &Target : Picked)
+    logger.log("the mutation point selected is %s (out of %llu)\n",
+               formatPoint(Target.second).c_str(),
+               (unsigned long long)NumEligible);
+
+  MutationTransaction Txn;
+  std::vector<std::string> Applied;
+  if (mutateInstructions(Picked, Txn, RNG, Applied, &Loops) == 0)
+    return false;
+  setMutantMetadata(M, RNG.getSeed(), RNG.getIndex(), Applied);
+  return true;
+}
 
-        insID++;
+bool InjectFuncCall::runOnModule(Module &M) {
 
-      }
+  // 枚举模式：给每个突变点打上稳定 ID，并输出突变点列表
+  if (!EnumerateFile.empty())
+    return runEnumerate(M);
 
-      bbID++;
+  // 突变体模式：把所有突变点编译进同一个模块
+  if (Schemata)
+    return runSchemata(M);
 
-    }
+  if (Order == 0) {
+    std::cerr << "-fast-order has to be at least 1\n";
+    exit(1);
+  }
 
-    funcID++;
+  // 初始化随机数种子：以下模式的随机选择都由 (种子, 突变体编号) 决定
+  uint64_t CampaignSeed = getCampaignSeed();
+  logger.log("seed %llu, mutant index %llu\n",
+             (unsigned long long)CampaignSeed,
+             (unsigned long long)MutantIndex);
 
+  // 读取覆盖率文件：只在执行过的基本块中选择突变点
+  CoverageProfile Coverage;
+  if (!CoverageFile.empty() && !Coverage.load(CoverageFile))
+    exit(1);
+
+  // 采样模式：遍历模块的同时抽取突变点，不需要突变点文件
+  if (Sample) {
+    MutantRNG RNG(CampaignSeed, MutantIndex);
+    return runSample(M, RNG, CoverageFile.empty() ? nullptr : &Coverage);
+  }
+
+  // 批量模式：列表中的每一项生成一个突变体
+  if (!BatchList.empty()) {
+    std::vector<MutationPoint> Batch;
+    if (!readMutationPointFile(BatchList, Batch))
+      exit(1);
+    return runBatch(M, Batch, CampaignSeed);
   }
 
-  return modified;
+  // 读取 Mutation Point 文件
+  MutationPointList MutationPoints;
+  if (!MutationPoints.open(PointFile))
+    exit(1);
+
+  if (MutationPoints.empty()) {
+    std::cerr << "No mutation point in " << PointFile << "\n";
+    exit(1);
+  }
+
+  // 按覆盖率给每个突变点加权，未执行的突变点权重为 -fast-uncovered-weight
+  std::vector<double> Weights;
+  if (!CoverageFile.empty())
+    Weights = getCoverageWeights(M, MutationPoints, Coverage);
+  WeightedPointSampler Sampler(Weights);
+
+  // 批量模式：随机抽取 BatchCount 个突变点。突变体 K 的突变点和算子都取自
+  // 它自己的随机数流，这样单独重新生成突变体 K 时结果相同
+  // 指定了调度器状态文件时，按以往的测试结果自适应地选择突变点和算子（此时
+  // 突变体 K 还取决于它之前的突变体，见 schedulePoints）
+  if (BatchCount > 0) {
+    std::vector<MutationPoint> Batch;
+    if (!SchedulerState.empty())
+      Batch = schedulePoints(M, MutationPoints, CampaignSeed, MutantIndex,
+                             BatchCount, Weights);
+    else if (!Weights.empty())
+      Batch = drawMutationPoints(MutationPoints, Sampler, CampaignSeed,
+                                 MutantIndex, BatchCount, Order);
+    else
+      Batch = drawMutationPoints(MutationPoints, CampaignSeed, MutantIndex,
+                                 BatchCount, Order);
+    return runBatch(M, Batch, CampaignSeed);
+  }
+
+  // 抽取 Order 个随机突变点：与批量模式抽取方式相同，所以这里生成的突变体 K
+  // 与批量模式生成的突变体 K 完全一致（使用调度器时除外）
+  std::vector<MutationPoint> random_points;
+  if (!SchedulerState.empty())
+    random_points = schedulePoints(M, MutationPoints, CampaignSeed,
+                                   MutantIndex, 1, Weights);
+  else if (!Weights.empty())
+    random_points = drawMutationPoints(MutationPoints, Sampler, CampaignSeed,
+                                       MutantIndex, 1, Order);
+  else
+    random_points = drawMutationPoints(MutationPoints, CampaignSeed,
+                                       MutantIndex, 1, Order);
+
+  // If program reach here, means reading mutationPoint file successfully
+  MutationPointIndex Index(M);
+  LoopInfoCache Loops;
+  std::vector<std::pair<Instruction *, MutationPoint>> Targets;
+  for (const MutationPoint &Point : random_points) {
+    logger.log("the mutation point selected is %s\n",
+               formatPoint(Point).c_str());
+    Targets.emplace_back(Index.lookup(Point), Point);
+  }
 
+  MutantRNG RNG(CampaignSeed, MutantIndex);
+  MutationTransaction Txn;
+  std::vector<std::string> Applied;
+  if (mutateInstructions(Targets, Txn, RNG, Applied, &Loops) == 0)
+    return false;
+  setMutantMetadata(M, RNG.getSeed(), RNG.getIndex(), Applied);
+  return true;
 }
 
 PreservedAnalyses InjectFuncCall::run(llvm::Module &M,
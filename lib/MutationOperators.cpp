@@ -0,0 +1,757 @@
+//==============================================================================
+// FILE:
+//    MutationOperators.cpp
+//
+// DESCRIPTION:
+//    Implements the table-driven mutation operator engine declared in
+//    MutationOperators.h. The operator table is built at compile time from
+//    getBinaryRow/getICmpRow below; adding an operator only means adding a
+//    row there. The same goes for the operands the constant operators may
+//    mutate (getConstantOperandRow).
+//
+// License: MIT
+//==============================================================================
+#include "MutationOperators.h"
+
+#include "MutantRNG.h"
+
+#include "llvm/ADT/STLExtras.h"
+#include "llvm/ADT/SmallPtrSet.h"
+#include "llvm/ADT/SmallString.h"
+#include "llvm/IR/Constants.h"
+#include "llvm/IR/Instructions.h"
+#include "llvm/IR/IntrinsicInst.h"
+#include "llvm/IR/PatternMatch.h"
+#include "llvm/Support/EndianStream.h"
+#include "llvm/Support/raw_ostream.h"
+#include "llvm/Support/xxhash.h"
+
+using namespace llvm;
+using namespace llvm::PatternMatch;
+
+//-----------------------------------------------------------------------------
+// The operator table
+//-----------------------------------------------------------------------------
+namespace {
+constexpr unsigned NumBinaryOps =
+    Instruction::BinaryOpsEnd - Instruction::BinaryOpsBegin;
+constexpr unsigned NumICmpPredicates =
+    CmpInst::LAST_ICMP_PREDICATE - CmpInst::FIRST_ICMP_PREDICATE + 1;
+
+// Table rows for binary operators (categories 3 - 13 in table1.c)
+constexpr MutationOperator getBinaryRow(unsigned Opcode) {
+  switch (Opcode) {
+  // 3 Add + One of -, *, /, %
+  case Instruction::Add:
+    return {MC_Add, 4,
+            {Instruction::Sub, Instruction::Mul, Instruction::SDiv,
+             Instruction::SRem}};
+  // 4 Sub - One of +, *, /, %
+  case Instruction::Sub:
+    return {MC_Sub, 4,
+            {Instruction::Add, Instruction::Mul, Instruction::SDiv,
+             Instruction::SRem}};
+  // 5 Mul * One of +, -, /, %
+  case Instruction::Mul:
+    return {MC_Mul, 4,
+            {Instruction::Add, Instruction::Sub, Instruction::SDiv,
+             Instruction::SRem}};
+  // 6 Div / One of +, -, *, %
+  case Instruction::SDiv:
+    return {MC_Div, 4,
+            {Instruction::Add, Instruction::Sub, Instruction::Mul,
+             Instruction::SRem}};
+  case Instruction::UDiv:
+    return {MC_Div, 4,
+            {Instruction::Add, Instruction::Sub, Instruction::Mul,
+             Instruction::URem}};
+  // 7 Mod % One of +, -, *, /
+  case Instruction::SRem:
+    return {MC_Mod, 4,
+            {Instruction::Add, Instruction::Sub, Instruction::Mul,
+             Instruction::SDiv}};
+  case Instruction::URem:
+    return {MC_Mod, 4,
+            {Instruction::Add, Instruction::Sub, Instruction::Mul,
+             Instruction::UDiv}};
+  // 8 BitAnd & One of |, ^
+  case Instruction::And:
+    return {MC_BitAnd, 2, {Instruction::Or, Instruction::Xor}};
+  // 9 BitOr | One of &, ^
+  case Instruction::Or:
+    return {MC_BitOr, 2, {Instruction::And, Instruction::Xor}};
+  // 10 BitXor ^ One of &, |
+  case Instruction::Xor:
+    return {MC_BitXor, 2, {Instruction::And, Instruction::Or}};
+  // 11 Shl << One of >>L, >>A
+  case Instruction::Shl:
+    return {MC_Shl, 2, {Instruction::LShr, Instruction::AShr}};
+  // 12 LShr >>L Shl <<
+  case Instruction::LShr:
+    return {MC_LShr, 1, {Instruction::Shl}};
+  // 13 AShr >>A Shl <<
+  case Instruction::AShr:
+    return {MC_AShr, 1, {Instruction::Shl}};
+  default:
+    return {MC_None, 0, {}};
+  }
+}
+
+// Table rows for icmp predicates (categories 14 - 19 in table1.c)
+constexpr MutationOperator getICmpRow(unsigned Predicate) {
+  switch (Predicate) {
+  // 14 Lt < One of <=, >=, >, ==, !=
+  case CmpInst::ICMP_SLT:
+    return {MC_Lt, 5,
+            {CmpInst::ICMP_SLE, CmpInst::ICMP_SGE, CmpInst::ICMP_SGT,
+             CmpInst::ICMP_EQ, CmpInst::ICMP_NE}};
+  case CmpInst::ICMP_ULT:
+    return {MC_Lt, 5,
+            {CmpInst::ICMP_ULE, CmpInst::ICMP_UGE, CmpInst::ICMP_UGT,
+             CmpInst::ICMP_EQ, CmpInst::ICMP_NE}};
+  // 15 Le <= One of <, >=, >, ==, !=
+  case CmpInst::ICMP_SLE:
+    return {MC_Le, 5,
+            {CmpInst::ICMP_SLT, CmpInst::ICMP_SGE, CmpInst::ICMP_SGT,
+             CmpInst::ICMP_EQ, CmpInst::ICMP_NE}};
+  case CmpInst::ICMP_ULE:
+    return {MC_Le, 5,
+            {CmpInst::ICMP_ULT, CmpInst::ICMP_UGE, CmpInst::ICMP_UGT,
+             CmpInst::ICMP_EQ, CmpInst::ICMP_NE}};
+  // 16 Ge >= One of <, <=, >, ==, !=
+  case CmpInst::ICMP_SGE:
+    return {MC_Ge, 5,
+            {CmpInst::ICMP_SLT, CmpInst::ICMP_SLE, CmpInst::ICMP_SGT,
+             CmpInst::ICMP_EQ, CmpInst::ICMP_NE}};
+  case CmpInst::ICMP_UGE:
+    return {MC_Ge, 5,
+            {CmpInst::ICMP_ULT, CmpInst::ICMP_ULE, CmpInst::ICMP_UGT,
+             CmpInst::ICMP_EQ, CmpInst::ICMP_NE}};
+  // 17 Gt > One of <, <=, >=, ==, !=
+  case CmpInst::ICMP_SGT:
+    return {MC_Gt, 5,
+            {CmpInst::ICMP_SLT, CmpInst::ICMP_SLE, CmpInst::ICMP_SGE,
+             CmpInst::ICMP_EQ, CmpInst::ICMP_NE}};
+  case CmpInst::ICMP_UGT:
+    return {MC_Gt, 5,
+            {CmpInst::ICMP_ULT, CmpInst::ICMP_ULE, CmpInst::ICMP_UGE,
+             CmpInst::ICMP_EQ, CmpInst::ICMP_NE}};
+  // 18 Equality Eq == !=
+  case CmpInst::ICMP_EQ:
+    return {MC_Eq, 1, {CmpInst::ICMP_NE}};
+  // 19 Neq != ==
+  // (2 Not ! on a scalar also ends up here, as `icmp ne %value, 0`)
+  case CmpInst::ICMP_NE:
+    return {MC_Neq, 1, {CmpInst::ICMP_EQ}};
+  default:
+    return {MC_None, 0, {}};
+  }
+}
+
+struct OperatorTable {
+  MutationOperator Binary[NumBinaryOps];
+  MutationOperator ICmp[NumICmpPredicates];
+  // 1 Neg - Drop the operator: `sub 0, %x` becomes `add 0, %x`
+  MutationOperator Neg;
+  // 2 Not ! Drop the operator: `xor %x, -1` becomes `and %x, -1`
+  MutationOperator Not;
+  // 23 if-else Swap the branches
+  MutationOperator SwapBranches;
+  // 24 continue break the loop
+  MutationOperator ContinueToBreak;
+  // 25 break continue the loop
+  MutationOperator BreakToContinue;
+  // 26 ?: Swap the operands
+  MutationOperator SwapSelect;
+};
+
+constexpr OperatorTable buildOperatorTable() {
+  OperatorTable Table{};
+  for (unsigned Op = 0; Op < NumBinaryOps; Op++)
+    Table.Binary[Op] = getBinaryRow(Instruction::BinaryOpsBegin + Op);
+  for (unsigned Pred = 0; Pred < NumICmpPredicates; Pred++)
+    Table.ICmp[Pred] = getICmpRow(CmpInst::FIRST_ICMP_PREDICATE + Pred);
+  Table.Neg = {MC_Neg, 1, {Instruction::Add}};
+  Table.Not = {MC_Not, 1, {Instruction::And}};
+  Table.SwapBranches = {MC_SwapBranches, 1, {}};
+  Table.ContinueToBreak = {MC_ContinueToBreak, 1, {}};
+  Table.BreakToContinue = {MC_BreakToContinue, 1, {}};
+  Table.SwapSelect = {MC_SwapSelect, 1, {}};
+  return Table;
+}
+
+constexpr OperatorTable Operators = buildOperatorTable();
+
+// The operands of an opcode that hold program values and may be mutated by
+// the constant operators (categories 20 - 22 in table1.c). Bit N stands for
+// operand N; AllArgs stands for every argument of a call.
+struct ConstantOperandRow {
+  uint8_t Mask;
+  bool AllArgs;
+};
+
+constexpr unsigned NumOpcodes = Instruction::OtherOpsEnd;
+
+constexpr ConstantOperandRow getConstantOperandRow(unsigned Opcode) {
+  // The value of a return, a store and the operands of arithmetic and
+  // compares. Not: GEP indices, alloca sizes, switch cases, shuffle masks,
+  // cast operands (they are folded into constants anyway) and PHIs (there
+  // is no place to mutate them in schemata).
+  if (Opcode >= Instruction::BinaryOpsBegin &&
+      Opcode < Instruction::BinaryOpsEnd)
+    return {0b11, false};
+  switch (Opcode) {
+  case Instruction::Ret:
+  case Instruction::Store:
+    return {0b1, false};
+  case Instruction::ICmp:
+    return {0b11, false};
+  case Instruction::Select:
+    return {0b110, false};
+  case Instruction::Call:
+  case Instruction::Invoke:
+    return {0, true};
+  default:
+    return {0, false};
+  }
+}
+
+struct ConstantOperandRows {
+  ConstantOperandRow Rows[NumOpcodes];
+};
+
+constexpr ConstantOperandRows buildConstantOperandRows() {
+  ConstantOperandRows Table{};
+  for (unsigned Opcode = 0; Opcode < NumOpcodes; Opcode++)
+    Table.Rows[Opcode] = getConstantOperandRow(Opcode);
+  return Table;
+}
+
+constexpr ConstantOperandRows ConstantOperands = buildConstantOperandRows();
+
+// The mutants of one constant: (category, new value), without duplicates
+// and without the original value
+using ConstantMutants = SmallVector<std::pair<uint8_t, APInt>, 8>;
+
+ConstantMutants getConstantMutants(const ConstantInt &C) {
+  const APInt &V = C.getValue();
+  unsigned Width = V.getBitWidth();
+  // 22: a value that is random, but fixed for the constant so that the
+  // mutant is reproducible from its point and operator alone. The seed is
+  // hashed from the bits of the constant (hash_value is seeded per process)
+  StringRef Bits(reinterpret_cast<const char *>(V.getRawData()),
+                 V.getNumWords() * sizeof(uint64_t));
+  MutantRNG RNG(xxHash64(Bits), Width);
+
+  std::pair<uint8_t, APInt> Candidates[] = {
+      {MC_ConstSpecial, APInt(Width, 0)},
+      {MC_ConstSpecial, APInt(Width, 1)},
+      {MC_ConstSpecial, APInt::getAllOnesValue(Width)},
+      {MC_ConstSpecial, APInt::getSignedMinValue(Width)},
+      {MC_ConstSpecial, APInt::getSignedMaxValue(Width)},
+      {MC_ConstAdjust, V + 1},
+      {MC_ConstAdjust, V - 1},
+      {MC_ConstRandom, APInt(Width, RNG.next())}};
+
+  ConstantMutants Mutants;
+  for (auto &Candidate : Candidates) {
+    if (Candidate.second == V)
+      continue;
+    bool IsDuplicate = false;
+    for (auto &Mutant : Mutants)
+      IsDuplicate |= (Mutant.second == Candidate.second);
+    if (!IsDuplicate)
+      Mutants.push_back(Candidate);
+  }
+  return Mutants;
+}
+
+// Calls Callback(OperandIdx, Constant) for every mutable constant operand of
+// I
+template <typename CallbackT>
+void forEachConstantOperand(const Instruction &I, CallbackT Callback) {
+  const ConstantOperandRow &Row = ConstantOperands.Rows[I.getOpcode()];
+  if (!Row.Mask && !Row.AllArgs)
+    return;
+
+  // The constant of `sub 0, %x` and `xor %x, -1` is the operator itself
+  const MutationOperator *Op = getMutationOperator(I);
+  if (Op && (Op->Category == MC_Neg || Op->Category == MC_Not))
+    return;
+
+  unsigned NumOperands = I.getNumOperands();
+  if (Row.AllArgs) {
+    // Intrinsic arguments are often required to be constants (alignments,
+    // flags, ...)
+    const auto &Call = cast<CallBase>(I);
+    if (isa<IntrinsicInst>(Call) || Call.isInlineAsm())
+      return;
+    NumOperands = Call.arg_size();
+  }
+
+  for (unsigned Idx = 0; Idx < NumOperands; Idx++)
+    if (Row.AllArgs || (Idx < 8 && (Row.Mask & (1u << Idx))))
+      if (auto *C = dyn_cast<ConstantInt>(I.getOperand(Idx)))
+        Callback(Idx, C);
+}
+
+// Resolves mutant Sel of I to (operand, new value). Sel counts from the
+// first constant mutant.
+bool resolveConstantMutant(const Instruction &I, unsigned Sel,
+                           unsigned &OperandIdx, ConstantInt *&Old,
+                           std::pair<uint8_t, APInt> &Mutant) {
+  bool Found = false;
+  forEachConstantOperand(I, [&](unsigned Idx, ConstantInt *C) {
+    if (Found)
+      return;
+    ConstantMutants Mutants = getConstantMutants(*C);
+    if (Sel < Mutants.size()) {
+      OperandIdx = Idx;
+      Old = C;
+      Mutant = Mutants[Sel];
+      Found = true;
+    } else {
+      Sel -= Mutants.size();
+    }
+  });
+  return Found;
+}
+} // namespace
+
+//-----------------------------------------------------------------------------
+// Constant operands
+//-----------------------------------------------------------------------------
+void getConstantOperands(Instruction &I,
+                         SmallVectorImpl<ConstantOperand> &Operands) {
+  forEachConstantOperand(I, [&](unsigned Idx, ConstantInt *C) {
+    Operands.push_back({&I, Idx, C});
+  });
+}
+
+ConstantOperandTable::ConstantOperandTable(Module &M) {
+  for (Function &F : M)
+    for (BasicBlock &BB : F)
+      for (Instruction &I : BB) {
+        unsigned First = Entries.size();
+        getConstantOperands(I, Entries);
+        if (Entries.size() != First)
+          Ranges[&I] = {First, Entries.size() - First};
+      }
+}
+
+ArrayRef<ConstantOperand>
+ConstantOperandTable::lookup(const Instruction &I) const {
+  auto It = Ranges.find(&I);
+  if (It == Ranges.end())
+    return {};
+  return makeArrayRef(Entries).slice(It->second.first, It->second.second);
+}
+
+//-----------------------------------------------------------------------------
+// Loops
+//-----------------------------------------------------------------------------
+LoopInfoCache::FunctionInfo &LoopInfoCache::get(const Function &F) {
+  std::unique_ptr<FunctionInfo> &Info = Functions[&F];
+  if (!Info)
+    Info.reset(new FunctionInfo(const_cast<Function &>(F)));
+  return *Info;
+}
+
+const DominatorTree &LoopInfoCache::getDomTree(const Function &F) {
+  return get(F).DT;
+}
+
+const LoopInfo &LoopInfoCache::getLoopInfo(const Function &F) {
+  return get(F).LI;
+}
+
+// Whether the edge BB -> Old can be moved to BB -> New in place. Neither
+// block may have PHIs (they would need new incoming values), and the new
+// edge must not take dominance away from a value that is used below New:
+// blocks between idom(New) and the nearest common dominator of New and BB
+// stop dominating New.
+static bool canRetarget(const BasicBlock &BB, const BasicBlock &Old,
+                        const BasicBlock &New, const DominatorTree &DT) {
+  if (isa<PHINode>(Old.begin()) || isa<PHINode>(New.begin()))
+    return false;
+
+  const DomTreeNode *Node = DT.getNode(&New);
+  if (!Node || !DT.getNode(&BB))
+    return false;
+
+  for (const DomTreeNode *X = Node->getIDom();
+       X && !DT.dominates(X->getBlock(), &BB); X = X->getIDom())
+    for (const Instruction &Def : *X->getBlock())
+      for (const Use &U : Def.uses()) {
+        const auto *User = cast<Instruction>(U.getUser());
+        const BasicBlock *UseBB = User->getParent();
+        if (auto *PN = dyn_cast<PHINode>(User))
+          UseBB = PN->getIncomingBlock(U);
+        if (DT.dominates(&New, UseBB))
+          return false;
+      }
+  return true;
+}
+
+// Whether BB is the block of a `break` out of L to Target: it is only
+// entered from L and does nothing but branch to Target
+static bool isBreakBlock(const BasicBlock &BB, const Loop &L,
+                         const BasicBlock *Target) {
+  const BasicBlock *Pred = BB.getSinglePredecessor();
+  const auto *Br = dyn_cast<BranchInst>(BB.getTerminator());
+  return Pred && L.contains(Pred) && !L.contains(&BB) && Br &&
+         Br->isUnconditional() && Br->getSuccessor(0) == Target;
+}
+
+// The block a `break` out of L jumps to: the exit that all other exits of L
+// (the break blocks) branch to
+static BasicBlock *getBreakTarget(const Loop &L) {
+  SmallVector<BasicBlock *, 4> Exits;
+  L.getUniqueExitBlocks(Exits);
+  for (BasicBlock *Candidate : Exits)
+    if (llvm::all_of(Exits, [&](const BasicBlock *Exit) {
+          return Exit == Candidate || isBreakBlock(*Exit, L, Candidate);
+        }))
+      return Candidate;
+  return nullptr;
+}
+
+// A loop without a single latch is continued by branching to its header
+// (e.g. `continue` in a while loop)
+static BasicBlock *getContinueTarget(const Loop &L) {
+  BasicBlock *Latch = L.getLoopLatch();
+  return Latch ? Latch : L.getHeader();
+}
+
+// Resolves the continue/break mutant of Br: sets Category and returns the
+// new target, or returns nullptr
+static BasicBlock *resolveRetarget(const BranchInst &Br, LoopInfoCache &Loops,
+                                   uint8_t &Category) {
+  if (!Br.isUnconditional())
+    return nullptr;
+
+  const BasicBlock *BB = Br.getParent();
+  const Function &F = *BB->getParent();
+  const LoopInfo &LI = Loops.getLoopInfo(F);
+  BasicBlock *Target = Br.getSuccessor(0);
+  BasicBlock *New = nullptr;
+
+  // 24: `continue` inside the loop, except for the branch closing the loop
+  if (const Loop *L = LI.getLoopFor(BB)) {
+    if (Target == getContinueTarget(*L) && BB != L->getLoopLatch()) {
+      New = getBreakTarget(*L);
+      Category = MC_ContinueToBreak;
+    }
+  }
+
+  // 25: `break`, the block leaving the loop for its break target
+  if (!New && BB->getSinglePredecessor()) {
+    const Loop *L = LI.getLoopFor(BB->getSinglePredecessor());
+    if (L && isBreakBlock(*BB, *L, Target) && getBreakTarget(*L) == Target) {
+      New = getContinueTarget(*L);
+      Category = MC_BreakToContinue;
+    }
+  }
+
+  if (!New || !canRetarget(*BB, *Target, *New, Loops.getDomTree(F)))
+    return nullptr;
+  return New;
+}
+
+BasicBlock *getBranchRetarget(const BranchInst &Br, LoopInfoCache &Loops) {
+  uint8_t Category;
+  return resolveRetarget(Br, Loops, Category);
+}
+
+//-----------------------------------------------------------------------------
+// Engine
+//-----------------------------------------------------------------------------
+const MutationOperator *getMutationOperator(const Instruction &I,
+                                            LoopInfoCache *Loops) {
+  const MutationOperator *Row = nullptr;
+
+  if (auto *Br = dyn_cast<BranchInst>(&I)) {
+    if (Br->isConditional()) {
+      if (Br->getSuccessor(0) != Br->getSuccessor(1))
+        Row = &Operators.SwapBranches;
+    } else {
+      LoopInfoCache LocalLoops;
+      uint8_t Category;
+      if (resolveRetarget(*Br, Loops ? *Loops : LocalLoops, Category))
+        Row = (Category == MC_ContinueToBreak) ? &Operators.ContinueToBreak
+                                               : &Operators.BreakToContinue;
+    }
+  } else if (isa<SelectInst>(&I)) {
+    Row = &Operators.SwapSelect;
+  } else if (auto *Cmp = dyn_cast<ICmpInst>(&I)) {
+    Row = &Operators.ICmp[Cmp->getPredicate() - CmpInst::FIRST_ICMP_PREDICATE];
+  } else if (auto *BinOp = dyn_cast<BinaryOperator>(&I)) {
+    if (match(BinOp, m_Neg(m_Value())))
+      Row = &Operators.Neg;
+    else if (match(BinOp, m_Not(m_Value())))
+      Row = &Operators.Not;
+    else
+      Row = &Operators.Binary[BinOp->getOpcode() -
+                              Instruction::BinaryOpsBegin];
+  }
+
+  return (Row && Row->NumReplacements) ? Row : nullptr;
+}
+
+static unsigned getNumOperatorMutants(const Instruction &I,
+                                      LoopInfoCache *Loops) {
+  const MutationOperator *Row = getMutationOperator(I, Loops);
+  return Row ? Row->NumReplacements : 0;
+}
+
+unsigned getNumMutants(const Instruction &I, LoopInfoCache *Loops) {
+  unsigned NumMutants = getNumOperatorMutants(I, Loops);
+  forEachConstantOperand(I, [&](unsigned, ConstantInt *C) {
+    NumMutants += getConstantMutants(*C).size();
+  });
+  return NumMutants;
+}
+
+ConstantInt *getConstantMutant(const Instruction &I, unsigned Sel,
+                               unsigned &OperandIdx, LoopInfoCache *Loops) {
+  unsigned NumOperatorMutants = getNumOperatorMutants(I, Loops);
+  if (Sel < NumOperatorMutants)
+    return nullptr;
+
+  ConstantInt *Old;
+  std::pair<uint8_t, APInt> Mutant;
+  if (!resolveConstantMutant(I, Sel - NumOperatorMutants, OperandIdx, Old,
+                             Mutant))
+    return nullptr;
+  return ConstantInt::get(I.getContext(), Mutant.second);
+}
+
+uint64_t getOperatorTableHash() {
+  // Field by field, the padding of the rows is not part of the tables
+  SmallString<2048> Bytes;
+  raw_svector_ostream OS(Bytes);
+  support::endian::Writer W(OS, support::little);
+  auto addRow = [&](const MutationOperator &Row) {
+    W.write<uint8_t>(Row.Category);
+    W.write<uint8_t>(Row.NumReplacements);
+    for (unsigned Idx = 0; Idx < Row.NumReplacements; Idx++)
+      W.write<uint32_t>(Row.Replacements[Idx]);
+  };
+
+  for (const MutationOperator &Row : Operators.Binary)
+    addRow(Row);
+  for (const MutationOperator &Row : Operators.ICmp)
+    addRow(Row);
+  for (const MutationOperator *Row :
+       {&Operators.Neg, &Operators.Not, &Operators.SwapBranches,
+        &Operators.ContinueToBreak, &Operators.BreakToContinue,
+        &Operators.SwapSelect})
+    addRow(*Row);
+  for (const ConstantOperandRow &Row : ConstantOperands.Rows) {
+    W.write<uint8_t>(Row.Mask);
+    W.write<uint8_t>(Row.AllArgs);
+  }
+  return xxHash64(OS.str());
+}
+
+uint8_t getMutationCategory(const Instruction &I, LoopInfoCache *Loops) {
+  if (const MutationOperator *Op = getMutationOperator(I, Loops))
+    return Op->Category;
+  return getNumMutants(I, Loops) ? MC_ConstSpecial : MC_None;
+}
+
+bool applyMutation(Instruction &I, unsigned Sel, MutationTransaction &Txn,
+                   LoopInfoCache *Loops) {
+  const MutationOperator *Row = getMutationOperator(I, Loops);
+  unsigned NumOperatorMutants = Row ? Row->NumReplacements : 0;
+  if (Sel >= NumOperatorMutants) {
+    unsigned OperandIdx;
+    ConstantInt *Old;
+    std::pair<uint8_t, APInt> Mutant;
+    if (!resolveConstantMutant(I, Sel - NumOperatorMutants, OperandIdx, Old,
+                               Mutant))
+      return false;
+    Txn.setOperand(I, OperandIdx,
+                   ConstantInt::get(I.getContext(), Mutant.second));
+    return true;
+  }
+
+  // The structural operators only rewire operands
+  switch (Row->Category) {
+  case MC_SwapBranches:
+  case MC_SwapSelect: {
+    // Operands 1 and 2 are the false/true successors of a branch and the
+    // true/false values of a select
+    Value *First = I.getOperand(1);
+    Value *Second = I.getOperand(2);
+    Txn.setOperand(I, 1, Second);
+    Txn.setOperand(I, 2, First);
+    return true;
+  }
+  case MC_ContinueToBreak:
+  case MC_BreakToContinue: {
+    LoopInfoCache LocalLoops;
+    Txn.setOperand(I, 0,
+                   getBranchRetarget(cast<BranchInst>(I),
+                                     Loops ? *Loops : LocalLoops));
+    return true;
+  }
+  default:
+    break;
+  }
+
+  unsigned Replacement = Row->Replacements[Sel];
+
+  if (auto *Cmp = dyn_cast<ICmpInst>(&I)) {
+    Txn.setPredicate(*Cmp, static_cast<CmpInst::Predicate>(Replacement));
+    return true;
+  }
+
+  auto *NewOp = BinaryOperator::Create(
+      static_cast<Instruction::BinaryOps>(Replacement), I.getOperand(0),
+      I.getOperand(1));
+  // Keeps the debug location and the stable mutation point ID
+  NewOp->copyMetadata(I);
+  Txn.replaceInstruction(I, NewOp);
+  return true;
+}
+
+Value *createMutantValue(IRBuilder<> &Builder, Instruction &I, unsigned Sel,
+                         Value *IsSelected) {
+  if (isa<BranchInst>(&I))
+    return nullptr;
+
+  const MutationOperator *Row = getMutationOperator(I);
+  if (!Row || Sel >= Row->NumReplacements)
+    return nullptr;
+
+  if (auto *Select = dyn_cast<SelectInst>(&I))
+    return Builder.CreateSelect(Select->getCondition(),
+                                Select->getFalseValue(),
+                                Select->getTrueValue());
+
+  unsigned Replacement = Row->Replacements[Sel];
+
+  if (isa<ICmpInst>(&I))
+    return Builder.CreateICmp(static_cast<CmpInst::Predicate>(Replacement),
+                              I.getOperand(0), I.getOperand(1));
+
+  auto Opcode = static_cast<Instruction::BinaryOps>(Replacement);
+  Value *LHS = I.getOperand(0);
+  Value *RHS = I.getOperand(1);
+  // The mutant is computed whether it is selected or not. Make sure an
+  // inactive division never divides by zero (or overflows)
+  if (Opcode == Instruction::SDiv || Opcode == Instruction::UDiv ||
+      Opcode == Instruction::SRem || Opcode == Instruction::URem)
+    RHS = Builder.CreateSelect(IsSelected, RHS,
+                               ConstantInt::get(RHS->getType(), 1));
+  return Builder.CreateBinOp(Opcode, LHS, RHS);
+}
+
+static std::string describeConstantMutation(const Instruction &I,
+                                            unsigned OperandIdx,
+                                            const APInt &Old,
+                                            const APInt &New) {
+  std::string Description;
+  raw_string_ostream OS(Description);
+  OS << I.getOpcodeName() << " operand " << OperandIdx << " ";
+  Old.print(OS, /*isSigned=*/true);
+  OS << " -> ";
+  New.print(OS, /*isSigned=*/true);
+  return OS.str();
+}
+
+std::string describeMutation(const Instruction &I, unsigned Sel,
+                             LoopInfoCache *Loops) {
+  const MutationOperator *Row = getMutationOperator(I, Loops);
+  unsigned NumOperatorMutants = Row ? Row->NumReplacements : 0;
+  if (Sel >= NumOperatorMutants) {
+    unsigned OperandIdx;
+    ConstantInt *Old;
+    std::pair<uint8_t, APInt> Mutant;
+    if (!resolveConstantMutant(I, Sel - NumOperatorMutants, OperandIdx, Old,
+                               Mutant))
+      return "none";
+    return describeConstantMutation(I, OperandIdx, Old->getValue(),
+                                    Mutant.second);
+  }
+
+  switch (Row->Category) {
+  case MC_SwapBranches:
+    return "br swap successors";
+  case MC_SwapSelect:
+    return "select swap operands";
+  case MC_ContinueToBreak:
+    return "br continue -> break";
+  case MC_BreakToContinue:
+    return "br break -> continue";
+  default:
+    break;
+  }
+
+  unsigned Replacement = Row->Replacements[Sel];
+
+  if (auto *Cmp = dyn_cast<ICmpInst>(&I))
+    return "icmp " + CmpInst::getPredicateName(Cmp->getPredicate()).str() +
+           " -> " +
+           CmpInst::getPredicateName(
+               static_cast<CmpInst::Predicate>(Replacement))
+               .str();
+
+  return std::string(I.getOpcodeName()) + " -> " +
+         Instruction::getOpcodeName(Replacement);
+}
+
+//-----------------------------------------------------------------------------
+// Higher-order mutants
+//-----------------------------------------------------------------------------
+bool changesCFG(const Instruction &I, unsigned Sel, LoopInfoCache *Loops) {
+  const MutationOperator *Row = getMutationOperator(I, Loops);
+  if (!Row || Sel >= Row->NumReplacements)
+    return false;
+  return Row->Category == MC_ContinueToBreak ||
+         Row->Category == MC_BreakToContinue;
+}
+
+bool selectMutations(MutantPlan &Plan, MutantRNG &RNG, LoopInfoCache *Loops,
+                     std::string &Error) {
+  SmallPtrSet<const Instruction *, 8> Mutated;
+  SmallPtrSet<const Function *, 4> Retargeted;
+  Plan.Sels.clear();
+  for (const auto &Target : Plan.Targets) {
+    Instruction *Ins = Target.first;
+    std::string Point = formatPoint(Target.second);
+    if (!Ins) {
+      Error = "mutation point " + Point + " is out of range";
+      return false;
+    }
+    unsigned NumMutants = getNumMutants(*Ins, Loops);
+    if (NumMutants == 0) {
+      Error = Point + " is not a mutation point";
+      return false;
+    }
+    if (!Mutated.insert(Ins).second) {
+      Error = Point + " is mutated twice";
+      return false;
+    }
+
+    unsigned Sel = selectMutant(Target.second.Operator, NumMutants, RNG);
+    if (changesCFG(*Ins, Sel, Loops) &&
+        !Retargeted.insert(Ins->getFunction()).second) {
+      Error = Point + " changes the CFG of a function that another "
+                      "mutation already changes";
+      return false;
+    }
+    Plan.Sels.push_back(Sel);
+  }
+  return true;
+}
+
+void applyMutations(const MutantPlan &Plan, MutationTransaction &Txn,
+                    LoopInfoCache *Loops, std::vector<std::string> &Applied) {
+  for (size_t Idx = 0; Idx < Plan.Sels.size(); Idx++) {
+    applyMutation(*Plan.Targets[Idx].first, Plan.Sels[Idx], Txn, Loops);
+    Applied.push_back(formatPoint(Plan.Targets[Idx].second) + " " +
+                      std::to_string(Plan.Sels[Idx]));
+  }
+}
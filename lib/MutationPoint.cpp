@@ -0,0 +1,378 @@
+//==============================================================================
+// FILE:
+//    MutationPoint.cpp
+//
+// DESCRIPTION:
+//    Implements the helpers declared in MutationPoint.h: reading and writing
+//    of text and binary mutation point files, stable IDs and the O(1)
+//    mutation point index.
+//
+// License: MIT
+//==============================================================================
+#include "MutationPoint.h"
+#include "MutantRNG.h"
+
+#include "llvm/ADT/STLExtras.h"
+#include "llvm/ADT/SmallVector.h"
+#include "llvm/IR/Constants.h"
+#include "llvm/IR/Metadata.h"
+#include "llvm/Support/EndianStream.h"
+#include "llvm/Support/FileSystem.h"
+#include "llvm/Support/raw_ostream.h"
+
+#include <algorithm>
+#include <climits>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <regex>
+#include <string>
+
+using namespace llvm;
+
+constexpr uint64_t MutationPoint::NoStableID;
+
+//-----------------------------------------------------------------------------
+// Binary point files
+//-----------------------------------------------------------------------------
+static const char BinaryMagic[8] = {'F', 'A', 'S', 'T', 'M', 'P', 0, 0};
+static const uint32_t BinaryVersion = 1;
+static const uint32_t FlagHasStableIDs = 1;
+static const size_t BinaryHeaderSize = 32;
+
+bool writeBinaryPointFile(StringRef Path, ArrayRef<MutationPoint> Points,
+                          ArrayRef<uint32_t> Categories) {
+  std::error_code EC;
+  raw_fd_ostream Out(Path, EC, sys::fs::OF_None);
+  if (EC) {
+    errs() << "Failed to open " << Path << ": " << EC.message() << "\n";
+    return false;
+  }
+
+  bool HasStableIDs = false;
+  for (const MutationPoint &Point : Points)
+    HasStableIDs |= Point.hasStableID();
+
+  support::endian::Writer W(Out, support::little);
+  Out.write(BinaryMagic, sizeof(BinaryMagic));
+  W.write<uint32_t>(BinaryVersion);
+  W.write<uint32_t>(HasStableIDs ? FlagHasStableIDs : 0);
+  W.write<uint64_t>(Points.size());
+  W.write<uint64_t>(0);
+
+  for (const MutationPoint &Point : Points)
+    W.write<uint32_t>(Point.FuncID);
+  for (const MutationPoint &Point : Points)
+    W.write<uint32_t>(Point.BBID);
+  for (const MutationPoint &Point : Points)
+    W.write<uint32_t>(Point.InsID);
+  for (size_t Idx = 0; Idx < Points.size(); Idx++)
+    W.write<uint32_t>(Idx < Categories.size() ? Categories[Idx] : 0);
+  if (HasStableIDs)
+    for (const MutationPoint &Point : Points)
+      W.write<uint64_t>(Point.StableID);
+
+  return true;
+}
+
+bool MutationPointList::open(StringRef Path) {
+  Buffer.reset();
+  NumPoints = 0;
+  TextPoints.clear();
+
+  // Peek at the magic to tell binary files from text files
+  char Magic[sizeof(BinaryMagic)] = {};
+  {
+    std::ifstream File(Path.str(), std::ios::binary);
+    File.read(Magic, sizeof(Magic));
+  }
+  if (std::equal(std::begin(Magic), std::end(Magic), BinaryMagic))
+    return openBinary(Path);
+
+  return readMutationPointFile(Path, TextPoints);
+}
+
+bool MutationPointList::openBinary(StringRef Path) {
+  // Not requiring a null terminator lets MemoryBuffer mmap the file rather
+  // than read it
+  auto BufferOrErr = MemoryBuffer::getFile(Path, /*FileSize=*/-1,
+                                           /*RequiresNullTerminator=*/false);
+  if (!BufferOrErr) {
+    errs() << "Failed to open mutation point file " << Path << ": "
+           << BufferOrErr.getError().message() << "\n";
+    return false;
+  }
+  Buffer = std::move(*BufferOrErr);
+
+  const char *Data = Buffer->getBufferStart();
+  size_t Size = Buffer->getBufferSize();
+  if (Size < BinaryHeaderSize) {
+    errs() << "Truncated mutation point file " << Path << "\n";
+    return false;
+  }
+
+  using namespace support;
+  uint32_t Version = endian::read32le(Data + 8);
+  uint32_t Flags = endian::read32le(Data + 12);
+  uint64_t Count = endian::read64le(Data + 16);
+  if (Version != BinaryVersion) {
+    errs() << "Unsupported mutation point file version " << Version << "\n";
+    return false;
+  }
+
+  size_t RowSize = 4 * sizeof(uint32_t);
+  if (Flags & FlagHasStableIDs)
+    RowSize += sizeof(uint64_t);
+  if (Count > (Size - BinaryHeaderSize) / RowSize) {
+    errs() << "Truncated mutation point file " << Path << "\n";
+    return false;
+  }
+
+  NumPoints = Count;
+  auto *Columns =
+      reinterpret_cast<const ulittle32_t *>(Data + BinaryHeaderSize);
+  FuncIDs = Columns;
+  BBIDs = Columns + NumPoints;
+  InsIDs = Columns + 2 * NumPoints;
+  Categories = Columns + 3 * NumPoints;
+  StableIDs = (Flags & FlagHasStableIDs)
+                  ? reinterpret_cast<const ulittle64_t *>(Columns +
+                                                          4 * NumPoints)
+                  : nullptr;
+  return true;
+}
+
+size_t MutationPointList::size() const {
+  return Buffer ? NumPoints : TextPoints.size();
+}
+
+MutationPoint MutationPointList::operator[](size_t Idx) const {
+  if (!Buffer)
+    return TextPoints[Idx];
+
+  MutationPoint Point;
+  Point.FuncID = FuncIDs[Idx];
+  Point.BBID = BBIDs[Idx];
+  Point.InsID = InsIDs[Idx];
+  if (StableIDs)
+    Point.StableID = StableIDs[Idx];
+  return Point;
+}
+
+uint32_t MutationPointList::getCategory(size_t Idx) const {
+  return Buffer ? uint32_t(Categories[Idx]) : 0;
+}
+
+int drawOperator(MutantRNG &RNG) { return RNG.uniform(INT_MAX); }
+
+unsigned selectMutant(int Operator, unsigned NumMutants, MutantRNG &RNG) {
+  return (Operator >= 0) ? unsigned(Operator) % NumMutants
+                         : RNG.uniform(NumMutants);
+}
+
+// Draws the points of Count mutants, using Draw(RNG) to pick a point index
+template <typename DrawT>
+static std::vector<MutationPoint>
+drawMutants(const MutationPointList &Points, uint64_t Seed,
+            uint64_t FirstIndex, uint64_t Count, unsigned Order, DrawT Draw) {
+  std::vector<MutationPoint> Batch;
+  for (uint64_t K = 0; K < Count; K++) {
+    MutantRNG RNG(Seed, FirstIndex + K);
+    SmallVector<uint64_t, 4> Picked;
+    for (unsigned J = 0; J < Order; J++) {
+      // Redraw points the mutant already has, unless there are not enough
+      uint64_t Idx = Draw(RNG);
+      for (unsigned Retry = 0; Retry < 8 && is_contained(Picked, Idx); Retry++)
+        Idx = Draw(RNG);
+      Picked.push_back(Idx);
+
+      MutationPoint Point = Points[Idx];
+      Point.Operator = drawOperator(RNG);
+      Batch.push_back(Point);
+    }
+  }
+  return Batch;
+}
+
+std::vector<MutationPoint> drawMutationPoints(const MutationPointList &Points,
+                                              uint64_t Seed,
+                                              uint64_t FirstIndex,
+                                              uint64_t Count,
+                                              unsigned Order) {
+  if (Points.empty())
+    return {};
+  return drawMutants(Points, Seed, FirstIndex, Count, Order,
+                     [&](MutantRNG &RNG) { return RNG.uniform(Points.size()); });
+}
+
+WeightedPointSampler::WeightedPointSampler(ArrayRef<double> Weights) {
+  Cumulative.reserve(Weights.size());
+  double Total = 0;
+  for (double Weight : Weights) {
+    Total += std::max(Weight, 0.0);
+    Cumulative.push_back(Total);
+  }
+}
+
+size_t WeightedPointSampler::draw(MutantRNG &RNG) const {
+  // The first index whose cumulative weight exceeds X; points of weight 0
+  // have the same cumulative weight as their predecessor and are skipped
+  double X = RNG.uniformReal() * Cumulative.back();
+  size_t Idx =
+      std::upper_bound(Cumulative.begin(), Cumulative.end(), X) -
+      Cumulative.begin();
+  return std::min(Idx, Cumulative.size() - 1);
+}
+
+std::vector<MutationPoint>
+drawMutationPoints(const MutationPointList &Points,
+                   const WeightedPointSampler &Sampler, uint64_t Seed,
+                   uint64_t FirstIndex, uint64_t Count, unsigned Order) {
+  if (Points.empty() || Sampler.empty())
+    return {};
+  return drawMutants(Points, Seed, FirstIndex, Count, Order,
+                     [&](MutantRNG &RNG) { return Sampler.draw(RNG); });
+}
+
+//-----------------------------------------------------------------------------
+// Text point files
+//-----------------------------------------------------------------------------
+
+std::string formatPoint(const MutationPoint &Point) {
+  if (Point.hasStableID())
+    return "mp:" + std::to_string(Point.StableID);
+  return "(" + std::to_string(Point.FuncID) + ", " +
+         std::to_string(Point.BBID) + ", " + std::to_string(Point.InsID) +
+         ")";
+}
+
+bool parseMutationPoint(const std::string &Line, MutationPoint &Point) {
+  // (funcID, bbID, insID) or mp:<ID>, optionally followed by the operator
+  // selector and a comment
+  static const std::regex Pattern(
+      "\\s*(?:\\((\\d+),\\s*(\\d+),\\s*(\\d+)\\)|mp:(\\d+))"
+      "(?:\\s+(\\d+))?\\s*(?:#.*)?");
+
+  std::smatch Matches;
+  if (!std::regex_match(Line, Matches, Pattern))
+    return false;
+
+  Point = MutationPoint();
+  if (Matches[4].matched) {
+    Point.StableID = std::stoull(Matches[4]);
+  } else {
+    Point.FuncID = std::stoul(Matches[1]);
+    Point.BBID = std::stoul(Matches[2]);
+    Point.InsID = std::stoul(Matches[3]);
+  }
+  if (Matches[5].matched)
+    Point.Operator = std::stoi(Matches[5]);
+  return true;
+}
+
+bool readMutationPointFile(StringRef Path,
+                           std::vector<MutationPoint> &Points) {
+  std::ifstream File(Path.str());
+  if (!File.is_open()) {
+    std::cerr << "Failed to open mutation point file " << Path.str() << "\n";
+    return false;
+  }
+
+  std::string Line;
+  while (std::getline(File, Line)) {
+    if (Line.empty())
+      continue;
+
+    MutationPoint Point;
+    if (!parseMutationPoint(Line, Point)) {
+      std::cerr << "Regex cannot parse: " << Line << "\n";
+      return false;
+    }
+    Points.push_back(Point);
+  }
+
+  return true;
+}
+
+bool getStableID(const Instruction &I, uint64_t &ID) {
+  return getStableID(I, I.getContext().getMDKindID(StableIDMDKind), ID);
+}
+
+bool getStableID(const Instruction &I, unsigned KindID, uint64_t &ID) {
+  MDNode *Node = I.getMetadata(KindID);
+  if (!Node || Node->getNumOperands() != 1)
+    return false;
+
+  auto *Value = mdconst::dyn_extract<ConstantInt>(Node->getOperand(0));
+  if (!Value)
+    return false;
+
+  // The two largest values are reserved (see MutationPoint::NoStableID)
+  if (Value->getZExtValue() >= MutationPoint::NoStableID - 1)
+    return false;
+
+  ID = Value->getZExtValue();
+  return true;
+}
+
+void setStableID(Instruction &I, uint64_t ID) {
+  auto &CTX = I.getContext();
+  Metadata *IDMD =
+      ConstantAsMetadata::get(ConstantInt::get(Type::getInt64Ty(CTX), ID));
+  I.setMetadata(StableIDMDKind, MDNode::get(CTX, IDMD));
+}
+
+void setMutantMetadata(Module &M, uint64_t Seed, uint64_t Index,
+                       ArrayRef<std::string> Mutations) {
+  auto &CTX = M.getContext();
+  Type *Int64Ty = Type::getInt64Ty(CTX);
+  SmallVector<Metadata *, 4> Ops = {
+      ConstantAsMetadata::get(ConstantInt::get(Int64Ty, Seed)),
+      ConstantAsMetadata::get(ConstantInt::get(Int64Ty, Index))};
+  for (const std::string &Mutation : Mutations)
+    Ops.push_back(MDString::get(CTX, Mutation));
+
+  NamedMDNode *Node = M.getOrInsertNamedMetadata("fast.mutant");
+  Node->clearOperands();
+  Node->addOperand(MDNode::get(CTX, Ops));
+}
+
+void eraseMutantMetadata(Module &M) {
+  if (NamedMDNode *Node = M.getNamedMetadata("fast.mutant"))
+    M.eraseNamedMetadata(Node);
+}
+
+MutationPointIndex::MutationPointIndex(Module &M) {
+  for (auto &Func : M) {
+    FuncOffsets.push_back(BlockOffsets.size());
+    for (auto &BB : Func) {
+      BlockOffsets.push_back(Instructions.size());
+      for (auto &Ins : BB) {
+        Instructions.push_back(&Ins);
+        uint64_t ID;
+        if (getStableID(Ins, ID))
+          StableIDs[ID] = &Ins;
+      }
+    }
+  }
+  FuncOffsets.push_back(BlockOffsets.size());
+  BlockOffsets.push_back(Instructions.size());
+}
+
+Instruction *MutationPointIndex::lookup(const MutationPoint &Point) const {
+  if (Point.hasStableID())
+    return StableIDs.lookup(Point.StableID);
+
+  if (Point.FuncID >= FuncOffsets.size() - 1)
+    return nullptr;
+
+  uint64_t Block = uint64_t(FuncOffsets[Point.FuncID]) + Point.BBID;
+  if (Block >= FuncOffsets[Point.FuncID + 1])
+    return nullptr;
+
+  uint64_t ID = uint64_t(BlockOffsets[Block]) + Point.InsID;
+  if (ID >= BlockOffsets[Block + 1])
+    return nullptr;
+
+  return Instructions[ID];
+}
@@ -0,0 +1,345 @@
+//==============================================================================
+// FILE:
+//    MutationScheduler.cpp
+//
+// DESCRIPTION:
+//    Implements MutationScheduler, see MutationScheduler.h.
+//
+// License: MIT
+//==============================================================================
+#include "MutationScheduler.h"
+
+#include "llvm/Support/FileSystem.h"
+#include "llvm/Support/raw_ostream.h"
+
+#include <algorithm>
+#include <cmath>
+#include <fstream>
+#include <iostream>
+#include <regex>
+#include <string>
+
+using namespace llvm;
+
+static const char *StateHeader = "# FASTSCHED 1";
+
+// Keys of points with a stable ID have the top bit set, the others hold
+// (funcID, bbID, insID) in 21 bits each
+static constexpr uint64_t StableKeyBit = uint64_t(1) << 63;
+static constexpr unsigned KeyFieldBits = 21;
+static constexpr uint64_t KeyFieldMask = (uint64_t(1) << KeyFieldBits) - 1;
+
+//-----------------------------------------------------------------------------
+// State file
+//-----------------------------------------------------------------------------
+bool MutationScheduler::load(StringRef Path) {
+  std::ifstream File(Path.str());
+  if (!File.is_open())
+    return true;
+
+  // <point> <operator> <killed> <survived> <timeouts> <crashes> <reward>
+  // <kill-ms>
+  static const std::regex Pattern(
+      "\\s*(\\(\\d+,\\s*\\d+,\\s*\\d+\\)|mp:\\d+)\\s+(\\d+)\\s+(\\d+)\\s+"
+      "(\\d+)\\s+(\\d+)\\s+(\\d+)\\s+(\\S+)\\s+(\\S+)\\s*");
+
+  std::string Line;
+  while (std::getline(File, Line)) {
+    if (Line.empty() || Line[0] == '#')
+      continue;
+
+    std::smatch Matches;
+    MutationPoint Point;
+    uint64_t Key;
+    if (!std::regex_match(Line, Matches, Pattern) ||
+        !parseMutationPoint(Matches[1], Point) || !getKey(Point, Key)) {
+      std::cerr << "Malformed scheduler state: " << Line << "\n";
+      return false;
+    }
+
+    PointStats &PS = getPointStats(Key);
+    unsigned Operator = std::stoul(Matches[2]);
+    if (PS.Operators.size() <= Operator)
+      PS.Operators.resize(Operator + 1);
+
+    ArmStats Arm;
+    Arm.Killed = std::stoull(Matches[3]);
+    Arm.Survived = std::stoull(Matches[4]);
+    Arm.Timeouts = std::stoull(Matches[5]);
+    Arm.Crashes = std::stoull(Matches[6]);
+    Arm.Reward = std::stod(Matches[7]);
+    Arm.KillMillis = std::stod(Matches[8]);
+
+    for (ArmStats *Stats : {&PS.Operators[Operator], &PS.Total}) {
+      Stats->Killed += Arm.Killed;
+      Stats->Survived += Arm.Survived;
+      Stats->Timeouts += Arm.Timeouts;
+      Stats->Crashes += Arm.Crashes;
+      Stats->Reward += Arm.Reward;
+      Stats->KillMillis += Arm.KillMillis;
+    }
+    TotalPlays += Arm.getNumOutcomes();
+  }
+
+  return true;
+}
+
+bool MutationScheduler::save(StringRef Path) const {
+  std::error_code EC;
+  raw_fd_ostream Out(Path, EC, sys::fs::OF_None);
+  if (EC) {
+    errs() << "Failed to open " << Path << ": " << EC.message() << "\n";
+    return false;
+  }
+
+  // Sorted, so that the same statistics always give the same file
+  std::vector<uint64_t> Keys;
+  for (const auto &Entry : Stats)
+    Keys.push_back(Entry.first);
+  std::sort(Keys.begin(), Keys.end());
+
+  Out << StateHeader << "\n";
+  for (uint64_t Key : Keys) {
+    std::string Point = formatPoint(getPoint(Key));
+    const std::vector<ArmStats> &Operators = Stats.find(Key)->second.Operators;
+    for (unsigned Op = 0; Op < Operators.size(); Op++) {
+      const ArmStats &Arm = Operators[Op];
+      if (Arm.getNumOutcomes() == 0)
+        continue;
+      Out << Point << " " << Op << " " << Arm.Killed << " "
+          << Arm.Survived << " " << Arm.Timeouts << " " << Arm.Crashes << " "
+          << Arm.Reward << " " << Arm.KillMillis << "\n";
+    }
+  }
+  return true;
+}
+
+//-----------------------------------------------------------------------------
+// Outcomes
+//-----------------------------------------------------------------------------
+bool MutationScheduler::parseOutcome(StringRef Name, Outcome &O) {
+  if (Name == "killed")
+    O = Killed;
+  else if (Name == "survived")
+    O = Survived;
+  else if (Name == "timeout")
+    O = Timeout;
+  else if (Name == "crash")
+    O = Crash;
+  else
+    return false;
+  return true;
+}
+
+bool MutationScheduler::getKey(const MutationPoint &Point, uint64_t &Key) {
+  if (Point.hasStableID()) {
+    // The two largest keys are reserved by DenseMap
+    if (Point.StableID >= StableKeyBit - 2)
+      return false;
+    Key = StableKeyBit | Point.StableID;
+    return true;
+  }
+  if (Point.FuncID > KeyFieldMask || Point.BBID > KeyFieldMask ||
+      Point.InsID > KeyFieldMask)
+    return false;
+  Key = (uint64_t(Point.FuncID) << (2 * KeyFieldBits)) |
+        (uint64_t(Point.BBID) << KeyFieldBits) | Point.InsID;
+  return true;
+}
+
+MutationPoint MutationScheduler::getPoint(uint64_t Key) {
+  MutationPoint Point;
+  if (Key & StableKeyBit) {
+    Point.StableID = Key & ~StableKeyBit;
+    return Point;
+  }
+  Point.FuncID = (Key >> (2 * KeyFieldBits)) & KeyFieldMask;
+  Point.BBID = (Key >> KeyFieldBits) & KeyFieldMask;
+  Point.InsID = Key & KeyFieldMask;
+  return Point;
+}
+
+void MutationScheduler::addOutcome(ArmStats &Arm, Outcome O, double Millis,
+                                   double Reward) {
+  switch (O) {
+  case Killed:
+    Arm.Killed++;
+    Arm.KillMillis += Millis;
+    break;
+  case Survived:
+    Arm.Survived++;
+    break;
+  case Timeout:
+    Arm.Timeouts++;
+    break;
+  case Crash:
+    Arm.Crashes++;
+    break;
+  }
+  Arm.Reward += Reward;
+  if (Arm.Pending > 0)
+    Arm.Pending--;
+}
+
+bool MutationScheduler::record(const MutationPoint &Point, unsigned Operator,
+                               Outcome O, double Millis) {
+  uint64_t Key;
+  if (!getKey(Point, Key)) {
+    std::cerr << "Mutation point " << formatPoint(Point)
+              << " is out of the scheduler's range\n";
+    return false;
+  }
+
+  PointStats &PS = getPointStats(Key);
+  if (PS.Operators.size() <= Operator)
+    PS.Operators.resize(Operator + 1);
+
+  double Reward = 0;
+  switch (O) {
+  case Killed:
+    Reward = (Millis > 0) ? Millis / (Millis + Tau) : 0;
+    break;
+  case Survived:
+    // The same mutant surviving again tells little new
+    Reward = SurvivalReward / (1 + PS.Operators[Operator].Survived);
+    break;
+  case Timeout:
+    Reward = 0.1;
+    break;
+  case Crash:
+    Reward = 0;
+    break;
+  }
+
+  bool WasPending = PS.Total.Pending > 0;
+  addOutcome(PS.Operators[Operator], O, Millis, Reward);
+  addOutcome(PS.Total, O, Millis, Reward);
+  // A pending pick was already counted as a play
+  if (!WasPending)
+    TotalPlays++;
+  return true;
+}
+
+//-----------------------------------------------------------------------------
+// Policies
+//-----------------------------------------------------------------------------
+// A Gamma(Shape, 1) sample (Marsaglia and Tsang), drawn from RNG only so that
+// the picks are the same with every standard library
+static double sampleGamma(double Shape, MutantRNG &RNG) {
+  static constexpr double Pi = 3.14159265358979323846;
+
+  // Gamma(a) = Gamma(a + 1) * U^(1/a)
+  if (Shape < 1)
+    return sampleGamma(Shape + 1, RNG) *
+           std::pow(1 - RNG.uniformReal(), 1 / Shape);
+
+  double D = Shape - 1.0 / 3;
+  double C = 1 / std::sqrt(9 * D);
+  for (;;) {
+    // A standard normal sample (Box-Muller)
+    double X = std::sqrt(-2 * std::log(1 - RNG.uniformReal())) *
+               std::cos(2 * Pi * RNG.uniformReal());
+    double V = 1 + C * X;
+    if (V <= 0)
+      continue;
+    V = V * V * V;
+    double U = 1 - RNG.uniformReal();
+    if (std::log(U) < X * X / 2 + D - D * V + D * std::log(V))
+      return D * V;
+  }
+}
+
+double MutationScheduler::score(const ArmStats &Arm, uint64_t Plays,
+                                MutantRNG &RNG) const {
+  double N = Arm.getNumPlays();
+
+  if (SchedPolicy == Thompson) {
+    // Beta(1 + reward, 1 + plays - reward), sampled as X / (X + Y) with
+    // X ~ Gamma(alpha), Y ~ Gamma(beta)
+    double X = sampleGamma(1 + Arm.Reward, RNG);
+    double Y = sampleGamma(1 + N - Arm.Reward, RNG);
+    return X / (X + Y);
+  }
+
+  // UCB1
+  return Arm.Reward / N + std::sqrt(2 * std::log(double(Plays)) / N);
+}
+
+size_t MutationScheduler::pickPoint(const MutationPointList &Points,
+                                    MutantRNG &RNG, ArrayRef<double> Weights) {
+  // Points that were never played come first, picked uniformly; the others
+  // are only scored as long as no such point has been seen. Every point is
+  // looked up once.
+  size_t Picked = 0;
+  uint64_t PickedKey = 0;
+  bool Found = false;
+  uint64_t NumUnplayed = 0;
+  double Best = -1;
+  for (size_t Idx = 0; Idx < Points.size(); Idx++) {
+    double Weight = Weights.empty() ? 1.0 : Weights[Idx];
+    uint64_t Key;
+    if (Weight <= 0 || !getKey(Points[Idx], Key))
+      continue;
+
+    auto It = Stats.find(Key);
+    if (It == Stats.end() || It->second.Total.getNumPlays() == 0) {
+      if (RNG.uniform(++NumUnplayed) == 0) {
+        Picked = Idx;
+        PickedKey = Key;
+        Found = true;
+      }
+      continue;
+    }
+    if (NumUnplayed > 0)
+      continue;
+
+    double Score = Weight * score(It->second.Total, TotalPlays, RNG);
+    if (Score > Best) {
+      Best = Score;
+      Picked = Idx;
+      PickedKey = Key;
+      Found = true;
+    }
+  }
+
+  if (Found)
+    getPointStats(PickedKey).Total.Pending++;
+  TotalPlays++;
+  return Picked;
+}
+
+unsigned MutationScheduler::pickOperator(const MutationPoint &Point,
+                                         unsigned NumOperators,
+                                         MutantRNG &RNG) {
+  uint64_t Key;
+  if (!getKey(Point, Key))
+    return RNG.uniform(NumOperators);
+  PointStats &PS = getPointStats(Key);
+  if (PS.Operators.size() < NumOperators)
+    PS.Operators.resize(NumOperators);
+
+  unsigned Picked = 0;
+  uint64_t NumUnplayed = 0;
+  for (unsigned Op = 0; Op < NumOperators; Op++)
+    if (PS.Operators[Op].getNumPlays() == 0 &&
+        RNG.uniform(++NumUnplayed) == 0)
+      Picked = Op;
+
+  if (NumUnplayed == 0) {
+    uint64_t Plays = 0;
+    for (unsigned Op = 0; Op < NumOperators; Op++)
+      Plays += PS.Operators[Op].getNumPlays();
+
+    double Best = -1;
+    for (unsigned Op = 0; Op < NumOperators; Op++) {
+      double Score = score(PS.Operators[Op], Plays, RNG);
+      if (Score > Best) {
+        Best = Score;
+        Picked = Op;
+      }
+    }
+  }
+
+  PS.Operators[Picked].Pending++;
+  return Picked;
+}
@@ -0,0 +1,84 @@
+//==============================================================================
+// FILE:
+//    MutationTransaction.cpp
+//
+// DESCRIPTION:
+//    Implements MutationTransaction, see MutationTransaction.h.
+//
+// License: MIT
+//==============================================================================
+#include "MutationTransaction.h"
+
+#include "llvm/IR/BasicBlock.h"
+
+using namespace llvm;
+
+void MutationTransaction::setPredicate(CmpInst &Cmp, CmpInst::Predicate Pred) {
+  Edit E{};
+  E.Kind = EditKind::Predicate;
+  E.Ins = &Cmp;
+  E.OldPredicate = Cmp.getPredicate();
+  Log.push_back(E);
+
+  Cmp.setPredicate(Pred);
+}
+
+void MutationTransaction::setOperand(Instruction &I, unsigned Idx, Value *V) {
+  Edit E{};
+  E.Kind = EditKind::Operand;
+  E.Ins = &I;
+  E.OperandIdx = Idx;
+  E.OldValue = I.getOperand(Idx);
+  Log.push_back(E);
+
+  I.setOperand(Idx, V);
+}
+
+void MutationTransaction::replaceInstruction(Instruction &Old,
+                                             Instruction *New) {
+  Edit E{};
+  E.Kind = EditKind::Replace;
+  E.Ins = &Old;
+  E.New = New;
+  E.OldOperands.append(Old.op_begin(), Old.op_end());
+
+  New->insertBefore(&Old);
+  New->takeName(&Old);
+  Old.replaceAllUsesWith(New);
+  Old.removeFromParent();
+  // A detached instruction must not keep using values that are still in the
+  // module (the verifier rejects that). The operands are restored on revert.
+  Old.dropAllReferences();
+
+  Log.push_back(std::move(E));
+}
+
+void MutationTransaction::revert() {
+  for (auto It = Log.rbegin(), End = Log.rend(); It != End; ++It) {
+    Edit &E = *It;
+    switch (E.Kind) {
+    case EditKind::Predicate:
+      cast<CmpInst>(E.Ins)->setPredicate(E.OldPredicate);
+      break;
+    case EditKind::Operand:
+      E.Ins->setOperand(E.OperandIdx, E.OldValue);
+      break;
+    case EditKind::Replace:
+      E.Ins->insertBefore(E.New);
+      for (unsigned Idx = 0; Idx < E.OldOperands.size(); Idx++)
+        E.Ins->setOperand(Idx, E.OldOperands[Idx]);
+      E.New->replaceAllUsesWith(E.Ins);
+      E.Ins->takeName(E.New);
+      E.New->eraseFromParent();
+      break;
+    }
+  }
+  Log.clear();
+}
+
+void MutationTransaction::commit() {
+  for (Edit &E : Log)
+    if (E.Kind == EditKind::Replace)
+      E.Ins->deleteValue();
+  Log.clear();
+}
@@ -0,0 +1,152 @@
+//==============================================================================
+// FILE:
+//    ProgramIndex.cpp
+//
+// DESCRIPTION:
+//    Implements ProgramIndex, see ProgramIndex.h.
+//
+// License: MIT
+//==============================================================================
+#include "ProgramIndex.h"
+
+#include "MutationPoint.h"
+
+#include "llvm/ADT/SmallString.h"
+#include "llvm/ADT/SmallVector.h"
+#include "llvm/Support/FileSystem.h"
+#include "llvm/Support/Format.h"
+#include "llvm/Support/MemoryBuffer.h"
+#include "llvm/Support/Path.h"
+#include "llvm/Support/raw_ostream.h"
+
+#include <algorithm>
+
+using namespace llvm;
+
+void ProgramIndex::addModule(StringRef ModulePath, StringRef PointFile,
+                             uint64_t NumPoints, double Weight) {
+  ProgramModule Module;
+  Module.ModulePath = ModulePath.str();
+  Module.PointFile = PointFile.str();
+  Module.FirstPoint = getNumPoints();
+  Module.NumPoints = NumPoints;
+  Module.Weight = (Weight < 0) ? double(NumPoints) : Weight;
+  // A module without points can never be drawn
+  if (NumPoints == 0)
+    Module.Weight = 0;
+
+  Cumulative.push_back((Cumulative.empty() ? 0 : Cumulative.back()) +
+                       Module.Weight);
+  Modules.push_back(std::move(Module));
+}
+
+bool ProgramIndex::load(StringRef Path) {
+  Modules.clear();
+  Cumulative.clear();
+
+  auto BufferOrErr = MemoryBuffer::getFile(Path);
+  if (!BufferOrErr) {
+    errs() << "Failed to open program index " << Path << ": "
+           << BufferOrErr.getError().message() << "\n";
+    return false;
+  }
+
+  // Relative paths are relative to the index
+  StringRef Dir = sys::path::parent_path(Path);
+  auto Resolve = [&](StringRef File) {
+    SmallString<128> Resolved;
+    if (sys::path::is_relative(File))
+      Resolved = Dir;
+    sys::path::append(Resolved, File);
+    return Resolved;
+  };
+
+  SmallVector<StringRef, 8> Lines;
+  (*BufferOrErr)->getBuffer().split(Lines, '\n', -1, /*KeepEmpty=*/false);
+  for (StringRef Line : Lines) {
+    Line = Line.rtrim("\r");
+    if (Line.trim().empty() || Line.startswith("#"))
+      continue;
+
+    SmallVector<StringRef, 5> Fields;
+    Line.split(Fields, '\t');
+    uint64_t First, NumPoints;
+    double Weight;
+    if (Fields.size() != 5 || Fields[0].getAsInteger(10, First) ||
+        Fields[1].getAsInteger(10, NumPoints) ||
+        Fields[2].getAsDouble(Weight) || Weight < 0) {
+      errs() << "Malformed line in program index " << Path << ": " << Line
+             << "\n";
+      return false;
+    }
+    if (First != getNumPoints()) {
+      errs() << "Program index " << Path << ": the points of " << Fields[3]
+             << " do not start at " << getNumPoints() << "\n";
+      return false;
+    }
+    addModule(Resolve(Fields[3]), Resolve(Fields[4]), NumPoints, Weight);
+  }
+  return true;
+}
+
+bool ProgramIndex::save(StringRef Path) const {
+  std::error_code EC;
+  raw_fd_ostream Out(Path, EC, sys::fs::OF_Text);
+  if (EC) {
+    errs() << "Failed to open " << Path << ": " << EC.message() << "\n";
+    return false;
+  }
+
+  Out << "# first\tpoints\tweight\tmodule\tpoint file\n";
+  for (const ProgramModule &Module : Modules)
+    Out << Module.FirstPoint << "\t" << Module.NumPoints << "\t"
+        << format("%.17g", Module.Weight) << "\t" << Module.ModulePath
+        << "\t" << Module.PointFile << "\n";
+  return true;
+}
+
+bool ProgramIndex::resolve(uint64_t ID, ProgramPoint &Point) const {
+  if (ID >= getNumPoints())
+    return false;
+
+  // The first module whose range ends after ID; modules without points end
+  // where they start and are skipped
+  auto It = std::partition_point(
+      Modules.begin(), Modules.end(), [&](const ProgramModule &Module) {
+        return Module.FirstPoint + Module.NumPoints <= ID;
+      });
+  Point = ProgramPoint();
+  Point.Module = It - Modules.begin();
+  Point.Point = ID - It->FirstPoint;
+  return true;
+}
+
+ProgramPoint ProgramIndex::draw(MutantRNG &RNG) const {
+  // As in WeightedPointSampler: modules of weight 0 have the cumulative
+  // weight of their predecessor and are skipped
+  double X = RNG.uniformReal() * Cumulative.back();
+  size_t Idx = std::upper_bound(Cumulative.begin(), Cumulative.end(), X) -
+               Cumulative.begin();
+
+  ProgramPoint Point;
+  Point.Module = std::min(Idx, Cumulative.size() - 1);
+  Point.Point = RNG.uniform(Modules[Point.Module].NumPoints);
+  return Point;
+}
+
+std::vector<ProgramPoint> drawProgramPoints(const ProgramIndex &Index,
+                                            uint64_t Seed,
+                                            uint64_t FirstIndex,
+                                            uint64_t Count) {
+  std::vector<ProgramPoint> Batch;
+  if (Index.empty())
+    return Batch;
+
+  for (uint64_t K = 0; K < Count; K++) {
+    MutantRNG RNG(Seed, FirstIndex + K);
+    ProgramPoint Point = Index.draw(RNG);
+    Point.Operator = drawOperator(RNG);
+    Batch.push_back(Point);
+  }
+  return Batch;
+}
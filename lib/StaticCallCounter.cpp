@@ -3,60 +3,142 @@
 //    StaticCallCounter.cpp
 //
 // DESCRIPTION:
-//    Counts the number of direct function calls (i.e. as seen in the source
-//    code) in a file.
+//    Enumerates the mutation points of a module: every instruction that
+//    has at least one mutant (see MutationOperators.h) is recorded together
+//    with its operator category, opcode (and predicate) and source location.
+//    The printed result is a point file that InjectFuncCall can sample from.
+//
+//    Functions are independent, so they are enumerated on a pool of threads.
+//    Workers take chunks of consecutive functions and the per-chunk results
+//    are concatenated in module order, so the result is the same whatever
+//    the number of threads. Nothing is written to the module or to its
+//    LLVMContext while the workers run.
+//
+//    Modules loaded lazily (getLazyIRFileModule) are enumerated in windows
+//    of one chunk per thread: the bodies of a window are materialized on the
+//    calling thread, enumerated by the workers and deleted again, so only
+//    one window of function bodies is in memory at a time.
+//
+//    With an enumeration cache (see EnumerationCache.h), every function is
+//    hashed first and only the functions whose hash is not in the cache are
+//    enumerated; the cache is then updated with them.
 //
 // USAGE:
 //    1. Run through opt - legacy pass manager
 //      opt -load <BUILD/DIR>/lib/libStaticCallCounter.so --legacy-static-cc
 //      -analyze <input-llvm-file>
 //    2. You can also run it through 'static':
-//      <BUILD/DIR>/bin/static <input-llvm-file>
+//      <BUILD/DIR>/bin/static <input-llvm-file> -o fast_mutate.txt
+//      [-cache=fast_enum.cache]
 //
 // License: MIT
 //========================================================================
-#include <iostream>
-#include <fstream>
-#include <string>
-#include <regex>
-#include <random>
-#include <cstdio>
-#include <cstdarg>
-#include <cstdlib>
-#include <ctime>
+#include <algorithm>
+#include <atomic>
+#include <thread>
+#include <vector>
 #include "StaticCallCounter.h"
+#include "EnumerationCache.h"
+#include "MutationOperators.h"
 #include "llvm/IR/BasicBlock.h"
+#include "llvm/IR/DebugInfoMetadata.h"
 #include "llvm/IR/Instruction.h"
 #include "llvm/IR/Instructions.h"
 #include "llvm/Passes/PassBuilder.h"
 #include "llvm/Passes/PassPlugin.h"
+#include "llvm/Support/CommandLine.h"
+#include "llvm/Support/Error.h"
 #include "llvm/Support/Format.h"
-#include "llvm/IR/IRBuilder.h"
 
 using namespace llvm;
 
-// 日志函数 by cyh --- start
-class Logger {
-  public:
-    Logger(bool enabled) : enabled_ (enabled) {}
-
-    void log(const char* format, ...) {
-      if (enabled_) {
-        va_list args;
-        va_start(args, format);
-        vprintf(format, args);
-        va_end(args);
+//-----------------------------------------------------------------------------
+// Command line options
+//-----------------------------------------------------------------------------
+static cl::opt<unsigned> NumThreads{
+    "fast-enumerate-threads",
+    cl::desc("Number of threads the mutation points are enumerated on (0: "
+             "one per core)"),
+    cl::value_desc("N"), cl::init(0)};
+
+static cl::opt<std::string> CacheFile{
+    "fast-enumerate-cache",
+    cl::desc("Take the points of unchanged functions from this enumeration "
+             "cache and add the others to it"),
+    cl::value_desc("filename"), cl::init("")};
+
+// Functions are handed to the workers in chunks of this many
+static constexpr size_t ChunkSize = 256;
+
+// Appends the mutation points of F, the FuncID-th function of its module,
+// to Points. StableIDKind is the metadata kind of stable IDs.
+static void enumerateFunction(Function &F, uint32_t FuncID,
+                              unsigned StableIDKind, LoopInfoCache &Loops,
+                              ResultStaticCC &Points) {
+  uint32_t bbID = 0;
+  for (auto &BB : F) {
+    uint32_t insID = 0;
+    for (auto &Ins : BB) {
+      unsigned NumMutants = getNumMutants(Ins, &Loops);
+      if (NumMutants > 0) {
+        MutationPointRecord Record;
+        Record.Point.FuncID = FuncID;
+        Record.Point.BBID = bbID;
+        Record.Point.InsID = insID;
+        getStableID(Ins, StableIDKind, Record.Point.StableID);
+
+        Record.Category = getMutationCategory(Ins, &Loops);
+        Record.Opcode = Ins.getOpcode();
+        if (auto *Cmp = dyn_cast<CmpInst>(&Ins))
+          Record.Predicate = Cmp->getPredicate();
+        Record.NumMutants = NumMutants;
+
+        if (const DILocation *Loc = Ins.getDebugLoc().get()) {
+          Record.File = Loc->getFilename();
+          Record.Line = Loc->getLine();
+          Record.Column = Loc->getColumn();
+        }
+        Points.push_back(Record);
       }
+      insID++;
     }
+    bbID++;
+  }
+}
 
-    void setEnabled(bool enabled) {
-      enabled_ = enabled;
+// Fills in the fields of the cached points of F that the cache does not
+// store: the funcID, the stable IDs and the file names
+static void completeCachedPoints(Function &F, uint32_t FuncID,
+                                 unsigned StableIDKind,
+                                 MutableArrayRef<MutationPointRecord> Points) {
+  auto Next = Points.begin();
+  uint32_t bbID = 0;
+  for (auto &BB : F) {
+    uint32_t insID = 0;
+    for (auto &Ins : BB) {
+      if (Next != Points.end() && Next->Point.BBID == bbID &&
+          Next->Point.InsID == insID) {
+        Next->Point.FuncID = FuncID;
+        getStableID(Ins, StableIDKind, Next->Point.StableID);
+        if (const DILocation *Loc = Ins.getDebugLoc().get())
+          Next->File = Loc->getFilename();
+        ++Next;
+      }
+      insID++;
     }
+    bbID++;
+  }
+}
 
-  private:
-    bool enabled_;
+namespace {
+// The points of a function that was not in the cache: Count points from
+// First on in the result of its chunk
+struct CacheMiss {
+  uint64_t Hash;
+  size_t First;
+  size_t Count;
 };
-// 日志函数 by cyh --- end
+} // namespace
 
 //-----------------------------------------------------------------------------
 // StaticCallCounter Implementation
@@ -64,416 +146,103 @@ class Logger {
 AnalysisKey StaticCallCounter::Key;
 
 StaticCallCounter::Result StaticCallCounter::runOnModule(Module &M) {
-
-  // 初始化日志类
-  Logger logger(true);
-
-  // 初始化随机数种子
-  srand(time(NULL)); // seed the random number generator with the current time
-
-  llvm::DenseMap<const llvm::Function *, unsigned> Res;
-
-  // 一个三元组Vector，用来储存所有的突变点
-  std::vector<std::tuple<int, int, int>> MutationPoints;
-
-  // 用来解析突变点文件的正则表达式 
-  std::regex pattern("\\((\\d+),\\s*(\\d+),\\s*(\\d+)\\)");
-
-  // 读取 Mutation Point 文件
-  std::ifstream file("fast_mutate.txt"); // open the file
-  if (file.is_open()) { // check if the file was opened successfully
-    std::string line;
-    while (std::getline(file, line)) { // read each line of the file
-      std::smatch matches;
-      if (std::regex_match(line, matches, pattern)) {
-        std::tuple<int, int, int> point(std::stoi(matches[1]), std::stoi(matches[2]), std::stoi(matches[3]));
-        MutationPoints.push_back(point);
-      }
-      else {
-        std::cerr << "Regex cannot parse\n";
-        exit(1);
-      }
-    }
-    file.close(); // close the file when we're done
-  } else {
-    std::cerr << "Failed to open mutation point file\n";
-    exit(1);
-  }
-
-  int index = rand() % MutationPoints.size();
-
-  // 抽取随机突变点
-  std::tuple<int, int, int> random_point = MutationPoints[index];
-
-  // If program reach here, means reading mutationPoint file successfully
-  logger.log("the mutation point selected is (%d, %d, %d)\n", 
-    std::get<0>(random_point), std::get<1>(random_point), std::get<2>(random_point));
-
-  exit(0);
-
-  // 初始化突变选择子
-  int mutate_sel = -1;
-  // 标注是否修改
-  bool modified = false;
-
-  int funcID = 0;
-  
-  for (auto &Func : M) {
-
-    if(funcID != std::get<0>(random_point)) {
-      funcID++;
-      continue;
-    }
-
-    int bbID = 0;
-
-    for (auto &BB : Func) {
-
-      if(bbID != std::get<1>(random_point)) {
-        bbID++;
-        continue;
-      }
-
-      int insID = 0;
-
-      for (auto &Ins : BB) {
-
-        if(insID != std::get<2>(random_point)) {
-          insID++;
+  std::vector<Function *> Functions;
+  Functions.reserve(M.size());
+  for (Function &F : M)
+    Functions.push_back(&F);
+
+  // 元数据种类要在主线程里注册，工作线程只读取
+  unsigned StableIDKind = M.getContext().getMDKindID(StableIDMDKind);
+
+  size_t NumChunks = (Functions.size() + ChunkSize - 1) / ChunkSize;
+  std::vector<ResultStaticCC> Chunks(NumChunks);
+  std::vector<std::vector<CacheMiss>> Misses(NumChunks);
+  std::atomic<size_t> NextChunk{0};
+  size_t WindowEnd = 0;
+  auto Worker = [&]() {
+    for (size_t Chunk; (Chunk = NextChunk++) < WindowEnd;) {
+      // The loops of a chunk are not needed once it is done
+      LoopInfoCache Loops;
+      ResultStaticCC &Points = Chunks[Chunk];
+      size_t End = std::min(Functions.size(), (Chunk + 1) * ChunkSize);
+      for (size_t Idx = Chunk * ChunkSize; Idx < End; Idx++) {
+        Function &F = *Functions[Idx];
+        if (!Cache) {
+          enumerateFunction(F, Idx, StableIDKind, Loops, Points);
           continue;
         }
 
-        if (isa<ICmpInst>(&Ins)) {  
-          // MutationPoints.push_back(std::make_tuple(functionName, bbcounter, icounter));
-          // This is an icmp instruction
-          ICmpInst *icmpInst = cast<ICmpInst>(&Ins);
-          // Get the icmp predicate
-          CmpInst::Predicate predicate = icmpInst->getPredicate();
-          // Print the corresponding string representation of the predicate
-          switch (predicate) {
-            // 2 Not ! Drop the operator        作为 icmp ne 处理，即 value != 0
-            // 19 Neq != ==
-            case CmpInst::ICMP_NE:
-              icmpInst->setPredicate(CmpInst::ICMP_EQ);
-              modified = true;
-              logger.log("icmp ne\n");
-              break;
-            // 14 Lt < One of <=, >=, >, ==, !=
-            case CmpInst::ICMP_SLT:
-              mutate_sel = rand() % 5;
-              if(0 == mutate_sel)
-                icmpInst->setPredicate(CmpInst::ICMP_SLE);
-              else if(1 == mutate_sel)
-                icmpInst->setPredicate(CmpInst::ICMP_SGE);
-              else if(2 == mutate_sel)
-                icmpInst->setPredicate(CmpInst::ICMP_SGT);
-              else if(3 == mutate_sel)
-                icmpInst->setPredicate(CmpInst::ICMP_EQ);
-              else
-                icmpInst->setPredicate(CmpInst::ICMP_NE);
-              modified = true;
-              logger.log("icmp slt\n");
-              break;
-            case CmpInst::ICMP_ULT:
-              mutate_sel = rand() % 5;
-              if(0 == mutate_sel)
-                icmpInst->setPredicate(CmpInst::ICMP_ULE);
-              else if(1 == mutate_sel)
-                icmpInst->setPredicate(CmpInst::ICMP_UGE);
-              else if(2 == mutate_sel)
-                icmpInst->setPredicate(CmpInst::ICMP_UGT);
-              else if(3 == mutate_sel)
-                icmpInst->setPredicate(CmpInst::ICMP_EQ);
-              else
-                icmpInst->setPredicate(CmpInst::ICMP_NE);
-              modified = true;
-              logger.log("icmp ult\n");
-              break;
-            // 15 Le <= One of <, >=, >, ==, !=
-            case CmpInst::ICMP_SLE:
-              mutate_sel = rand() % 5;
-              if(0 == mutate_sel)
-                icmpInst->setPredicate(CmpInst::ICMP_SLT);
-              else if(1 == mutate_sel)
-                icmpInst->setPredicate(CmpInst::ICMP_SGE);
-              else if(2 == mutate_sel)
-                icmpInst->setPredicate(CmpInst::ICMP_SGT);
-              else if(3 == mutate_sel)
-                icmpInst->setPredicate(CmpInst::ICMP_EQ);
-              else
-                icmpInst->setPredicate(CmpInst::ICMP_NE);
-              modified = true;
-              logger.log("icmp sle\n");
-              break;
-            case CmpInst::ICMP_ULE:
-              mutate_sel = rand() % 5;
-              if(0 == mutate_sel)
-                icmpInst->setPredicate(CmpInst::ICMP_ULT);
-              else if(1 == mutate_sel)
-                icmpInst->setPredicate(CmpInst::ICMP_UGE);
-              else if(2 == mutate_sel)
-                icmpInst->setPredicate(CmpInst::ICMP_UGT);
-              else if(3 == mutate_sel)
-                icmpInst->setPredicate(CmpInst::ICMP_EQ);
-              else
-                icmpInst->setPredicate(CmpInst::ICMP_NE);
-              modified = true;
-              logger.log("icmp ule\n");
-              break;
-            // 16 Ge >= One of <, <=, >, ==, !=
-            case CmpInst::ICMP_SGE:
-              mutate_sel = rand() % 5;
-              if(0 == mutate_sel)
-                icmpInst->setPredicate(CmpInst::ICMP_SLT);
-              else if(1 == mutate_sel)
-                icmpInst->setPredicate(CmpInst::ICMP_SLE);
-              else if(2 == mutate_sel)
-                icmpInst->setPredicate(CmpInst::ICMP_SGT);
-              else if(3 == mutate_sel)
-                icmpInst->setPredicate(CmpInst::ICMP_EQ);
-              else
-                icmpInst->setPredicate(CmpInst::ICMP_NE);
-              modified = true;
-              logger.log("icmp sge\n");
-              break;
-            case CmpInst::ICMP_UGE:
-              mutate_sel = rand() % 5;
-              if(0 == mutate_sel)
-                icmpInst->setPredicate(CmpInst::ICMP_ULT);
-              else if(1 == mutate_sel)
-                icmpInst->setPredicate(CmpInst::ICMP_ULE);
-              else if(2 == mutate_sel)
-                icmpInst->setPredicate(CmpInst::ICMP_UGT);
-              else if(3 == mutate_sel)
-                icmpInst->setPredicate(CmpInst::ICMP_EQ);
-              else
-                icmpInst->setPredicate(CmpInst::ICMP_NE);
-              modified = true;
-              logger.log("icmp uge\n");
-              break;
-            // 17 Gt > One of <, <=, >=, ==, !=
-            case CmpInst::ICMP_SGT:
-              mutate_sel = rand() % 5;
-              if(0 == mutate_sel)
-                icmpInst->setPredicate(CmpInst::ICMP_SLT);
-              else if(1 == mutate_sel)
-                icmpInst->setPredicate(CmpInst::ICMP_SLE);
-              else if(2 == mutate_sel)
-                icmpInst->setPredicate(CmpInst::ICMP_SGE);
-              else if(3 == mutate_sel)
-                icmpInst->setPredicate(CmpInst::ICMP_EQ);
-              else
-                icmpInst->setPredicate(CmpInst::ICMP_NE);
-              modified = true;
-              logger.log("icmp sgt\n");
-              break;
-            case CmpInst::ICMP_UGT:
-              mutate_sel = rand() % 5;
-              if(0 == mutate_sel)
-                icmpInst->setPredicate(CmpInst::ICMP_ULT);
-              else if(1 == mutate_sel)
-                icmpInst->setPredicate(CmpInst::ICMP_ULE);
-              else if(2 == mutate_sel)
-                icmpInst->setPredicate(CmpInst::ICMP_UGE);
-              else if(3 == mutate_sel)
-                icmpInst->setPredicate(CmpInst::ICMP_EQ);
-              else
-                icmpInst->setPredicate(CmpInst::ICMP_NE);
-              modified = true;
-              logger.log("icmp ugt\n");
-              break;
-            // 18 Equality Eq == !=
-            case CmpInst::ICMP_EQ:
-              icmpInst->setPredicate(CmpInst::ICMP_NE);
-              modified = true;
-              logger.log("icmp eq\n");
-              break;
-            default:
-              logger.log("unknown icmp predicate\n");
-              continue;
-              break;
-          }
-        }
-        else if (auto *op = dyn_cast<UnaryOperator>(&Ins)) { 
-          errs() << "Unary operator: " << op->getOpcodeName() << "\n";
-        }
-        else if (auto *op = dyn_cast<BinaryOperator>(&Ins)) { 
-          // 初始化 IRBuilder
-          IRBuilder<> builder(op);
-          Value* lhs = op->getOperand(0);
-          Value* rhs = op->getOperand(1);
-          Value* newop = NULL;
-
-          switch (op->getOpcode()) {
-            // 1 Unary Neg - Drop the operator  似乎作为 0 - operand 了，突变相当于改成 + 号
-            // 4 Sub - One of +, *, /, %
-            // TODO: 没有做有符号/无符号的区分
-            case Instruction::Sub:
-              mutate_sel = rand() % 4;
-              if(0 == mutate_sel)
-                newop = builder.CreateAdd(lhs, rhs);
-              else if(1 == mutate_sel)
-                newop = builder.CreateMul(lhs, rhs);
-              else if(2 == mutate_sel)
-                newop = builder.CreateSDiv(lhs, rhs);
-              else
-                newop = builder.CreateSRem(lhs, rhs);
-              logger.log("cyh: sub\n");
-              break;
-            // 3 Add + One of -, *, /, %
-            case Instruction::Add:
-              mutate_sel = rand() % 4;
-              if(0 == mutate_sel)
-                newop = builder.CreateSub(lhs, rhs);
-              else if(1 == mutate_sel)
-                newop = builder.CreateMul(lhs, rhs);
-              else if(2 == mutate_sel)
-                newop = builder.CreateSDiv(lhs, rhs);
-              else
-                newop = builder.CreateSRem(lhs, rhs);
-              logger.log("cyh: add\n");
-              break;
-            // 5 mul * one of +, -, /, %
-            case Instruction::Mul:
-              mutate_sel = rand() % 4;
-              if(0 == mutate_sel)
-                newop = builder.CreateAdd(lhs, rhs);
-              else if(1 == mutate_sel)
-                newop = builder.CreateSub(lhs, rhs);
-              else if(2 == mutate_sel)
-                newop = builder.CreateSDiv(lhs, rhs);
-              else
-                newop = builder.CreateSRem(lhs, rhs);
-              logger.log("cyh: mul\n");
-              break;
-            // 6 div / one of +, -, *, %
-            case Instruction::SDiv:
-              mutate_sel = rand() % 4;
-              if(0 == mutate_sel)
-                newop = builder.CreateAdd(lhs, rhs);
-              else if(1 == mutate_sel)
-                newop = builder.CreateSub(lhs, rhs);
-              else if(2 == mutate_sel)
-                newop = builder.CreateMul(lhs, rhs);
-              else
-                newop = builder.CreateSRem(lhs, rhs);
-              logger.log("cyh: sdiv\n");
-              break;
-            case Instruction::UDiv:
-              mutate_sel = rand() % 4;
-              if(0 == mutate_sel)
-                newop = builder.CreateAdd(lhs, rhs);
-              else if(1 == mutate_sel)
-                newop = builder.CreateSub(lhs, rhs);
-              else if(2 == mutate_sel)
-                newop = builder.CreateMul(lhs, rhs);
-              else
-                newop = builder.CreateURem(lhs, rhs);
-              logger.log("cyh: udiv\n");
-              break;
-            // 7 mod % one of +, -, *, /
-            case Instruction::SRem:
-              mutate_sel = rand() % 4;
-              if(0 == mutate_sel)
-                newop = builder.CreateAdd(lhs, rhs);
-              else if(1 == mutate_sel)
-                newop = builder.CreateSub(lhs, rhs);
-              else if(2 == mutate_sel)
-                newop = builder.CreateMul(lhs, rhs);
-              else
-                newop = builder.CreateSDiv(lhs, rhs);
-              logger.log("cyh: srem\n");
-              break;
-            case Instruction::URem:
-              mutate_sel = rand() % 4;
-              if(0 == mutate_sel)
-                newop = builder.CreateAdd(lhs, rhs);
-              else if(1 == mutate_sel)
-                newop = builder.CreateSub(lhs, rhs);
-              else if(2 == mutate_sel)
-                newop = builder.CreateMul(lhs, rhs);
-              else
-                newop = builder.CreateUDiv(lhs, rhs);
-              logger.log("cyh: urem\n");
-              break;
-            // 8 bitand & one of |, ˆ
-            case Instruction::And:
-              mutate_sel = rand() % 2;
-              if(0 == mutate_sel)
-                newop = builder.CreateOr(lhs, rhs);
-              else
-                newop = builder.CreateXor(lhs, rhs);
-              logger.log("cyh: and\n");
-              break;
-            // 9 bitor | one of &, ˆ
-            case Instruction::Or:
-              mutate_sel = rand() % 2;
-              if(0 == mutate_sel)
-                newop = builder.CreateAnd(lhs, rhs);
-              else
-                newop = builder.CreateXor(lhs, rhs);
-              logger.log("cyh: or\n");
-              break;
-            // 10 bitxor ˆ one of &, |
-            case Instruction::Xor:
-              mutate_sel = rand() % 2;
-              if(0 == mutate_sel)
-                newop = builder.CreateAnd(lhs, rhs);
-              else
-                newop = builder.CreateOr(lhs, rhs);
-              logger.log("cyh: xor\n");
-              break;
-            // 11 shl « one of »l, »a
-            case Instruction::Shl:
-              mutate_sel = rand() % 2;
-              if(0 == mutate_sel)
-                newop = builder.CreateLShr(lhs, rhs);
-              else
-                newop = builder.CreateAShr(lhs, rhs);
-              logger.log("cyh: shl\n");
-              break;
-            // 12 lshr »l shl «
-            case Instruction::LShr:
-              newop = builder.CreateShl(lhs, rhs);
-              logger.log("cyh: lshr\n");
-              break;
-            // 13 ashr »a shl «
-            case Instruction::AShr:
-              newop = builder.CreateShl(lhs, rhs);
-              logger.log("cyh: ashr\n");
-              break;
-            default:
-              errs() << "Binary operator: " << op->getOpcodeName() << "\n";
-              continue;
-              break;
-          }
-
-          // Everywhere the old instruction was used as an operand, use our
-          // new multiply instruction instead.
-          for (auto& U : op->uses()) {
-            User* user = U.getUser();  // A User is anything with operands.
-            user->setOperand(U.getOperandNo(), newop);
-          }
-
-          (&Ins)->eraseFromParent(); // 删除旧指令
-
-          modified = true;
-
+        // 函数没有变化时直接使用缓存中的突变点
+        uint64_t Hash = hashFunction(F);
+        size_t First = Points.size();
+        if (Cache->lookup(Hash, Points)) {
+          completeCachedPoints(
+              F, Idx, StableIDKind,
+              MutableArrayRef<MutationPointRecord>(Points).slice(First));
+          continue;
         }
-
-        insID++;
-
+        enumerateFunction(F, Idx, StableIDKind, Loops, Points);
+        Misses[Chunk].push_back({Hash, First, Points.size() - First});
       }
-
-      bbID++;
-
+    }
+  };
+
+  unsigned Threads = NumThreads;
+  if (Threads == 0)
+    Threads = std::max(1u, std::thread::hardware_concurrency());
+  Threads = std::max<size_t>(1, std::min<size_t>(Threads, NumChunks));
+
+  // 延迟加载的模块按窗口物化函数体，枚举完就删除，内存占用只和窗口大小有关
+  bool Lazy = M.getMaterializer() != nullptr;
+  size_t WindowChunks = Lazy ? Threads : std::max<size_t>(NumChunks, 1);
+  std::vector<Function *> Materialized;
+  for (size_t WindowBegin = 0; WindowBegin < NumChunks;
+       WindowBegin += WindowChunks) {
+    WindowEnd = std::min(NumChunks, WindowBegin + WindowChunks);
+    size_t FuncEnd = std::min(Functions.size(), WindowEnd * ChunkSize);
+
+    // Only bodies materialized here are deleted again
+    Materialized.clear();
+    for (size_t Idx = WindowBegin * ChunkSize; Lazy && Idx < FuncEnd; Idx++) {
+      Function &F = *Functions[Idx];
+      if (!F.isMaterializable())
+        continue;
+      if (Error E = F.materialize())
+        logAllUnhandledErrors(std::move(E), errs(),
+                              "Failed to materialize " + F.getName() + ": ");
+      else
+        Materialized.push_back(&F);
     }
 
-    funcID++;
+    NextChunk = WindowBegin;
+    std::vector<std::thread> Pool;
+    for (unsigned T = 1; T < Threads; T++)
+      Pool.emplace_back(Worker);
+    Worker();
+    for (std::thread &T : Pool)
+      T.join();
 
+    for (Function *F : Materialized)
+      F->deleteBody();
   }
 
-  return Res;
+  // 把新枚举的函数加入缓存
+  if (Cache)
+    for (size_t Chunk = 0; Chunk < NumChunks; Chunk++)
+      for (const CacheMiss &Miss : Misses[Chunk])
+        Cache->insert(Miss.Hash, makeArrayRef(Chunks[Chunk])
+                                     .slice(Miss.First, Miss.Count));
+
+  // 按模块顺序合并各个分块的结果
+  size_t NumPoints = 0;
+  for (const ResultStaticCC &Chunk : Chunks)
+    NumPoints += Chunk.size();
+
+  Result Points;
+  Points.reserve(NumPoints);
+  for (const ResultStaticCC &Chunk : Chunks)
+    Points.insert(Points.end(), Chunk.begin(), Chunk.end());
+  return Points;
 }
 
 StaticCallCounter::Result
@@ -481,16 +250,25 @@ StaticCallCounter::run(llvm::Module &M, llvm::ModuleAnalysisManager &) {
   return runOnModule(M);
 }
 
+LegacyStaticCallCounter::LegacyStaticCallCounter()
+    : llvm::ModulePass(ID), Impl(NumThreads) {}
+
 void LegacyStaticCallCounter::print(raw_ostream &OutS, Module const *) const {
-  // TODO: do nothing here
-  // printStaticCCResult(OutS, DirectCalls);
+  printStaticCCResult(OutS, Points);
 }
 
 bool LegacyStaticCallCounter::runOnModule(llvm::Module &M) {
+  if (CacheFile.empty()) {
+    Points = Impl.runOnModule(M);
+    return false;
+  }
 
-  printf("In Legacy\n");
-
-  DirectCalls = Impl.runOnModule(M);
+  EnumerationCache Cache;
+  if (!Cache.load(CacheFile))
+    exit(1);
+  Points = StaticCallCounter(NumThreads, &Cache).runOnModule(M);
+  if (!Cache.save(CacheFile))
+    exit(1);
   return false;
 }
 
@@ -502,7 +280,8 @@ llvm::PassPluginLibraryInfo getStaticCallCounterPluginInfo() {
           [](PassBuilder &PB) {
             PB.registerAnalysisRegistrationCallback(
                 [](ModuleAnalysisManager &MAM) {
-                  MAM.registerPass([&] { return StaticCallCounter(); });
+                  MAM.registerPass(
+                      [&] { return StaticCallCounter(NumThreads); });
                 });
           }};
 };
@@ -519,7 +298,7 @@ char LegacyStaticCallCounter::ID = 0;
 
 // Register the pass - required for (among others) opt
 RegisterPass<LegacyStaticCallCounter>
-    X("legacy-static-cc", "For each function print the number of direct calls",
+    X("legacy-static-cc", "Enumerate the mutation points of the module",
       true, // Doesn't modify the CFG => true
       true  // It's a pure analysis pass => true
     );
@@ -527,40 +306,47 @@ RegisterPass<LegacyStaticCallCounter>
 //------------------------------------------------------------------------------
 // Helper functions
 //------------------------------------------------------------------------------
-void printStaticCCResult(raw_ostream &OutS, const ResultStaticCC &DirectCalls) {
-  // TODO: 这部分代码是用来打印静态分析结果的，先注释掉
-  // OutS << "================================================="
-  //      << "\n";
-  // OutS << "LLVM-TUTOR: static analysis results\n";
-  // OutS << "=================================================\n";
-  // const char *str1 = "NAME";
-  // const char *str2 = "#N DIRECT CALLS";
-  // OutS << format("%-20s %-10s\n", str1, str2);
-  // OutS << "-------------------------------------------------"
-  //      << "\n";
-
-  // // Generate a vector of captured functions, sorted alphabetically by function
-  // // names. The solution implemented here is a suboptimal - a separate
-  // // container with functions is created for sorting.
-  // // TODO Make this more elegant (i.e. avoid creating a separate container)
-  // std::vector<const Function *> FuncNames;
-  // FuncNames.reserve(DirectCalls.size());
-  // for (auto &CallCount : DirectCalls) {
-  //   FuncNames.push_back(CallCount.getFirst());
-  // }
-  // std::sort(FuncNames.begin(), FuncNames.end(),
-  //           [](const Function *x, const Function *y) {
-  //             return (x->getName().str() < y->getName().str());
-  //           });
-
-  // // Print functions (alphabetically)
-  // for (auto &Func : FuncNames) {
-  //   unsigned NumDirectCalls = (DirectCalls.find(Func))->getSecond();
-  //   OutS << format("%-20s %-10lu\n", Func->getName().str().c_str(),
-  //                  NumDirectCalls);
-  // }
+static const char *getPredicateName(unsigned Predicate) {
+  switch (Predicate) {
+  case CmpInst::ICMP_EQ:
+    return "eq";
+  case CmpInst::ICMP_NE:
+    return "ne";
+  case CmpInst::ICMP_UGT:
+    return "ugt";
+  case CmpInst::ICMP_UGE:
+    return "uge";
+  case CmpInst::ICMP_ULT:
+    return "ult";
+  case CmpInst::ICMP_ULE:
+    return "ule";
+  case CmpInst::ICMP_SGT:
+    return "sgt";
+  case CmpInst::ICMP_SGE:
+    return "sge";
+  case CmpInst::ICMP_SLT:
+    return "slt";
+  case CmpInst::ICMP_SLE:
+    return "sle";
+  default:
+    return nullptr;
+  }
 }
 
+void printStaticCCResult(raw_ostream &OutS, const ResultStaticCC &Points) {
+  for (const MutationPointRecord &Record : Points) {
+    OutS << formatPoint(Record.Point) << " # " << unsigned(Record.Category)
+         << " " << Instruction::getOpcodeName(Record.Opcode);
+    if (Record.Opcode == Instruction::ICmp)
+      if (const char *Name = getPredicateName(Record.Predicate))
+        OutS << " " << Name;
+    if (Record.Line)
+      OutS << " " << Record.File << ":" << Record.Line << ":" << Record.Column;
+    OutS << "\n";
+  }
+}
+
+
         // // As per the comments in CallSite.h (more specifically, comments for
         // // the base class CallSiteBase), ImmutableCallSite constructor creates
         // // a valid call-site or NULL for something which is NOT a call site.
@@ -5,34 +5,47 @@
 ; is correct.
 
 ; The global variables inserted by the pass
-; CHECK: @CounterFor_foo = common global i32 0, align 4
+; CHECK: @__fast_cc_counters = internal global [1 x [1 x i64]] zeroinitializer, section "fast_cc_counters", align 64
 ; CHECK-NEXT: @0 = private unnamed_addr constant [4 x i8] c"foo\00", align 1
+; CHECK-NEXT: @__fast_cc_names = private constant [1 x i8*] [i8* getelementptr inbounds ([4 x i8], [4 x i8]* @0, i32 0, i32 0)], section "fast_cc_names"
 ; CHECK-NEXT: @ResultFormatStrIR = global [14 x i8]
 ; CHECK-NEXT: @ResultHeaderStrIR = global [225 x i8]
+; CHECK-NEXT: @__fast_cc_snapshot = internal global [1 x i64] zeroinitializer, align 8
 ; CHECK-NEXT: @llvm.global_dtors = appending global
 ; CHECK-SAME: @printf_wrapper
 
 define void @foo() {
 ; CHECK-LABEL: @foo(
 ; Call-counting instructions inserted by the pass
-; CHECK-NEXT:    [[TMP1:%.*]] = load i32, i32* @CounterFor_foo
-; CHECK-NEXT:    [[TMP2:%.*]] = add i32 1, [[TMP1]]
-; CHECK-NEXT:    store i32 [[TMP2]], i32* @CounterFor_foo
+; CHECK-NEXT:    [[TMP1:%.*]] = load i64, i64* {{.*}}@__fast_cc_counters
+; CHECK-NEXT:    [[TMP2:%.*]] = add i64 1, [[TMP1]]
+; CHECK-NEXT:    store i64 [[TMP2]], i64* {{.*}}@__fast_cc_counters
 ; CHECK-NEXT:    ret void
 ;
   ret void
 }
 
+; The dump copies the counters with a single memcpy
+; CHECK-LABEL: define internal i64 @__fast_cc_dump(i64*
+; CHECK: call void @llvm.memcpy.p0i8.p0i8.i64(i8* align 8 {{%.*}}, i8* align 64 bitcast ([1 x [1 x i64]]* @__fast_cc_counters to i8*), i64 8, i1 false)
+; CHECK-NEXT: ret i64 1
+
 ; Declaration of `printf` inserted by the pass
 ; CHECK: declare i32 @printf(i8* nocapture readonly, ...) #0
 
 ; Definition of `printf_wrapper` inserted by the pass
 ; CHECK: define void @printf_wrapper() {
 ; CHECK-NEXT: enter:
-; CHECK-NEXT:  %0 = call i32 (i8*, ...) @printf
+; CHECK-NEXT:  %0 = call i64 @__fast_cc_dump({{.*}}@__fast_cc_snapshot
+; CHECK-NEXT:  %1 = call i32 (i8*, ...) @printf
 ; CHECK-SAME: @ResultHeaderStrIR
-; CHECK-NEXT:  %1 = load i32, i32* @CounterFor_foo
-; CHECK-NEXT:  %2 = call i32 (i8*, ...) @printf
+; CHECK-NEXT:  br label %print
+; CHECK: print:
+; CHECK: getelementptr inbounds [1 x i8*], [1 x i8*]* @__fast_cc_names
+; CHECK: getelementptr inbounds [1 x i64], [1 x i64]* @__fast_cc_snapshot
+; CHECK: call i32 (i8*, ...) @printf
 ; CHECK-SAME: @ResultFormatStrIR
+; CHECK: icmp eq i64 {{%.*}}, 1
+; CHECK: exit:
 ; CHECK-NEXT:  ret void
 ; CHECK-NEXT: }
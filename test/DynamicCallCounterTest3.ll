@@ -2,7 +2,7 @@
 
 declare void @foo()
 
-; CHECK-NOT: @CounterFor_foo
+; CHECK-NOT: @__fast_cc_counters
 ; CHECK-NOT: @ResultFormatStrIR = global [14 x i8]
 ; CHECK-NOT: @ResultHeaderStrIR = global [225 x i8]
 
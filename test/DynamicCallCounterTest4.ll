@@ -0,0 +1,53 @@
+; RUN: opt -load %shlibdir/libDynamicCallCounter%shlibext -legacy-dynamic-cc -fast-counter-mode=atomic -verify %S/Inputs/CallCounterInput.ll -o %t.atomic.bin
+; RUN: lli %t.atomic.bin | FileCheck --check-prefix=COUNTS %s
+; RUN: opt -load %shlibdir/libDynamicCallCounter%shlibext -legacy-dynamic-cc -fast-counter-mode=atomic -verify -S %s | FileCheck --check-prefix=ATOMIC %s
+; RUN: opt -load %shlibdir/libDynamicCallCounter%shlibext -legacy-dynamic-cc -fast-counter-mode=sharded -fast-counter-shards=4 -verify -S %s | FileCheck --check-prefix=SHARDED %s
+
+; Verify the thread safe counter modes of DynamicCallCounter: atomic mode
+; counts as the default mode does, and sharded mode increments the counter
+; in the row of the calling thread and folds the rows into one when dumping.
+
+; COUNTS: foo                  13
+; COUNTS-NEXT: bar                  2
+; COUNTS-NEXT: fez                  1
+; COUNTS-NEXT: main                 1
+
+; ATOMIC-LABEL: @foo(
+; ATOMIC-NEXT: atomicrmw add i64* {{.*}}@__fast_cc_counters, i64 0, i64 0, i64 0), i64 1 monotonic
+; ATOMIC-NEXT: ret void
+
+; One row of 8 counters (a cache line) per shard
+; SHARDED: @__fast_cc_counters = internal global [4 x [8 x i64]] zeroinitializer, section "fast_cc_counters", align 64
+; SHARDED: @__fast_cc_shard_id = internal thread_local global i32 0
+
+; SHARDED-LABEL: @foo(
+; SHARDED-NEXT: [[SHARD:%.*]] = call i32 @__fast_cc_shard()
+; SHARDED-NEXT: [[IDX:%.*]] = zext i32 [[SHARD]] to i64
+; SHARDED-NEXT: [[PTR:%.*]] = getelementptr inbounds [4 x [8 x i64]], [4 x [8 x i64]]* @__fast_cc_counters, i64 0, i64 [[IDX]], i64 0
+; SHARDED-NEXT: atomicrmw add i64* [[PTR]], i64 1 monotonic
+; SHARDED-NEXT: ret void
+
+; SHARDED-LABEL: @bar(
+; SHARDED: getelementptr inbounds [4 x [8 x i64]], [4 x [8 x i64]]* @__fast_cc_counters, i64 0, i64 {{%.*}}, i64 1
+
+; SHARDED-LABEL: define internal i32 @__fast_cc_shard()
+; SHARDED: atomicrmw add i32* @__fast_cc_next_shard, i32 1 monotonic
+; SHARDED: urem i32 {{%.*}}, 4
+
+; Rows 1 - 3 are moved into row 0 when the counters are dumped
+; SHARDED-LABEL: define internal i64 @__fast_cc_dump(i64*
+; SHARDED: fold:
+; SHARDED: urem i64 {{%.*}}, 8
+; SHARDED: atomicrmw xchg i64* {{%.*}}, i64 0 monotonic
+; SHARDED: icmp eq i64 {{%.*}}, 32
+; SHARDED: copy:
+; SHARDED: call void @llvm.memcpy
+
+define void @foo() {
+  ret void
+}
+
+define void @bar() {
+  call void @foo()
+  ret void
+}
@@ -0,0 +1,53 @@
+; RUN: opt -load %shlibdir/libDynamicCallCounter%shlibext -legacy-dynamic-cc -fast-counter-file=%t.default.cc -verify %S/Inputs/CallCounterInput.ll -o %t.bin
+; RUN: rm -f %t.default.cc %t.env.cc
+; RUN: lli %t.bin | FileCheck --allow-empty --check-prefix=EXIT %s
+; RUN: ../bin/fast-cc-read %t.default.cc | FileCheck --check-prefix=COUNTS %s
+; RUN: env FAST_CC_FILE=%t.env.cc lli %t.bin
+; RUN: ../bin/fast-cc-read -nonzero -sort %t.env.cc | FileCheck --check-prefix=COUNTS %s
+; RUN: opt -load %shlibdir/libDynamicCallCounter%shlibext -legacy-dynamic-cc -fast-counter-file=fast_cc.bin -verify -S %s | FileCheck --check-prefix=IR %s
+
+; Verify that with a counter file, the instrumented program prints nothing
+; at exit and the counts are in the file, which FAST_CC_FILE can move.
+
+; EXIT-NOT: {{.}}
+
+; COUNTS: NAME                 #N DIRECT CALLS
+; COUNTS: foo                  13
+; COUNTS-NEXT: bar                  2
+; COUNTS-NEXT: fez                  1
+; COUNTS-NEXT: main                 1
+
+; The counters are reached through __fast_cc_region, which the constructor
+; points into the mapped file
+; IR: @__fast_cc_region = internal global i64* bitcast ([1 x [2 x i64]]* @__fast_cc_counters to i64*)
+; IR: @llvm.global_ctors = appending global [1 x { i32, void ()*, i8* }] [{ i32, void ()*, i8* } { i32 0, void ()* @__fast_cc_export, i8* null }]
+; IR-NOT: @llvm.global_dtors
+; IR-NOT: printf_wrapper
+
+; IR-LABEL: @foo(
+; IR-NEXT: [[BASE:%.*]] = load i64*, i64** @__fast_cc_region
+; IR-NEXT: [[PTR:%.*]] = getelementptr inbounds i64, i64* [[BASE]], i64 0
+; IR-NEXT: [[OLD:%.*]] = load i64, i64* [[PTR]]
+; IR-NEXT: [[NEW:%.*]] = add i64 1, [[OLD]]
+; IR-NEXT: store i64 [[NEW]], i64* [[PTR]]
+
+; IR-LABEL: @bar(
+; IR-NEXT: [[BASE:%.*]] = load i64*, i64** @__fast_cc_region
+; IR-NEXT: getelementptr inbounds i64, i64* [[BASE]], i64 1
+
+; IR-LABEL: define internal void @__fast_cc_export()
+; IR: call i8* @getenv(
+; IR: call i32 (i8*, i32, ...) @open(
+; IR: call i32 @ftruncate(
+; IR: call i8* @mmap(i8* null, i64 {{[0-9]+}}, i32 3, i32 1,
+; IR: store i64* {{.*}}, i64** @__fast_cc_region
+; IR: call void @perror(
+
+define void @foo() {
+  ret void
+}
+
+define void @bar() {
+  call void @foo()
+  ret void
+}
@@ -0,0 +1,8 @@
+define void @foo() {
+  ret void
+}
+
+define void @bar() {
+  call void @foo()
+  ret void
+}
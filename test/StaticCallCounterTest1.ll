@@ -1,7 +1,14 @@
 ; RUN:  opt -load %shlibdir/libStaticCallCounter%shlibext --legacy-static-cc -analyze %S/Inputs/CallCounterInput.ll \
 ; RUN:   | FileCheck %s
 
-; Test StaticCallCounter when run through opt.
-; CHECK: bar                  2
-; CHECK: fez                  1
-; CHECK: foo                  3
+; Test StaticCallCounter when run through opt: every mutation point is
+; listed in module order with its category and opcode. The calls take no
+; arguments and are not mutation points.
+; CHECK: (3, 0, 2) # 20 store
+; CHECK-NEXT: (3, 0, 6) # 20 store
+; CHECK-NEXT: (3, 0, 7) # 20 store
+; CHECK-NEXT: (3, 1, 1) # 14 icmp slt
+; CHECK-NEXT: (3, 1, 2) # 23 br
+; CHECK-NEXT: (3, 2, 1) # 24 br
+; CHECK-NEXT: (3, 3, 1) # 3 add
+; CHECK-NEXT: (3, 4, 0) # 20 ret
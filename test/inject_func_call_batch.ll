@@ -0,0 +1,25 @@
+; RUN: rm -rf %t && mkdir -p %t
+; RUN: echo "(0, 0, 0) 0" > %t/batch.txt
+; RUN: echo "(0, 0, 0) 3" >> %t/batch.txt
+; RUN: opt -load %shlibdir/libInjectFuncCall%shlibext -legacy-inject-func-call -fast-batch-list=%t/batch.txt -fast-batch-dir=%t -disable-output %s
+; RUN: llvm-dis %t/mutant-0.bc -o - | FileCheck --check-prefix=MUTANT0 %s
+; RUN: llvm-dis %t/mutant-1.bc -o - | FileCheck --check-prefix=MUTANT1 %s
+; RUN: FileCheck --check-prefix=LOG %s < %t/mutants.txt
+
+; Verify that batch mode writes one mutant per entry of the batch list and
+; that every mutant is derived from the unmodified input module.
+
+; MUTANT0-LABEL: @foo
+; MUTANT0-NEXT:  %1 = icmp sle i32 %a, %b
+
+; MUTANT1-LABEL: @foo
+; MUTANT1-NEXT:  %1 = icmp eq i32 %a, %b
+
+; LOG: mutant-0.bc (0, 0, 0) 0
+; LOG-NEXT: mutant-1.bc (0, 0, 0) 3
+
+define i32 @foo(i32 %a, i32 %b) {
+  %1 = icmp slt i32 %a, %b
+  %2 = zext i1 %1 to i32
+  ret i32 %2
+}
@@ -0,0 +1,56 @@
+; RUN: rm -rf %t && mkdir -p %t
+; RUN: echo "(0, 0, 0) 5" > %t/batch.txt
+; RUN: echo "(0, 0, 0) 9" >> %t/batch.txt
+; RUN: echo "(0, 0, 2) 0" >> %t/batch.txt
+; RUN: echo "(0, 0, 3) 6" >> %t/batch.txt
+; RUN: opt -load %shlibdir/libInjectFuncCall%shlibext -legacy-inject-func-call -fast-batch-list=%t/batch.txt -fast-batch-dir=%t -disable-output %s
+; RUN: llvm-dis %t/mutant-0.bc -o - | FileCheck --check-prefix=MUTANT0 %s
+; RUN: llvm-dis %t/mutant-1.bc -o - | FileCheck --check-prefix=MUTANT1 %s
+; RUN: llvm-dis %t/mutant-2.bc -o - | FileCheck --check-prefix=MUTANT2 %s
+; RUN: llvm-dis %t/mutant-3.bc -o - | FileCheck --check-prefix=MUTANT3 %s
+; RUN: opt -load %shlibdir/libInjectFuncCall%shlibext -legacy-inject-func-call -fast-enumerate=%t/points.txt -disable-output %s
+; RUN: FileCheck --check-prefix=POINTS %s < %t/points.txt
+; RUN: opt -load %shlibdir/libInjectFuncCall%shlibext -legacy-inject-func-call -fast-schemata -fast-schemata-manifest=%t/manifest.txt -verify -S %s | FileCheck --check-prefix=SCHEMATA %s
+; RUN: FileCheck --check-prefix=MANIFEST %s < %t/manifest.txt
+
+; Verify that the constant operators (categories 20 - 22) replace integer
+; constants in value operands, after the operator replacements of the same
+; instruction, and that GEP indices and alignments are never mutation points.
+
+; `add %a, 7` has 4 operator mutants, so operator 5 is the second constant
+; mutant (1) and operator 9 is value + 1
+; MUTANT0-LABEL: @foo
+; MUTANT0-NEXT:  %1 = add i32 %a, 1
+
+; MUTANT1-LABEL: @foo
+; MUTANT1-NEXT:  %1 = add i32 %a, 8
+
+; MUTANT2:       store i32 0, i32* %2, align 4
+
+; `ret i32 100` has no operator mutants: 0, 1, -1, MIN, MAX, 101, 99
+; MUTANT3:       ret i32 99
+
+; POINTS:      (0, 0, 0) add
+; POINTS-NEXT: (0, 0, 2) store
+; POINTS-NEXT: (0, 0, 3) ret
+; POINTS-NOT:  getelementptr
+
+; In schemata mode the constant of the `ret` terminator is selected in front
+; of it
+; SCHEMATA:      [[IS21:%[0-9]+]] = icmp eq i32 {{%[0-9]+}}, 21
+; SCHEMATA-NEXT: select i1 [[IS21]], i32 0, i32 100
+; SCHEMATA:      [[IS27:%[0-9]+]] = icmp eq i32 {{%[0-9]+}}, 27
+; SCHEMATA-NEXT: select i1 [[IS27]], i32 99, i32 {{%[0-9]+}}
+; SCHEMATA:      [[RET:%[0-9]+]] = select i1 {{%[0-9]+}}, i32 {{-?[0-9]+}}, i32 {{%[0-9]+}}
+; SCHEMATA-NEXT: ret i32 [[RET]]
+
+; MANIFEST:      21 (0, 0, 3) ret operand 0 100 -> 0
+; MANIFEST:      27 (0, 0, 3) ret operand 0 100 -> 99
+; MANIFEST-NEXT: 28 (0, 0, 3) ret operand 0 100 -> {{-?[0-9]+}}
+
+define i32 @foo(i32 %a, [4 x i32]* %p) {
+  %1 = add i32 %a, 7
+  %2 = getelementptr inbounds [4 x i32], [4 x i32]* %p, i64 0, i64 2
+  store i32 42, i32* %2, align 4
+  ret i32 100
+}
@@ -0,0 +1,54 @@
+; RUN: rm -rf %t && mkdir -p %t/func %t/block
+; RUN: echo "(0, 0, 0)" > %t/points.txt
+; RUN: echo "(1, 0, 0)" >> %t/points.txt
+; RUN: echo "(1, 1, 0)" >> %t/points.txt
+; RUN: echo "=================================================" > %t/func.prof
+; RUN: echo "NAME                 #N DIRECT CALLS" >> %t/func.prof
+; RUN: echo "foo                  3" >> %t/func.prof
+; RUN: echo "bar 0 5" > %t/block.prof
+; RUN: echo "bar 1 0" >> %t/block.prof
+; RUN: opt -load %shlibdir/libInjectFuncCall%shlibext -legacy-inject-func-call -fast-points=%t/points.txt -fast-coverage=%t/func.prof -fast-batch-count=6 -fast-seed=7 -fast-batch-dir=%t/func -disable-output %s
+; RUN: FileCheck --check-prefix=FUNC %s < %t/func/mutants.txt
+; RUN: opt -load %shlibdir/libInjectFuncCall%shlibext -legacy-inject-func-call -fast-points=%t/points.txt -fast-coverage=%t/block.prof -fast-batch-count=6 -fast-seed=7 -fast-batch-dir=%t/block -disable-output %s
+; RUN: FileCheck --check-prefix=BLOCK %s < %t/block/mutants.txt
+; RUN: echo "baz 1" > %t/none.prof
+; RUN: not opt -load %shlibdir/libInjectFuncCall%shlibext -legacy-inject-func-call -fast-points=%t/points.txt -fast-coverage=%t/none.prof -fast-batch-count=6 -disable-output %s 2>&1 | FileCheck --check-prefix=NONE %s
+
+; Verify that with a coverage profile only points in executed blocks are
+; picked, for both per-function profiles (the output of DynamicCallCounter)
+; and per-block ones, and that a profile that covers no point is an error.
+
+; FUNC-NOT: (1,
+; FUNC: mutant-0.bc (0, 0, 0)
+; FUNC-NOT: (1,
+; FUNC: mutant-5.bc (0, 0, 0)
+; FUNC-NOT: (1,
+
+; BLOCK-NOT: (0,
+; BLOCK-NOT: (1, 1,
+; BLOCK: mutant-0.bc (1, 0, 0)
+; BLOCK-NOT: (0,
+; BLOCK-NOT: (1, 1,
+; BLOCK: mutant-5.bc (1, 0, 0)
+
+; NONE: No covered mutation point
+
+define i32 @foo(i32 %a, i32 %b) {
+  %1 = add i32 %a, %b
+  ret i32 %1
+}
+
+define i32 @bar(i32 %a, i32 %b) {
+entry:
+  %0 = sub i32 %a, %b
+  %c = icmp eq i32 %0, 0
+  br i1 %c, label %zero, label %done
+
+zero:
+  %1 = mul i32 %a, %b
+  br label %done
+
+done:
+  %r = phi i32 [ %0, %entry ], [ %1, %zero ]
+  ret i32 %r
+}
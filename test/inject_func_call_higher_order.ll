@@ -0,0 +1,41 @@
+; RUN: rm -rf %t && mkdir -p %t
+; RUN: echo "(0, 0, 0) 0" > %t/batch.txt
+; RUN: echo "(0, 0, 2) 0" >> %t/batch.txt
+; RUN: echo "(0, 0, 0) 3" >> %t/batch.txt
+; RUN: opt -load %shlibdir/libInjectFuncCall%shlibext -legacy-inject-func-call -fast-batch-list=%t/batch.txt -fast-batch-dir=%t -fast-order=2 -fast-seed=42 -disable-output %s
+; RUN: llvm-dis %t/mutant-0.bc -o - | FileCheck --check-prefix=MUTANT0 %s
+; RUN: llvm-dis %t/mutant-1.bc -o - | FileCheck --check-prefix=MUTANT1 %s
+; RUN: FileCheck --check-prefix=LOG %s < %t/mutants.txt
+; RUN: echo "(0, 0, 2) 0" > %t/twice.txt
+; RUN: echo "(0, 0, 2) 1" >> %t/twice.txt
+; RUN: opt -load %shlibdir/libInjectFuncCall%shlibext -legacy-inject-func-call -fast-batch-list=%t/twice.txt -fast-batch-dir=%t/twice -fast-order=2 -disable-output %s | FileCheck --check-prefix=TWICE %s
+; RUN: not ls %t/twice/mutant-0.bc
+
+; Verify that with -fast-order=2 every two consecutive entries of the batch
+; list form one mutant, that both mutations are applied in the same module
+; and that all of them are recorded. A mutant that mutates an instruction
+; twice is dropped rather than applied as a lower-order mutant.
+
+; MUTANT0-LABEL: @foo
+; MUTANT0-NEXT:  %1 = icmp sle i32 %a, %b
+; MUTANT0-NEXT:  %2 = zext i1 %1 to i32
+; MUTANT0-NEXT:  %3 = sub i32 %2, %b
+; MUTANT0: !{i64 42, i64 0, !"(0, 0, 0) 0", !"(0, 0, 2) 0"}
+
+; MUTANT1-LABEL: @foo
+; MUTANT1-NEXT:  %1 = icmp eq i32 %a, %b
+; MUTANT1-NEXT:  %2 = zext i1 %1 to i32
+; MUTANT1-NEXT:  %3 = add i32 %2, %b
+
+; LOG: mutant-0.bc (0, 0, 0) 0 (0, 0, 2) 0
+; LOG-NEXT: mutant-1.bc (0, 0, 0) 3
+
+; TWICE: mutant dropped: (0, 0, 2) is mutated twice
+; TWICE: generated 0 mutants
+
+define i32 @foo(i32 %a, i32 %b) {
+  %1 = icmp slt i32 %a, %b
+  %2 = zext i1 %1 to i32
+  %3 = add i32 %2, %b
+  ret i32 %3
+}
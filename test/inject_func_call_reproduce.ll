@@ -0,0 +1,40 @@
+; RUN: rm -rf %t && mkdir -p %t
+; RUN: echo "(0, 0, 0)" > %t/points.txt
+; RUN: echo "(0, 0, 2)" >> %t/points.txt
+; RUN: echo "(0, 0, 3)" >> %t/points.txt
+; RUN: opt -load %shlibdir/libInjectFuncCall%shlibext -legacy-inject-func-call -fast-points=%t/points.txt -fast-batch-count=4 -fast-seed=5 -fast-batch-dir=%t/batch -disable-output %s
+; RUN: opt -load %shlibdir/libInjectFuncCall%shlibext -legacy-inject-func-call -fast-points=%t/points.txt -fast-seed=5 -fast-mutant-index=0 %s -o %t/mutant-0.bc
+; RUN: opt -load %shlibdir/libInjectFuncCall%shlibext -legacy-inject-func-call -fast-points=%t/points.txt -fast-seed=5 -fast-mutant-index=1 %s -o %t/mutant-1.bc
+; RUN: opt -load %shlibdir/libInjectFuncCall%shlibext -legacy-inject-func-call -fast-points=%t/points.txt -fast-seed=5 -fast-mutant-index=2 %s -o %t/mutant-2.bc
+; RUN: opt -load %shlibdir/libInjectFuncCall%shlibext -legacy-inject-func-call -fast-points=%t/points.txt -fast-seed=5 -fast-mutant-index=3 %s -o %t/mutant-3.bc
+; RUN: cmp %t/batch/mutant-0.bc %t/mutant-0.bc
+; RUN: cmp %t/batch/mutant-1.bc %t/mutant-1.bc
+; RUN: cmp %t/batch/mutant-2.bc %t/mutant-2.bc
+; RUN: cmp %t/batch/mutant-3.bc %t/mutant-3.bc
+; RUN: opt -load %shlibdir/libInjectFuncCall%shlibext -legacy-inject-func-call -fast-points=%t/points.txt -fast-batch-count=4 -fast-order=2 -fast-seed=5 -fast-batch-dir=%t/batch2 -disable-output %s
+; RUN: opt -load %shlibdir/libInjectFuncCall%shlibext -legacy-inject-func-call -fast-points=%t/points.txt -fast-order=2 -fast-seed=5 -fast-mutant-index=0 %s -o %t/order2-0.bc
+; RUN: opt -load %shlibdir/libInjectFuncCall%shlibext -legacy-inject-func-call -fast-points=%t/points.txt -fast-order=2 -fast-seed=5 -fast-mutant-index=1 %s -o %t/order2-1.bc
+; RUN: opt -load %shlibdir/libInjectFuncCall%shlibext -legacy-inject-func-call -fast-points=%t/points.txt -fast-order=2 -fast-seed=5 -fast-mutant-index=2 %s -o %t/order2-2.bc
+; RUN: opt -load %shlibdir/libInjectFuncCall%shlibext -legacy-inject-func-call -fast-points=%t/points.txt -fast-order=2 -fast-seed=5 -fast-mutant-index=3 %s -o %t/order2-3.bc
+; RUN: cmp %t/batch2/mutant-0.bc %t/order2-0.bc
+; RUN: cmp %t/batch2/mutant-1.bc %t/order2-1.bc
+; RUN: cmp %t/batch2/mutant-2.bc %t/order2-2.bc
+; RUN: cmp %t/batch2/mutant-3.bc %t/order2-3.bc
+; RUN: FileCheck --check-prefix=ORDER2 %s < %t/batch2/mutants.txt
+
+; Verify that mutant K of a batch is regenerated exactly, point and operator,
+; by a single run with -fast-mutant-index=K and the same seed, also for
+; higher-order mutants.
+
+; ORDER2: mutant-0.bc {{\([0-9, ]+\) [0-9]+ \([0-9, ]+\) [0-9]+$}}
+; ORDER2-NEXT: mutant-1.bc {{\([0-9, ]+\) [0-9]+ \([0-9, ]+\) [0-9]+$}}
+; ORDER2-NEXT: mutant-2.bc {{\([0-9, ]+\) [0-9]+ \([0-9, ]+\) [0-9]+$}}
+; ORDER2-NEXT: mutant-3.bc {{\([0-9, ]+\) [0-9]+ \([0-9, ]+\) [0-9]+$}}
+
+define i32 @foo(i32 %a, i32 %b) {
+  %1 = icmp slt i32 %a, %b
+  %2 = zext i1 %1 to i32
+  %3 = add i32 %2, %b
+  %4 = mul i32 %3, %a
+  ret i32 %4
+}
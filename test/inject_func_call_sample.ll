@@ -0,0 +1,27 @@
+; RUN: rm -rf %t && mkdir -p %t
+; RUN: opt -load %shlibdir/libInjectFuncCall%shlibext -legacy-inject-func-call -fast-sample -fast-seed=42 -fast-mutant-index=3 %s -S -o %t/a.ll | FileCheck --check-prefix=LOG %s
+; RUN: opt -load %shlibdir/libInjectFuncCall%shlibext -legacy-inject-func-call -fast-sample -fast-seed=42 -fast-mutant-index=3 %s -S -o %t/b.ll
+; RUN: diff %t/a.ll %t/b.ll
+; RUN: FileCheck %s < %t/a.ll
+; RUN: opt -load %shlibdir/libInjectFuncCall%shlibext -legacy-inject-func-call -fast-sample -fast-seed=42 %S/Inputs/NoMutationPointInput.ll -S -o %t/none.ll | FileCheck --check-prefix=NONE %s
+; RUN: FileCheck --check-prefix=UNCHANGED %s < %t/none.ll
+
+; Verify that sample mode picks a mutation point while walking the module,
+; without a point file, that the mutant is fully determined by (seed, mutant
+; index) and that a module without mutation points is left unchanged.
+
+; LOG: the mutation point selected is {{\(0, 0, [02]\)}} (out of 2)
+
+; CHECK: !fast.mutant = !{![[MD:[0-9]+]]}
+; CHECK: ![[MD]] = !{i64 42, i64 3, !"{{\(0, 0, [02]\) [0-9]+}}"}
+
+; NONE: no mutation point in the module
+
+; UNCHANGED-NOT: !fast.mutant
+
+define i32 @foo(i32 %a, i32 %b) {
+  %1 = icmp slt i32 %a, %b
+  %2 = zext i1 %1 to i32
+  %3 = add i32 %2, %b
+  ret i32 %3
+}
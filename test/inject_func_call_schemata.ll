@@ -0,0 +1,67 @@
+; RUN: rm -rf %t && mkdir -p %t
+; RUN: opt -load %shlibdir/libInjectFuncCall%shlibext -legacy-inject-func-call -verify -fast-schemata -fast-schemata-manifest=%t/manifest.txt -S %s | FileCheck %s
+; RUN: FileCheck --check-prefix=MANIFEST %s < %t/manifest.txt
+
+; Verify that schemata mode rewrites every mutation point into a
+; runtime-selected chain of its mutants (branches select their condition),
+; that inactive divisions cannot trap and that the manifest maps mutant IDs
+; to the original (funcID, bbID, insID) numbering.
+
+; CHECK: @__fast_mutant_id = weak global i32 0
+; CHECK: @llvm.global_ctors = appending global {{.*}} @__fast_mutant_init
+
+; CHECK-LABEL: @foo
+; CHECK-NEXT:  %1 = icmp eq i32 %a, %b
+; CHECK-NEXT:  [[ID:%[0-9]+]] = load i32, i32* @__fast_mutant_id
+; CHECK-NEXT:  [[IS1:%[0-9]+]] = icmp eq i32 [[ID]], 1
+; CHECK-NEXT:  [[M1:%[0-9]+]] = icmp ne i32 %a, %b
+; CHECK-NEXT:  [[S1:%[0-9]+]] = select i1 [[IS1]], i1 [[M1]], i1 %1
+; CHECK-NEXT:  zext i1 [[S1]] to i32
+
+; CHECK-LABEL: @bar
+; CHECK:       [[ISDIV:%[0-9]+]] = icmp eq i32 {{%[0-9]+}}, 4
+; CHECK-NEXT:  [[DIVISOR:%[0-9]+]] = select i1 [[ISDIV]], i32 %b, i32 1
+; CHECK-NEXT:  sdiv i32 %a, [[DIVISOR]]
+; CHECK:       [[SREM:%[0-9]+]] = srem i32 %a, {{%[0-9]+}}
+; CHECK-NEXT:  [[ADD:%[0-9]+]] = select i1 {{%[0-9]+}}, i32 [[SREM]], i32 {{%[0-9]+}}
+; CHECK-NEXT:  [[CMP:%[0-9]+]] = icmp slt i32 [[ADD]], %b
+; CHECK:       select i1 {{%[0-9]+}}, i1 {{%[0-9]+}}, i1 [[CMP]]
+; CHECK:       select i1 {{%[0-9]+}}, i1 {{%[0-9]+}}, i1 {{%[0-9]+}}
+; CHECK:       select i1 {{%[0-9]+}}, i1 {{%[0-9]+}}, i1 {{%[0-9]+}}
+; CHECK:       select i1 {{%[0-9]+}}, i1 {{%[0-9]+}}, i1 {{%[0-9]+}}
+; CHECK:       [[LAST:%[0-9]+]] = select i1 {{%[0-9]+}}, i1 {{%[0-9]+}}, i1 {{%[0-9]+}}
+; CHECK-NEXT:  [[BRID:%[0-9]+]] = load i32, i32* @__fast_mutant_id
+; CHECK-NEXT:  [[ISBR:%[0-9]+]] = icmp eq i32 [[BRID]], 11
+; CHECK-NEXT:  [[COND:%[0-9]+]] = xor i1 [[LAST]], [[ISBR]]
+; CHECK-NEXT:  br i1 [[COND]]
+
+; CHECK-LABEL: @__fast_mutant_init
+; CHECK:       call i8* @getenv
+
+; MANIFEST:      1 (0, 0, 0) icmp eq -> ne
+; MANIFEST-NEXT: 2 (1, 0, 0) add -> sub
+; MANIFEST-NEXT: 3 (1, 0, 0) add -> mul
+; MANIFEST-NEXT: 4 (1, 0, 0) add -> sdiv
+; MANIFEST-NEXT: 5 (1, 0, 0) add -> srem
+; MANIFEST-NEXT: 6 (1, 0, 1) icmp slt -> sle
+; MANIFEST-NEXT: 7 (1, 0, 1) icmp slt -> sge
+; MANIFEST-NEXT: 8 (1, 0, 1) icmp slt -> sgt
+; MANIFEST-NEXT: 9 (1, 0, 1) icmp slt -> eq
+; MANIFEST-NEXT: 10 (1, 0, 1) icmp slt -> ne
+; MANIFEST-NEXT: 11 (1, 0, 2) br swap successors
+
+define i32 @foo(i32 %a, i32 %b) {
+  %1 = icmp eq i32 %a, %b
+  %2 = zext i1 %1 to i32
+  ret i32 %2
+}
+
+define i32 @bar(i32 %a, i32 %b) {
+  %1 = add i32 %a, %b
+  %2 = icmp slt i32 %1, %b
+  br i1 %2, label %3, label %4
+
+  ret i32 %1
+
+  ret i32 %b
+}
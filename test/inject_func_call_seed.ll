@@ -0,0 +1,20 @@
+; RUN: rm -rf %t && mkdir -p %t
+; RUN: echo "(0, 0, 0)" > %t/points.txt
+; RUN: echo "(0, 0, 2)" >> %t/points.txt
+; RUN: opt -load %shlibdir/libInjectFuncCall%shlibext -legacy-inject-func-call -fast-points=%t/points.txt -fast-seed=42 -fast-mutant-index=7 %s -S -o %t/a.ll
+; RUN: opt -load %shlibdir/libInjectFuncCall%shlibext -legacy-inject-func-call -fast-points=%t/points.txt -fast-seed=42 -fast-mutant-index=7 %s -S -o %t/b.ll
+; RUN: diff %t/a.ll %t/b.ll
+; RUN: FileCheck %s < %t/a.ll
+
+; Verify that a mutant is fully determined by (seed, mutant index) and that
+; both are recorded in the mutated module, next to the applied mutation.
+
+; CHECK: !fast.mutant = !{![[MD:[0-9]+]]}
+; CHECK: ![[MD]] = !{i64 42, i64 7, !"{{\(0, 0, [02]\) [0-9]+}}"}
+
+define i32 @foo(i32 %a, i32 %b) {
+  %1 = icmp slt i32 %a, %b
+  %2 = zext i1 %1 to i32
+  %3 = add i32 %2, %b
+  ret i32 %3
+}
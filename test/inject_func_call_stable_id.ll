@@ -0,0 +1,33 @@
+; RUN: rm -rf %t && mkdir -p %t
+; RUN: opt -load %shlibdir/libInjectFuncCall%shlibext -legacy-inject-func-call -fast-enumerate=%t/points.txt %s -o %t/annotated.bc
+; RUN: FileCheck --check-prefix=POINTS %s < %t/points.txt
+; RUN: echo "mp:1 2" > %t/batch.txt
+; RUN: opt -load %shlibdir/libInjectFuncCall%shlibext -legacy-inject-func-call -fast-batch-list=%t/batch.txt -fast-batch-dir=%t -disable-output %t/annotated.bc
+; RUN: llvm-dis %t/mutant-0.bc -o - | FileCheck --check-prefix=MUTANT %s
+
+; Verify that the enumerator attaches stable IDs to the mutation points and
+; that the mutator resolves points by those IDs.
+
+; POINTS:      mp:0 # (0, 0, 0) icmp
+; POINTS-NEXT: mp:1 # (1, 0, 0) add
+; POINTS-NEXT: mp:2 # (1, 0, 1) icmp
+
+; MUTANT-LABEL: @bar
+; MUTANT-NEXT:  %1 = sdiv i32 %a, %b, !fast.mp [[MP1:![0-9]+]]
+; MUTANT: [[MP1]] = !{i64 1}
+
+define i32 @foo(i32 %a, i32 %b) {
+  %1 = icmp eq i32 %a, %b
+  %2 = zext i1 %1 to i32
+  ret i32 %2
+}
+
+define i32 @bar(i32 %a, i32 %b) {
+  %1 = add i32 %a, %b
+  %2 = icmp slt i32 %1, %b
+  br i1 %2, label %3, label %4
+
+  ret i32 %1
+
+  ret i32 %b
+}
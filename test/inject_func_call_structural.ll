@@ -0,0 +1,85 @@
+; RUN: rm -rf %t && mkdir -p %t
+; RUN: echo "(0, 1, 2) 0" > %t/batch.txt
+; RUN: echo "(0, 3, 0) 0" >> %t/batch.txt
+; RUN: echo "(0, 5, 0) 0" >> %t/batch.txt
+; RUN: echo "(0, 7, 2) 0" >> %t/batch.txt
+; RUN: opt -load %shlibdir/libInjectFuncCall%shlibext -legacy-inject-func-call -fast-batch-list=%t/batch.txt -fast-batch-dir=%t -disable-output %s
+; RUN: llvm-dis %t/mutant-0.bc -o - | FileCheck --check-prefix=MUTANT0 %s
+; RUN: llvm-dis %t/mutant-1.bc -o - | FileCheck --check-prefix=MUTANT1 %s
+; RUN: llvm-dis %t/mutant-2.bc -o - | FileCheck --check-prefix=MUTANT2 %s
+; RUN: llvm-dis %t/mutant-3.bc -o - | FileCheck --check-prefix=MUTANT3 %s
+; RUN: opt -load %shlibdir/libInjectFuncCall%shlibext -legacy-inject-func-call -fast-enumerate=%t/points.txt -disable-output %s
+; RUN: FileCheck --check-prefix=POINTS %s < %t/points.txt
+; RUN: echo "(0, 3, 0) 0" > %t/retargets.txt
+; RUN: echo "(0, 5, 0) 0" >> %t/retargets.txt
+; RUN: opt -load %shlibdir/libInjectFuncCall%shlibext -legacy-inject-func-call -fast-batch-list=%t/retargets.txt -fast-batch-dir=%t/retargets -fast-order=2 -disable-output %s | FileCheck --check-prefix=RETARGETS %s
+; RUN: opt -load %shlibdir/libInjectFuncCall%shlibext -legacy-inject-func-call -fast-schemata -fast-schemata-manifest=%t/manifest.txt -verify -S %s | FileCheck --check-prefix=SCHEMATA %s
+
+; Verify the structural operators (categories 23 - 26): swapped branches,
+; break <-> continue and swapped select operands, applied in place. The
+; branch that closes the loop is neither a break nor a continue. A
+; higher-order mutant cannot retarget two branches of one function, each
+; retarget is only valid on the loops of the unmutated function.
+
+; MUTANT0-LABEL: cond:
+; MUTANT0:       br i1 %1, label %end, label %body
+
+; MUTANT1-LABEL: brk:
+; MUTANT1-NEXT:  br label %inc
+
+; MUTANT2-LABEL: cont:
+; MUTANT2-NEXT:  br label %end
+
+; MUTANT3:       select i1 %9, i32 %n, i32 %8
+
+; POINTS:     (0, 3, 0) br
+; POINTS:     (0, 5, 0) br
+; POINTS-NOT: (0, 6, 3) br
+; POINTS:     (0, 7, 2) select
+
+; RETARGETS: mutant dropped: (0, 5, 0) changes the CFG of a function that another mutation already changes
+
+; SCHEMATA-LABEL: brk:
+; SCHEMATA:       br i1 {{%[0-9]+}}, label %inc, label %end
+; SCHEMATA-LABEL: cont:
+; SCHEMATA:       br i1 {{%[0-9]+}}, label %end, label %inc
+
+define i32 @foo(i32 %n) {
+entry:
+  %i = alloca i32
+  store i32 0, i32* %i
+  br label %cond
+
+cond:
+  %0 = load i32, i32* %i
+  %1 = icmp slt i32 %0, %n
+  br i1 %1, label %body, label %end
+
+body:
+  %2 = load i32, i32* %i
+  %3 = icmp eq i32 %2, 5
+  br i1 %3, label %brk, label %next
+
+brk:
+  br label %end
+
+next:
+  %4 = load i32, i32* %i
+  %5 = icmp eq i32 %4, 2
+  br i1 %5, label %cont, label %inc
+
+cont:
+  br label %inc
+
+inc:
+  %6 = load i32, i32* %i
+  %7 = add i32 %6, 1
+  store i32 %7, i32* %i
+  br label %cond
+
+end:
+  %8 = load i32, i32* %i
+  %9 = icmp sgt i32 %8, 3
+  %10 = select i1 %9, i32 %8, i32 %n
+  ret i32 %10
+}
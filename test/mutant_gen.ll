@@ -0,0 +1,41 @@
+; RUN: rm -rf %t && mkdir -p %t/j1 %t/j4
+; RUN: echo "(0, 0, 0)" > %t/points.txt
+; RUN: echo "(0, 0, 2)" >> %t/points.txt
+; RUN: ../bin/fast-mutgen %s -points=%t/points.txt -n=8 -seed=7 -j=1 -o=%t/j1
+; RUN: ../bin/fast-mutgen %s -points=%t/points.txt -n=8 -seed=7 -j=4 -o=%t/j4
+; RUN: diff %t/j1/mutants.txt %t/j4/mutants.txt
+; RUN: cmp %t/j1/mutant-5.bc %t/j4/mutant-5.bc
+; RUN: FileCheck %s < %t/j4/mutants.txt
+; RUN: opt -load %shlibdir/libInjectFuncCall%shlibext -legacy-inject-func-call -fast-points=%t/points.txt -fast-batch-count=8 -fast-seed=7 -fast-batch-dir=%t/opt -disable-output %s
+; RUN: diff %t/j1/mutants.txt %t/opt/mutants.txt
+; RUN: cmp %t/j1/mutant-0.bc %t/opt/mutant-0.bc
+; RUN: cmp %t/j1/mutant-5.bc %t/opt/mutant-5.bc
+; RUN: ../bin/fast-mutgen %s -points=%t/points.txt -n=4 -order=2 -seed=7 -j=2 -o=%t/order2
+; RUN: opt -load %shlibdir/libInjectFuncCall%shlibext -legacy-inject-func-call -fast-points=%t/points.txt -fast-batch-count=4 -fast-order=2 -fast-seed=7 -fast-batch-dir=%t/opt2 -disable-output %s
+; RUN: diff %t/order2/mutants.txt %t/opt2/mutants.txt
+; RUN: cmp %t/order2/mutant-1.bc %t/opt2/mutant-1.bc
+; RUN: FileCheck --check-prefix=ORDER2 %s < %t/order2/mutants.txt
+
+; Verify that fast-mutgen writes every mutant, that the result does not
+; depend on the number of threads and that it matches the batch mode of
+; InjectFuncCall for the same seed, bit for bit and for higher-order mutants
+; too.
+
+; CHECK: # seed 7 first-index 0
+; CHECK-NEXT: mutant-0.bc
+; CHECK-NEXT: mutant-1.bc
+; CHECK-NEXT: mutant-2.bc
+; CHECK-NEXT: mutant-3.bc
+; CHECK-NEXT: mutant-4.bc
+; CHECK-NEXT: mutant-5.bc
+; CHECK-NEXT: mutant-6.bc
+; CHECK-NEXT: mutant-7.bc
+
+; ORDER2: mutant-0.bc (0, {{[0-9]+}}, {{[0-9]+}}) {{[0-9]+}} (0, {{[0-9]+}}, {{[0-9]+}}) {{[0-9]+}}
+
+define i32 @foo(i32 %a, i32 %b) {
+  %1 = icmp slt i32 %a, %b
+  %2 = zext i1 %1 to i32
+  %3 = add i32 %2, %b
+  ret i32 %3
+}
@@ -0,0 +1,43 @@
+; RUN: rm -rf %t && mkdir -p %t
+; RUN: echo "(0, 0, 0) 0" > %t/batch.txt
+; RUN: ../bin/fast-mutobj %s -batch-list=%t/batch.txt -cache-dir=%t/cache -o=%t/out -no-link 2>&1 | FileCheck --check-prefix=FIRST %s
+; RUN: ../bin/fast-mutobj %s -batch-list=%t/batch.txt -cache-dir=%t/cache -o=%t/out -no-link 2>&1 | FileCheck --check-prefix=SECOND %s
+; RUN: ls %t/out/mutant-0.o
+; RUN: FileCheck --check-prefix=LOG %s < %t/out/mutants.txt
+; RUN: echo "(1, 0, 2) 0" >> %t/batch.txt
+; RUN: ../bin/fast-mutobj %s -batch-list=%t/batch.txt -order=2 -cache-dir=%t/cache -o=%t/order2 -no-link 2>&1 | FileCheck --check-prefix=SECOND %s
+; RUN: ls %t/order2/mutant-0.o %t/order2/mutant-0.1.o
+; RUN: FileCheck --check-prefix=ORDER2 %s < %t/order2/mutants.txt
+
+; Verify that fast-mutobj compiles one object per function (plus one for the
+; globals), reuses them from the cache and only compiles the mutated function
+; per mutant. A mutant of two functions gets one object per function.
+
+; FIRST: Compiled 4 of 4 base objects (0 cached)
+; FIRST: Built 1 mutants
+; SECOND: Compiled 0 of 4 base objects (4 cached)
+; SECOND: Built 1 mutants
+
+; LOG: mutant-0 (0, 0, 0) 0
+
+; ORDER2: mutant-0 (0, 0, 0) 0 (1, 0, 2) 0
+
+@counter = internal global i32 0
+
+define internal i32 @foo(i32 %a, i32 %b) {
+  %1 = icmp slt i32 %a, %b
+  %2 = zext i1 %1 to i32
+  ret i32 %2
+}
+
+define i32 @bar(i32 %a) {
+  %1 = call i32 @foo(i32 %a, i32 3)
+  %2 = load i32, i32* @counter
+  %3 = add i32 %1, %2
+  ret i32 %3
+}
+
+define i32 @main() {
+  %1 = call i32 @bar(i32 1)
+  ret i32 %1
+}
@@ -0,0 +1,52 @@
+; RUN: rm -rf %t && mkdir -p %t
+; RUN: echo "(0, 0, 0)" > %t/points.txt
+; RUN: printf "point bc %s (0, 0, 1)\npoint bc %s (0, 0, 0) 1\nquit\n" | ../bin/fast-mutd > %t/session 2> %t/err
+; RUN: head -n 2 %t/session | FileCheck --check-prefix=SESSION %s
+;
+; Every reply below is the only one of its session: the payload is what
+; follows the header line, and it has to be exactly <size> bytes long.
+; RUN: printf "point bc %s (0, 0, 0) 1\nquit\n" | ../bin/fast-mutd > %t/point 2> %t/err
+; RUN: head -n 1 %t/point > %t/point.size
+; RUN: tail -n +2 %t/point > %t/point.bc
+; RUN: wc -c < %t/point.bc >> %t/point.size
+; RUN: FileCheck --check-prefix=POINT %s < %t/point.size
+; RUN: llvm-dis %t/point.bc -o - | FileCheck --check-prefix=POINT-IR %s
+;
+; RUN: printf "mutant bc %s 3\nquit\n" | ../bin/fast-mutd -points=%t/points.txt -seed=1 > %t/mutant 2> %t/err
+; RUN: head -n 1 %t/mutant > %t/mutant.size
+; RUN: tail -n +2 %t/mutant > %t/mutant.bc
+; RUN: wc -c < %t/mutant.bc >> %t/mutant.size
+; RUN: FileCheck --check-prefix=REPLY %s < %t/mutant.size
+; RUN: opt -load %shlibdir/libInjectFuncCall%shlibext -legacy-inject-func-call -fast-points=%t/points.txt -fast-batch-count=4 -fast-seed=1 -fast-batch-dir=%t/batch -disable-output %s
+; RUN: llvm-dis < %t/mutant.bc > %t/mutant.ll
+; RUN: llvm-dis < %t/batch/mutant-3.bc > %t/batch-3.ll
+; RUN: diff %t/mutant.ll %t/batch-3.ll
+; RUN: cmp %t/mutant.bc %t/batch/mutant-3.bc
+; RUN: FileCheck --check-prefix=MUTANT-IR %s < %t/mutant.ll
+
+; Verify that fast-mutd answers point and mutant requests from the resident
+; module, reports points that cannot be mutated, sends exactly <size> bytes
+; of bitcode per reply, and that mutant 3 of a campaign is mutant 3 of the
+; batch mode of InjectFuncCall for the same seed. A point mutant belongs to
+; no campaign, so it has no `!fast.mutant`.
+
+; SESSION: error (0, 0, 1) is not a mutation point
+; SESSION-NEXT: ok {{[0-9]+}} (0, 0, 0) 1
+
+; POINT: ok [[SIZE:[0-9]+]] (0, 0, 0) 1
+; POINT-NEXT: {{^ *}}[[SIZE]]{{$}}
+
+; POINT-IR: define i32 @foo
+; POINT-IR-NOT: !fast.mutant
+
+; REPLY: ok [[SIZE:[0-9]+]] (0, 0, 0) {{[0-4]}}
+; REPLY-NEXT: {{^ *}}[[SIZE]]{{$}}
+
+; MUTANT-IR: !fast.mutant = !{![[MUTANT:[0-9]+]]}
+; MUTANT-IR: ![[MUTANT]] = !{i64 1, i64 3, !"(0, 0, 0) {{[0-4]}}"}
+
+define i32 @foo(i32 %a, i32 %b) {
+  %1 = icmp slt i32 %a, %b
+  %2 = zext i1 %1 to i32
+  ret i32 %2
+}
@@ -0,0 +1,24 @@
+; RUN: rm -rf %t && mkdir -p %t/src
+; RUN: opt %s -o %t/src/a.bc
+; RUN: opt %S/Inputs/CallCounterInput.ll -o %t/src/b.bc
+; RUN: ../bin/static %t/src -o %t/points
+; RUN: ../bin/fast-mutgen -index=%t/points/index.txt -n=20 -seed=7 -o %t/mutants 2>&1 | FileCheck --check-prefix=GEN %s
+; RUN: FileCheck --check-prefix=LOG %s < %t/mutants/mutants.txt
+; RUN: ls %t/mutants | FileCheck --check-prefix=FILES %s
+
+; Verify that fast-mutgen draws the mutants of a campaign from all modules
+; of a program index and records the module of every mutant.
+
+; GEN: Generated 20 mutants
+
+; LOG: # seed 7 first-index 0
+; LOG-DAG: mutant-{{[0-9]+}}.bc {{.*}}a.bc (0, 0, 0)
+; LOG-DAG: mutant-{{[0-9]+}}.bc {{.*}}b.bc (
+
+; FILES: mutant-0.bc
+; FILES: mutant-19.bc
+
+define i32 @f(i32 %a) {
+  %1 = add i32 %a, 1
+  ret i32 %1
+}
@@ -0,0 +1,16 @@
+; RUN: rm -rf %t && mkdir -p %t
+; RUN: echo "(0, 0, 0)" > %t/points.txt
+; RUN: ../bin/fast-mp-convert %t/points.txt -o %t/points.bin -module=%s
+; RUN: opt -load %shlibdir/libInjectFuncCall%shlibext -legacy-inject-func-call -fast-points=%t/points.bin -S %s | FileCheck %s
+
+; Verify that binary point files produced by fast-mp-convert are accepted in
+; place of text point files.
+
+; CHECK-LABEL: @foo
+; CHECK-NEXT:  %1 = icmp ne i32 %a, %b
+
+define i32 @foo(i32 %a, i32 %b) {
+  %1 = icmp eq i32 %a, %b
+  %2 = zext i1 %1 to i32
+  ret i32 %2
+}
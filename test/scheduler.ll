@@ -0,0 +1,47 @@
+; RUN: rm -rf %t && mkdir -p %t
+; RUN: echo "(0, 0, 0)" > %t/points.txt
+; RUN: echo "(0, 0, 2)" >> %t/points.txt
+; RUN: echo "(0, 0, 0) 0 killed 1" > %t/outcomes.txt
+; RUN: echo "(0, 0, 0) 0 killed 2" >> %t/outcomes.txt
+; RUN: echo "(0, 0, 2) 0 survived" >> %t/outcomes.txt
+; RUN: ../bin/fast-sched -state=%t/sched.txt -record=%t/outcomes.txt -print | FileCheck --check-prefix=PRINT %s
+; RUN: FileCheck --check-prefix=STATE %s < %t/sched.txt
+; RUN: opt -load %shlibdir/libInjectFuncCall%shlibext -legacy-inject-func-call -fast-points=%t/points.txt -fast-scheduler=%t/sched.txt -fast-batch-count=2 -fast-seed=3 -fast-batch-dir=%t/out -disable-output %s
+; RUN: FileCheck --check-prefix=BATCH %s < %t/out/mutants.txt
+; RUN: printf "(0, 0, 0) 0 killed 50\n%%.0s" 1 2 3 4 5 6 7 8 > %t/repeated.txt
+; RUN: printf "(0, 0, 2) 0 survived\n%%.0s" 1 2 3 4 5 6 7 8 >> %t/repeated.txt
+; RUN: ../bin/fast-sched -state=%t/repeated-sched.txt -record=%t/repeated.txt -print | FileCheck --check-prefix=REPEATED %s
+; RUN: opt -load %shlibdir/libInjectFuncCall%shlibext -legacy-inject-func-call -fast-points=%t/points.txt -fast-scheduler=%t/repeated-sched.txt -fast-batch-count=1 -fast-seed=3 -fast-batch-dir=%t/repeated -disable-output %s
+; RUN: FileCheck --check-prefix=REPEATED-BATCH %s < %t/repeated/mutants.txt
+
+; Verify that fast-sched folds outcomes into the scheduler state and that
+; InjectFuncCall uses it: (0, 0, 2) survived, so it is preferred over
+; (0, 0, 0), which always died at once, and its operators other than 0 have
+; never been played, so they are tried first.
+;
+; A survivor is worth less every time it survives again: after 8 survivals
+; (0, 0, 2) has a lower mean reward than (0, 0, 0), whose mutants took 50 ms
+; to kill (0.333 each), and loses its priority. With a flat survival reward
+; of 0.5 it would still be preferred.
+
+; PRINT: (0, 0, 2)
+; PRINT-NEXT: (0, 0, 0)
+
+; STATE: # FASTSCHED 1
+; STATE-DAG: (0, 0, 0) 0 2 0 0 0
+; STATE-DAG: (0, 0, 2) 0 0 1 0 0
+
+; BATCH: mutant-0.bc (0, 0, 2) {{[1-3]}}
+; BATCH-NEXT: mutant-1.bc (0, 0, 2) {{[1-3]}}
+
+; REPEATED: (0, 0, 0) 0.333 8 0
+; REPEATED-NEXT: (0, 0, 2) 0.170 0 8
+
+; REPEATED-BATCH: mutant-0.bc (0, 0, 0) {{[0-9]+}}
+
+define i32 @foo(i32 %a, i32 %b) {
+  %1 = icmp slt i32 %a, %b
+  %2 = zext i1 %1 to i32
+  %3 = add i32 %2, %b
+  ret i32 %3
+}
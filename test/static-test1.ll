@@ -1,10 +1,19 @@
-; RUN: ../bin/static %s 2>&1 | FileCheck %s
-
-; Test StaticCallCounter when run via static.
-
-; CHECK: bar                  2
-; CHECK: fez                  1
-; CHECK: foo                  3
+; RUN: ../bin/static %s -o - | FileCheck %s
+; RUN: ../bin/static %s -j=1 -o %t.j1
+; RUN: ../bin/static %s -j=4 -o %t.j4
+; RUN: diff %t.j1 %t.j4
+
+; Test StaticCallCounter when run via static, and that the point file does
+; not depend on the number of threads.
+
+; CHECK: (3, 0, 2) # 20 store
+; CHECK-NEXT: (3, 0, 6) # 20 store
+; CHECK-NEXT: (3, 0, 7) # 20 store
+; CHECK-NEXT: (3, 1, 1) # 14 icmp slt
+; CHECK-NEXT: (3, 1, 2) # 23 br
+; CHECK-NEXT: (3, 2, 1) # 24 br
+; CHECK-NEXT: (3, 3, 1) # 3 add
+; CHECK-NEXT: (3, 4, 0) # 20 ret
 
 define void @foo() {
   ret void
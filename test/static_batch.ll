@@ -0,0 +1,29 @@
+; RUN: rm -rf %t && mkdir -p %t/dir/sub
+; RUN: cp %s %t/dir/a.ll
+; RUN: cp %S/Inputs/CallCounterInput.ll %t/dir/sub/b.ll
+; RUN: echo "this is not IR" > %t/dir/bad.ll
+; RUN: not ../bin/static %t/dir -j=2 -o %t/points -report=%t/report.txt
+; RUN: FileCheck --check-prefix=REPORT %s < %t/report.txt
+; RUN: ../bin/static %t/dir/sub/b.ll -o %t/b.txt
+; RUN: diff %t/points/2.txt %t/b.txt
+; RUN: FileCheck --check-prefix=INDEX %s < %t/points/index.txt
+
+; Verify that the batch mode of static analyses every module of a directory
+; (in sorted order), reports the modules it cannot read and writes the
+; same point files as single-module runs, indexed as one program.
+
+; REPORT: mutation points of 3 modules
+; REPORT: 1 1 {{[0-9]+}} {{.*}}a.ll
+; REPORT-NEXT: error - - {{.*}}bad.ll:
+; REPORT-NEXT: 4 8 {{[0-9]+}} {{.*}}b.ll
+; REPORT: 5 9 {{[0-9]+}} total (1 errors)
+; REPORT: 3 2
+; REPORT: 14 1
+
+; INDEX: 0	1	1	{{/.*}}a.ll	0.txt
+; INDEX-NEXT: 1	8	8	{{/.*}}b.ll	2.txt
+
+define i32 @f(i32 %a) {
+  %1 = add i32 %a, 1
+  ret i32 %1
+}
@@ -0,0 +1,44 @@
+; RUN: rm -f %t.cache
+; RUN: ../bin/static %s -cache=%t.cache -o %t.first 2>&1 | FileCheck --check-prefix=FIRST %s
+; RUN: ../bin/static %s -cache=%t.cache -o %t.second 2>&1 | FileCheck --check-prefix=SECOND %s
+; RUN: diff %t.first %t.second
+; RUN: echo "define void @first() {" > %t.shifted.ll
+; RUN: echo "  ret void" >> %t.shifted.ll
+; RUN: echo "}" >> %t.shifted.ll
+; RUN: cat %s >> %t.shifted.ll
+; RUN: ../bin/static %t.shifted.ll -cache=%t.cache -o %t.shifted 2>&1 | FileCheck --check-prefix=SHIFTED %s
+; RUN: FileCheck --check-prefix=POINTS %s < %t.shifted
+; RUN: printf 'FASTEC\000\000\002\000\000\000\000\000\000\000\001\000\000\000\000\000\000\000\000\000\000\000\000\000\000\000' > %t.cache
+; RUN: ../bin/static %s -cache=%t.cache -o %t.stale 2>&1 | FileCheck --check-prefix=STALE %s
+; RUN: ../bin/static %s -cache=%t.cache -o %t.rebuilt 2>&1 | FileCheck --check-prefix=SECOND %s
+; RUN: ls %t.cache
+; RUN: not ls %t.cache.tmp*
+
+; Verify that the enumeration cache serves unchanged functions, and that
+; cached points get the position of their function in the current module.
+; A cache written with other operator tables is ignored and rebuilt, and is
+; replaced without leaving temporary files behind.
+
+; FIRST: Enumeration cache: 0 hits, 3 misses
+; SECOND: Enumeration cache: 3 hits, 0 misses
+; SHIFTED: Enumeration cache: 3 hits, 1 misses
+; STALE: Ignoring stale enumeration cache
+; STALE: Enumeration cache: 0 hits, 3 misses
+
+; POINTS: (1, 0, 0) # 3 add
+; POINTS-NEXT: (2, 0, 0) # 14 icmp slt
+; POINTS-NEXT: (3, 0, 0) # 20 ret
+
+define i32 @f(i32 %a) {
+  %1 = add i32 %a, 1
+  ret i32 %1
+}
+
+define i1 @g(i32 %a, i32 %b) {
+  %1 = icmp slt i32 %a, %b
+  ret i1 %1
+}
+
+define i32 @h() {
+  ret i32 7
+}
@@ -0,0 +1,30 @@
+; RUN: ../bin/static %s -o - | FileCheck %s
+
+; Verify that the enumerator records the source location of every point and
+; keeps the stable IDs attached by `-fast-enumerate`.
+
+; CHECK: (0, 0, 0) # 3 add f.c:2:12
+; CHECK-NEXT: mp:7 # 16 icmp sge f.c:3:9
+; CHECK-NEXT: (0, 0, 2) # 26 select
+
+define i32 @f(i32 %a, i32 %b) !dbg !6 {
+  %1 = add i32 %a, %b, !dbg !9
+  %2 = icmp sge i32 %1, %b, !dbg !10, !fast.mp !11
+  %3 = select i1 %2, i32 %a, i32 %b
+  ret i32 %3, !dbg !12
+}
+
+!llvm.dbg.cu = !{!0}
+!llvm.module.flags = !{!3, !4}
+
+!0 = distinct !DICompileUnit(language: DW_LANG_C99, file: !1, producer: "clang", isOptimized: false, runtimeVersion: 0, emissionKind: FullDebug, enums: !2)
+!1 = !DIFile(filename: "f.c", directory: "/tmp")
+!2 = !{}
+!3 = !{i32 2, !"Dwarf Version", i32 4}
+!4 = !{i32 2, !"Debug Info Version", i32 3}
+!6 = distinct !DISubprogram(name: "f", scope: !1, file: !1, line: 1, type: !7, scopeLine: 1, spFlags: DISPFlagDefinition, unit: !0, retainedNodes: !2)
+!7 = !DISubroutineType(types: !2)
+!9 = !DILocation(line: 2, column: 12, scope: !6)
+!10 = !DILocation(line: 3, column: 9, scope: !6)
+!11 = !{i64 7}
+!12 = !DILocation(line: 4, column: 3, scope: !6)
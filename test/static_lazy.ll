@@ -0,0 +1,40 @@
+; RUN: opt %s -o %t.bc
+; RUN: ../bin/static %t.bc -j=2 -o %t.lazy
+; RUN: ../bin/static %t.bc -j=2 -lazy=false -o %t.eager
+; RUN: diff %t.lazy %t.eager
+; RUN: FileCheck %s < %t.lazy
+
+; Verify that enumerating a lazily loaded bitcode module gives the same
+; points as a fully parsed one, including the source locations of functions
+; whose bodies have been freed again.
+
+; CHECK: (0, 0, 0) # 3 add f.c:2:12
+; CHECK-NEXT: (2, 0, 0) # 4 sub f.c:6:12
+
+define i32 @f(i32 %a, i32 %b) !dbg !6 {
+  %1 = add i32 %a, %b, !dbg !9
+  ret i32 %1, !dbg !10
+}
+
+declare i32 @h(i32)
+
+define i32 @g(i32 %a, i32 %b) !dbg !11 {
+  %1 = sub i32 %a, %b, !dbg !12
+  ret i32 %1, !dbg !13
+}
+
+!llvm.dbg.cu = !{!0}
+!llvm.module.flags = !{!3, !4}
+
+!0 = distinct !DICompileUnit(language: DW_LANG_C99, file: !1, producer: "clang", isOptimized: false, runtimeVersion: 0, emissionKind: FullDebug, enums: !2)
+!1 = !DIFile(filename: "f.c", directory: "/tmp")
+!2 = !{}
+!3 = !{i32 2, !"Dwarf Version", i32 4}
+!4 = !{i32 2, !"Debug Info Version", i32 3}
+!6 = distinct !DISubprogram(name: "f", scope: !1, file: !1, line: 1, type: !7, scopeLine: 1, spFlags: DISPFlagDefinition, unit: !0, retainedNodes: !2)
+!7 = !DISubroutineType(types: !2)
+!9 = !DILocation(line: 2, column: 12, scope: !6)
+!10 = !DILocation(line: 2, column: 3, scope: !6)
+!11 = distinct !DISubprogram(name: "g", scope: !1, file: !1, line: 5, type: !7, scopeLine: 5, spFlags: DISPFlagDefinition, unit: !0, retainedNodes: !2)
+!12 = !DILocation(line: 6, column: 12, scope: !11)
+!13 = !DILocation(line: 6, column: 3, scope: !11)
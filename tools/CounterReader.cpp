@@ -0,0 +1,159 @@
+//========================================================================
+// FILE:
+//    CounterReader.cpp
+//
+// DESCRIPTION:
+//    A command-line tool that decodes the counter files of
+//    DynamicCallCounter (see CounterFile.h). It prints the calls of every
+//    function the way the instrumented program would have printed them at
+//    exit, so its output can be used as a CoverageProfile. The file can be
+//    read while the program is running; counts of functions that are being
+//    called at that moment may be one call behind.
+//
+// USAGE:
+//      <BUILD/DIR>/bin/fast-cc-read fast_cc.bin
+//      <BUILD/DIR>/bin/fast-cc-read fast_cc.bin -nonzero -sort
+//
+// License: MIT
+//========================================================================
+#include "CounterFile.h"
+
+#include "llvm/ADT/StringRef.h"
+#include "llvm/Support/CommandLine.h"
+#include "llvm/Support/Endian.h"
+#include "llvm/Support/Format.h"
+#include "llvm/Support/ManagedStatic.h"
+#include "llvm/Support/MemoryBuffer.h"
+#include "llvm/Support/raw_ostream.h"
+
+#include <algorithm>
+#include <cstring>
+#include <vector>
+
+using namespace llvm;
+
+//===----------------------------------------------------------------------===//
+// Command line options
+//===----------------------------------------------------------------------===//
+static cl::OptionCategory ReaderCategory{"counter file reader options"};
+
+static cl::opt<std::string> InputFile{cl::Positional,
+                                      cl::desc{"<counter file>"},
+                                      cl::value_desc{"filename"},
+                                      cl::Required, cl::cat{ReaderCategory}};
+
+static cl::opt<bool> NonZero{"nonzero",
+                             cl::desc{"Only print functions that were called"},
+                             cl::init(false), cl::cat{ReaderCategory}};
+
+static cl::opt<bool> SortByCount{
+    "sort", cl::desc{"Print the most called functions first"},
+    cl::init(false), cl::cat{ReaderCategory}};
+
+//===----------------------------------------------------------------------===//
+// Main driver code.
+//===----------------------------------------------------------------------===//
+int main(int Argc, char **Argv) {
+  cl::HideUnrelatedOptions(ReaderCategory);
+  cl::ParseCommandLineOptions(Argc, Argv,
+                              "Prints the call counts of a counter file "
+                              "written by DynamicCallCounter\n");
+  llvm_shutdown_obj SDO;
+
+  // Volatile: the file may still be mapped by a running program, so it is
+  // read rather than mapped
+  auto BufferOrErr =
+      MemoryBuffer::getFile(InputFile, /*FileSize=*/-1,
+                            /*RequiresNullTerminator=*/false,
+                            /*IsVolatile=*/true);
+  if (!BufferOrErr) {
+    errs() << "Failed to open counter file " << InputFile << ": "
+           << BufferOrErr.getError().message() << "\n";
+    return -1;
+  }
+  StringRef Data = (*BufferOrErr)->getBuffer();
+
+  if (Data.size() < CounterFileHeaderSize ||
+      memcmp(Data.data(), CounterFileMagic, sizeof(CounterFileMagic)) != 0) {
+    errs() << InputFile << " is not a counter file\n";
+    return -1;
+  }
+
+  // The file is in the byte order of the program that wrote it, which is
+  // told by the version field
+  const char *Ptr = Data.data() + sizeof(CounterFileMagic);
+  support::endianness Endian = support::little;
+  if (support::endian::read32le(Ptr) != CounterFileVersion) {
+    Endian = support::big;
+    if (support::endian::read32be(Ptr) != CounterFileVersion) {
+      errs() << InputFile << ": unsupported counter file version\n";
+      return -1;
+    }
+  }
+  auto Read32 = [&](const char *&P) {
+    uint32_t V = support::endian::read32(P, Endian);
+    P += 4;
+    return V;
+  };
+  auto Read64 = [&](const char *&P) {
+    uint64_t V = support::endian::read64(P, Endian);
+    P += 8;
+    return V;
+  };
+
+  Ptr += 4;
+  uint64_t NumRows = Read32(Ptr);
+  uint64_t NumCounters = Read64(Ptr);
+  uint64_t RowSize = Read64(Ptr);
+  uint64_t NamesOffset = Read64(Ptr);
+  uint64_t NamesSize = Read64(Ptr);
+
+  // Check the sizes without overflowing
+  uint64_t MaxCounters = (Data.size() - CounterFileHeaderSize) / 8;
+  if (RowSize < NumCounters || (RowSize && NumRows > MaxCounters / RowSize) ||
+      NamesOffset < CounterFileHeaderSize + NumRows * RowSize * 8 ||
+      NamesOffset > Data.size() || NamesSize > Data.size() - NamesOffset) {
+    errs() << InputFile << ": corrupt counter file header\n";
+    return -1;
+  }
+
+  SmallVector<StringRef, 64> Names;
+  Data.substr(NamesOffset, NamesSize)
+      .split(Names, '\0', -1, /*KeepEmpty=*/true);
+  // The last name is followed by a NUL too
+  if (Names.size() != NumCounters + 1 || !Names.back().empty()) {
+    errs() << InputFile << ": expected " << NumCounters
+           << " function names\n";
+    return -1;
+  }
+
+  // The calls of a function are the sum of its counters in all rows
+  std::vector<std::pair<StringRef, uint64_t>> Counts;
+  for (uint64_t Idx = 0; Idx < NumCounters; Idx++) {
+    uint64_t Calls = 0;
+    for (uint64_t Row = 0; Row < NumRows; Row++) {
+      const char *P = Data.data() + CounterFileHeaderSize +
+                      (Row * RowSize + Idx) * 8;
+      Calls += Read64(P);
+    }
+    if (!NonZero || Calls)
+      Counts.emplace_back(Names[Idx], Calls);
+  }
+  if (SortByCount)
+    std::stable_sort(Counts.begin(), Counts.end(),
+                     [](const std::pair<StringRef, uint64_t> &A,
+                        const std::pair<StringRef, uint64_t> &B) {
+                       return A.second > B.second;
+                     });
+
+  // The header and lines of printf_wrapper
+  outs() << "=================================================\n";
+  outs() << "LLVM-TUTOR: dynamic analysis results\n";
+  outs() << "=================================================\n";
+  outs() << "NAME                 #N DIRECT CALLS\n";
+  outs() << "-------------------------------------------------\n";
+  for (const auto &Count : Counts)
+    outs() << format("%-20s %-10lu\n", Count.first.str().c_str(),
+                     (unsigned long)Count.second);
+  return 0;
+}
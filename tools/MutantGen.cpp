@@ -0,0 +1,483 @@
+//========================================================================
+// FILE:
+//    MutantGen.cpp
+//
+// DESCRIPTION:
+//    A multithreaded mutant generator. It produces the same mutants as the
+//    batch mode of InjectFuncCall (see InjectFuncCall.cpp), but outside of
+//    `opt` and on all cores:
+//      * every worker thread has its own LLVMContext and parses its own copy
+//        of the input module (from a buffer that is read from disk once),
+//      * the mutants are split into one range per worker; a worker that runs
+//        out of work steals mutants from the ranges of the others,
+//      * for every mutant a worker locates the point, applies the mutation,
+//        verifies the function, serializes the module to memory and rolls
+//        the mutation back (MutationTransaction),
+//      * the serialized mutants are handed to a writer thread through a
+//        bounded lock-free queue (BoundedQueue.h), so file IO overlaps with
+//        parsing and mutating.
+//
+//    Mutant K is drawn from MutantRNG(seed, first-index + K) exactly as in
+//    InjectFuncCall, so both produce identical mutants for the same seed,
+//    whatever the number of threads.
+//
+//    With a program index (-index, see ProgramIndex.h) the mutants are drawn
+//    from all modules of a program. The modules are then processed one after
+//    the other, and only the modules that at least one mutant is in are read.
+//
+// USAGE:
+//    # N mutants from random points of a (text or binary) point file
+//      <BUILD/DIR>/bin/fast-mutgen <bitcode-file> -points=fast_mutate.txt
+//        -n=<N> -o=<dir> [-j=<threads>] [-seed=<seed>]
+//    # one mutant per entry of a batch list
+//      <BUILD/DIR>/bin/fast-mutgen <bitcode-file> -batch-list=<list-file>
+//        -o=<dir> [-j=<threads>]
+//    # higher-order mutants: every k consecutive draws (or entries of the
+//    # batch list) form one mutant, as with -fast-order in InjectFuncCall
+//      <BUILD/DIR>/bin/fast-mutgen <bitcode-file> -n=<N> -order=<k> -o=<dir>
+//    # N mutants from random points of a whole program
+//      <BUILD/DIR>/bin/fast-mutgen -index=<dir>/index.txt -n=<N> -o=<dir>
+//
+// License: MIT
+//========================================================================
+#include "BoundedQueue.h"
+#include "MutantRNG.h"
+#include "MutationOperators.h"
+#include "MutationPoint.h"
+#include "MutationTransaction.h"
+#include "ProgramIndex.h"
+
+#include "llvm/ADT/SmallPtrSet.h"
+#include "llvm/ADT/SmallString.h"
+#include "llvm/Bitcode/BitcodeWriter.h"
+#include "llvm/IR/LLVMContext.h"
+#include "llvm/IR/Verifier.h"
+#include "llvm/IRReader/IRReader.h"
+#include "llvm/Support/CommandLine.h"
+#include "llvm/Support/FileSystem.h"
+#include "llvm/Support/ManagedStatic.h"
+#include "llvm/Support/MemoryBuffer.h"
+#include "llvm/Support/Path.h"
+#include "llvm/Support/SourceMgr.h"
+#include "llvm/Support/raw_ostream.h"
+
+#include <algorithm>
+#include <atomic>
+#include <mutex>
+#include <numeric>
+#include <random>
+#include <thread>
+#include <vector>
+
+using namespace llvm;
+
+//===----------------------------------------------------------------------===//
+// Command line options
+//===----------------------------------------------------------------------===//
+static cl::OptionCategory MutGenCategory{"mutant generator options"};
+
+static cl::opt<std::string> InputModule{cl::Positional,
+                                        cl::desc{"<Module to mutate>"},
+                                        cl::value_desc{"bitcode filename"},
+                                        cl::init(""), cl::cat{MutGenCategory}};
+
+static cl::opt<std::string> PointFile{
+    "points", cl::desc{"The mutation point file to pick points from"},
+    cl::value_desc{"filename"}, cl::init("fast_mutate.txt"),
+    cl::cat{MutGenCategory}};
+
+static cl::opt<std::string> IndexFile{
+    "index",
+    cl::desc{"The program index to pick points from, instead of a module and "
+             "its point file"},
+    cl::value_desc{"filename"}, cl::init(""), cl::cat{MutGenCategory}};
+
+static cl::opt<std::string> BatchList{
+    "batch-list",
+    cl::desc{"Generate one mutant per (point, operator) entry of this file"},
+    cl::value_desc{"filename"}, cl::init(""), cl::cat{MutGenCategory}};
+
+static cl::opt<unsigned> NumMutants{
+    "n", cl::desc{"Generate this many mutants from random points"},
+    cl::value_desc{"N"}, cl::init(0), cl::cat{MutGenCategory}};
+
+static cl::opt<std::string> OutputDir{
+    "o", cl::desc{"The directory mutants are written to"},
+    cl::value_desc{"directory"}, cl::init("."), cl::cat{MutGenCategory}};
+
+static cl::opt<unsigned> NumThreads{
+    "j", cl::desc{"Number of worker threads (0: one per core)"},
+    cl::value_desc{"N"}, cl::init(0), cl::cat{MutGenCategory}};
+
+static cl::opt<unsigned> QueueSize{
+    "queue-size",
+    cl::desc{"Number of serialized mutants that may wait for the writer"},
+    cl::value_desc{"N"}, cl::init(64), cl::cat{MutGenCategory}};
+
+static cl::opt<unsigned long long> Seed{
+    "seed",
+    cl::desc{"The campaign seed (a fresh one is drawn and printed if not "
+             "given)"},
+    cl::value_desc{"seed"}, cl::init(0), cl::cat{MutGenCategory}};
+
+static cl::opt<unsigned long long> FirstIndex{
+    "first-index", cl::desc{"The index of the first mutant in the campaign"},
+    cl::value_desc{"k"}, cl::init(0), cl::cat{MutGenCategory}};
+
+static cl::opt<unsigned> Order{
+    "order",
+    cl::desc{"Apply this many mutations per mutant (higher-order mutants)"},
+    cl::value_desc{"k"}, cl::init(1), cl::cat{MutGenCategory}};
+
+static cl::opt<bool> Verify{"verify",
+                            cl::desc{"Verify every mutated function"},
+                            cl::init(true), cl::cat{MutGenCategory}};
+
+//===----------------------------------------------------------------------===//
+// Work distribution
+//
+// Mutants [0, N) are split into one contiguous range per worker. Taking a
+// mutant is a fetch_add on the range's cursor, whether it is done by the
+// owner or by a thief, so stealing needs neither locks nor retries.
+//===----------------------------------------------------------------------===//
+struct alignas(64) WorkRange {
+  std::atomic<uint64_t> Next{0};
+  uint64_t End = 0;
+};
+
+class WorkRanges {
+public:
+  WorkRanges(uint64_t NumItems, unsigned NumWorkers) : Ranges(NumWorkers) {
+    for (unsigned W = 0; W < NumWorkers; W++) {
+      Ranges[W].Next.store(NumItems * W / NumWorkers);
+      Ranges[W].End = NumItems * (W + 1) / NumWorkers;
+    }
+  }
+
+  // Takes the next item for worker W, from its own range first and then
+  // from the others. Returns false when all items are taken.
+  bool take(unsigned W, uint64_t &Item) {
+    for (unsigned Step = 0; Step < Ranges.size(); Step++) {
+      WorkRange &R = Ranges[(W + Step) % Ranges.size()];
+      if (R.Next.load(std::memory_order_relaxed) >= R.End)
+        continue;
+      Item = R.Next.fetch_add(1, std::memory_order_relaxed);
+      if (Item < R.End)
+        return true;
+    }
+    return false;
+  }
+
+private:
+  std::vector<WorkRange> Ranges;
+};
+
+//===----------------------------------------------------------------------===//
+// Pipeline
+//===----------------------------------------------------------------------===//
+struct SerializedMutant {
+  uint64_t K = 0;
+  std::string Log;
+  SmallVector<char, 0> Bitcode;
+};
+
+using MutantQueue = BoundedQueue<std::unique_ptr<SerializedMutant>>;
+
+struct Pipeline {
+  Pipeline(const std::vector<MutationPoint> &Jobs,
+           const std::vector<uint64_t> &MutantIDs, unsigned NumWorkers,
+           uint64_t Seed)
+      : Jobs(Jobs), MutantIDs(MutantIDs), Work(MutantIDs.size(), NumWorkers),
+        Queue(QueueSize), Seed(Seed) {}
+
+  // The points of all mutants, Order consecutive points per mutant
+  const std::vector<MutationPoint> &Jobs;
+  // The index of the mutant of every job in the campaign (minus FirstIndex)
+  const std::vector<uint64_t> &MutantIDs;
+  // Put in front of the point in the log (the module in program mode)
+  std::string LogPrefix;
+  WorkRanges Work;
+  MutantQueue Queue;
+  uint64_t Seed;
+  std::atomic<unsigned> WorkersRunning{0};
+  std::atomic<uint64_t> NumSkipped{0};
+  std::mutex ErrorLock;
+};
+
+// Stage 1-5 (parse, locate, mutate, verify, serialize) for one worker
+static void runWorker(Pipeline &P, unsigned W, MemoryBufferRef Input) {
+  LLVMContext Ctx;
+  SMDiagnostic Err;
+  std::unique_ptr<Module> M = parseIR(Input, Err, Ctx);
+  if (!M) {
+    std::lock_guard<std::mutex> Guard(P.ErrorLock);
+    Err.print("fast-mutgen", errs());
+    exit(1);
+  }
+  MutationPointIndex Index(*M);
+  LoopInfoCache Loops;
+
+  uint64_t Job;
+  while (P.Work.take(W, Job)) {
+    uint64_t K = P.MutantIDs[Job];
+    MutantPlan Plan;
+    for (size_t Idx = Job * Order;
+         Idx < std::min<size_t>((Job + 1) * Order, P.Jobs.size()); Idx++)
+      Plan.Targets.emplace_back(Index.lookup(P.Jobs[Idx]), P.Jobs[Idx]);
+
+    MutantRNG RNG(P.Seed, FirstIndex + K);
+    std::string Error;
+    if (!selectMutations(Plan, RNG, &Loops, Error)) {
+      std::lock_guard<std::mutex> Guard(P.ErrorLock);
+      errs() << "Mutant " << K << " dropped: " << Error << "\n";
+      P.NumSkipped++;
+      continue;
+    }
+
+    // The instructions may be replaced (and detached) by the mutations
+    SmallPtrSet<Function *, 4> Mutated;
+    std::string Description;
+    for (size_t Idx = 0; Idx < Plan.Sels.size(); Idx++) {
+      Mutated.insert(Plan.Targets[Idx].first->getFunction());
+      Description += (Idx ? ", " : "") +
+                     describeMutation(*Plan.Targets[Idx].first,
+                                      Plan.Sels[Idx], &Loops);
+    }
+
+    MutationTransaction Txn;
+    std::vector<std::string> Applied;
+    applyMutations(Plan, Txn, &Loops, Applied);
+    for (Function *F : Mutated)
+      if (Verify && verifyFunction(*F, &errs())) {
+        std::lock_guard<std::mutex> Guard(P.ErrorLock);
+        errs() << "Mutant " << K << " (" << Description << ") is broken\n";
+        exit(1);
+      }
+
+    auto Mutant = std::make_unique<SerializedMutant>();
+    Mutant->K = K;
+    Mutant->Log = "mutant-" + std::to_string(K) + ".bc " + P.LogPrefix;
+    for (size_t Idx = 0; Idx < Applied.size(); Idx++)
+      Mutant->Log += (Idx ? " " : "") + Applied[Idx];
+
+    // The same metadata as the batch mode of InjectFuncCall, so that both
+    // write identical bitcode
+    setMutantMetadata(*M, P.Seed, FirstIndex + K, Applied);
+    raw_svector_ostream OS(Mutant->Bitcode);
+    WriteBitcodeToFile(*M, OS);
+    eraseMutantMetadata(*M);
+    Txn.revert();
+
+    // Back-pressure: wait for the writer rather than buffer without bound
+    while (!P.Queue.push(Mutant))
+      std::this_thread::yield();
+  }
+
+  P.WorkersRunning--;
+}
+
+// Stage 6 (write)
+static void runWriter(Pipeline &P, std::vector<std::string> &Logs) {
+  std::unique_ptr<SerializedMutant> Mutant;
+  for (;;) {
+    if (!P.Queue.pop(Mutant)) {
+      if (P.WorkersRunning.load() != 0) {
+        std::this_thread::yield();
+        continue;
+      }
+      // Workers push before they finish, so once none is running one more
+      // failed pop means the queue is drained for good
+      if (!P.Queue.pop(Mutant))
+        return;
+    }
+
+    SmallString<128> MutantPath(OutputDir);
+    sys::path::append(MutantPath,
+                      "mutant-" + std::to_string(Mutant->K) + ".bc");
+    std::error_code EC;
+    raw_fd_ostream Out(MutantPath, EC, sys::fs::OF_None);
+    if (EC) {
+      std::lock_guard<std::mutex> Guard(P.ErrorLock);
+      errs() << "Failed to open " << MutantPath << "\n";
+      exit(1);
+    }
+    Out.write(Mutant->Bitcode.data(), Mutant->Bitcode.size());
+    Logs[Mutant->K] = std::move(Mutant->Log);
+    Mutant.reset();
+  }
+}
+
+// Generates the mutants Jobs of the module at ModulePath, every Order
+// consecutive jobs forming one mutant and mutant J being MutantIDs[J]. Their
+// log lines are stored in Logs. Returns false if the module cannot be read.
+static bool generateMutants(StringRef ModulePath,
+                            const std::vector<MutationPoint> &Jobs,
+                            const std::vector<uint64_t> &MutantIDs,
+                            uint64_t CampaignSeed, unsigned Workers,
+                            StringRef LogPrefix, std::vector<std::string> &Logs,
+                            uint64_t &NumSkipped) {
+  auto InputOrErr = MemoryBuffer::getFile(ModulePath);
+  if (!InputOrErr) {
+    errs() << "Error reading bitcode file: " << ModulePath << "\n";
+    return false;
+  }
+
+  if (Workers > MutantIDs.size())
+    Workers = std::max<size_t>(1, MutantIDs.size());
+
+  Pipeline P(Jobs, MutantIDs, Workers, CampaignSeed);
+  P.LogPrefix = LogPrefix.str();
+
+  P.WorkersRunning = Workers;
+  std::vector<std::thread> Threads;
+  for (unsigned W = 0; W < Workers; W++)
+    Threads.emplace_back(runWorker, std::ref(P), W,
+                         (*InputOrErr)->getMemBufferRef());
+  std::thread Writer(runWriter, std::ref(P), std::ref(Logs));
+
+  for (std::thread &T : Threads)
+    T.join();
+  Writer.join();
+
+  NumSkipped += P.NumSkipped;
+  return true;
+}
+
+// Draws NumMutants mutants from the program index and generates them, one
+// module at a time
+static bool generateProgramMutants(uint64_t CampaignSeed, unsigned Workers,
+                                   std::vector<std::string> &Logs,
+                                   uint64_t &NumSkipped) {
+  ProgramIndex Program;
+  if (!Program.load(IndexFile))
+    return false;
+  if (Program.empty()) {
+    errs() << "No mutation point in " << IndexFile << "\n";
+    return false;
+  }
+
+  std::vector<ProgramPoint> Draws =
+      drawProgramPoints(Program, CampaignSeed, FirstIndex, NumMutants);
+  Logs.resize(Draws.size());
+
+  // The mutants in every module
+  std::vector<std::vector<uint64_t>> ByModule(Program.size());
+  for (uint64_t K = 0; K < Draws.size(); K++)
+    ByModule[Draws[K].Module].push_back(K);
+
+  for (size_t Mod = 0; Mod < Program.size(); Mod++) {
+    if (ByModule[Mod].empty())
+      continue;
+
+    const ProgramModule &Module = Program[Mod];
+    MutationPointList Points;
+    if (!Points.open(Module.PointFile))
+      return false;
+    if (Points.size() != Module.NumPoints) {
+      errs() << Module.PointFile << " has " << Points.size()
+             << " points, the program index says " << Module.NumPoints
+             << "\n";
+      return false;
+    }
+
+    std::vector<MutationPoint> Jobs;
+    for (uint64_t K : ByModule[Mod]) {
+      MutationPoint Point = Points[Draws[K].Point];
+      Point.Operator = Draws[K].Operator;
+      Jobs.push_back(Point);
+    }
+    if (!generateMutants(Module.ModulePath, Jobs, ByModule[Mod], CampaignSeed,
+                         Workers, Module.ModulePath + " ", Logs, NumSkipped))
+      return false;
+  }
+  return true;
+}
+
+//===----------------------------------------------------------------------===//
+// Main driver code.
+//===----------------------------------------------------------------------===//
+int main(int Argc, char **Argv) {
+  cl::HideUnrelatedOptions(MutGenCategory);
+  cl::ParseCommandLineOptions(Argc, Argv,
+                              "Generates mutants of a module on all cores\n");
+  llvm_shutdown_obj SDO;
+
+  if (InputModule.empty() == IndexFile.empty()) {
+    errs() << "Expected either a module or -index\n";
+    return -1;
+  }
+  if (Order == 0) {
+    errs() << "-order has to be at least 1\n";
+    return -1;
+  }
+  // The points of a program are drawn one at a time, and a mutant is linked
+  // from a single mutated module
+  if (!IndexFile.empty() && Order != 1) {
+    errs() << "-order is not supported with -index\n";
+    return -1;
+  }
+
+  uint64_t CampaignSeed = Seed;
+  if (!Seed.getNumOccurrences()) {
+    std::random_device Device;
+    CampaignSeed = (uint64_t(Device()) << 32) | Device();
+  }
+
+  std::error_code EC = sys::fs::create_directories(OutputDir);
+  if (EC) {
+    errs() << "Failed to create " << OutputDir << "\n";
+    return -1;
+  }
+
+  unsigned Workers = NumThreads;
+  if (Workers == 0)
+    Workers = std::max(1u, std::thread::hardware_concurrency());
+
+  std::vector<std::string> Logs;
+  uint64_t NumSkipped = 0;
+  if (!IndexFile.empty()) {
+    if (!generateProgramMutants(CampaignSeed, Workers, Logs, NumSkipped))
+      return -1;
+  } else {
+    // The jobs, i.e. Order mutation points (and maybe operators) per mutant
+    std::vector<MutationPoint> Jobs;
+    if (!BatchList.empty()) {
+      if (!readMutationPointFile(BatchList, Jobs))
+        return -1;
+    } else {
+      MutationPointList Points;
+      if (!Points.open(PointFile))
+        return -1;
+      if (Points.empty()) {
+        errs() << "No mutation point in " << PointFile << "\n";
+        return -1;
+      }
+      // Same draws as the batch count mode of InjectFuncCall
+      Jobs = drawMutationPoints(Points, CampaignSeed, FirstIndex, NumMutants,
+                                Order);
+    }
+
+    std::vector<uint64_t> MutantIDs((Jobs.size() + Order - 1) / Order);
+    std::iota(MutantIDs.begin(), MutantIDs.end(), 0);
+    Logs.resize(MutantIDs.size());
+    if (!generateMutants(InputModule, Jobs, MutantIDs, CampaignSeed, Workers,
+                         "", Logs, NumSkipped))
+      return -1;
+  }
+
+  SmallString<128> LogPath(OutputDir);
+  sys::path::append(LogPath, "mutants.txt");
+  raw_fd_ostream Log(LogPath, EC, sys::fs::OF_None);
+  if (EC) {
+    errs() << "Failed to open " << LogPath << "\n";
+    return -1;
+  }
+  Log << "# seed " << CampaignSeed << " first-index " << FirstIndex << "\n";
+  for (const std::string &Line : Logs)
+    if (!Line.empty())
+      Log << Line << "\n";
+
+  errs() << "Generated " << Logs.size() - NumSkipped << " mutants with "
+         << Workers << " threads (seed " << CampaignSeed << ")\n";
+  return 0;
+}
@@ -0,0 +1,514 @@
+//========================================================================
+// FILE:
+//    MutantObjects.cpp
+//
+// DESCRIPTION:
+//    Builds mutant executables incrementally. A mutation changes exactly one
+//    function (a higher-order mutant a few), so instead of recompiling the
+//    whole program per mutant this tool:
+//      1. splits the input module into one part per defined function plus
+//         a data part (global variables, aliases and the functions they
+//         alias). Local symbols are given hidden external linkage first, so
+//         that the parts can refer to each other,
+//      2. compiles every part to its own object file, once, in parallel.
+//         Objects are cached by the MD5 of the part's bitcode, so unchanged
+//         functions are not even recompiled when the program changes,
+//      3. for every mutant, applies the mutations, compiles only the parts
+//         of the mutated functions, rolls the mutations back and links the
+//         new objects with the cached objects of all other parts.
+//
+//    Mutants are chosen exactly as in the batch mode of InjectFuncCall.
+//
+// USAGE:
+//      <BUILD/DIR>/bin/fast-mutobj <bitcode-file> -points=fast_mutate.txt
+//        -n=<N> -o=<dir> [-cache-dir=<dir>] [-j=<threads>]
+//        [-linker=cc] [-link-arg=<arg> ...]
+//      <BUILD/DIR>/bin/fast-mutobj <bitcode-file> -batch-list=<list-file>
+//        -o=<dir> -no-link [-order=<k>]
+//
+// License: MIT
+//========================================================================
+#include "MutantRNG.h"
+#include "MutationOperators.h"
+#include "MutationPoint.h"
+#include "MutationTransaction.h"
+
+#include "llvm/ADT/DenseMap.h"
+#include "llvm/ADT/SmallPtrSet.h"
+#include "llvm/ADT/SmallString.h"
+#include "llvm/Bitcode/BitcodeReader.h"
+#include "llvm/Bitcode/BitcodeWriter.h"
+#include "llvm/IR/LLVMContext.h"
+#include "llvm/IR/LegacyPassManager.h"
+#include "llvm/IR/Module.h"
+#include "llvm/IRReader/IRReader.h"
+#include "llvm/Support/CommandLine.h"
+#include "llvm/Support/FileSystem.h"
+#include "llvm/Support/Host.h"
+#include "llvm/Support/MD5.h"
+#include "llvm/Support/ManagedStatic.h"
+#include "llvm/Support/Path.h"
+#include "llvm/Support/Program.h"
+#include "llvm/Support/SourceMgr.h"
+#include "llvm/Support/TargetRegistry.h"
+#include "llvm/Support/TargetSelect.h"
+#include "llvm/Support/raw_ostream.h"
+#include "llvm/Target/TargetMachine.h"
+#include "llvm/Target/TargetOptions.h"
+#include "llvm/Transforms/Utils/Cloning.h"
+
+#include <algorithm>
+#include <atomic>
+#include <random>
+#include <thread>
+#include <vector>
+
+using namespace llvm;
+
+//===----------------------------------------------------------------------===//
+// Command line options
+//===----------------------------------------------------------------------===//
+static cl::OptionCategory MutObjCategory{"incremental mutant build options"};
+
+static cl::opt<std::string> InputModule{cl::Positional,
+                                        cl::desc{"<Module to mutate>"},
+                                        cl::value_desc{"bitcode filename"},
+                                        cl::Required, cl::cat{MutObjCategory}};
+
+static cl::opt<std::string> PointFile{
+    "points", cl::desc{"The mutation point file to pick points from"},
+    cl::value_desc{"filename"}, cl::init("fast_mutate.txt"),
+    cl::cat{MutObjCategory}};
+
+static cl::opt<std::string> BatchList{
+    "batch-list",
+    cl::desc{"Build one mutant per (point, operator) entry of this file"},
+    cl::value_desc{"filename"}, cl::init(""), cl::cat{MutObjCategory}};
+
+static cl::opt<unsigned> NumMutants{
+    "n", cl::desc{"Build this many mutants from random points"},
+    cl::value_desc{"N"}, cl::init(0), cl::cat{MutObjCategory}};
+
+static cl::opt<std::string> OutputDir{
+    "o", cl::desc{"The directory mutants are written to"},
+    cl::value_desc{"directory"}, cl::init("."), cl::cat{MutObjCategory}};
+
+static cl::opt<std::string> CacheDir{
+    "cache-dir",
+    cl::desc{"The directory the per-function objects are cached in"},
+    cl::value_desc{"directory"}, cl::init("fast-cache"),
+    cl::cat{MutObjCategory}};
+
+static cl::opt<unsigned> NumThreads{
+    "j", cl::desc{"Number of threads compiling the base objects (0: one per "
+                  "core)"},
+    cl::value_desc{"N"}, cl::init(0), cl::cat{MutObjCategory}};
+
+static cl::opt<unsigned long long> Seed{
+    "seed",
+    cl::desc{"The campaign seed (a fresh one is drawn and printed if not "
+             "given)"},
+    cl::value_desc{"seed"}, cl::init(0), cl::cat{MutObjCategory}};
+
+static cl::opt<unsigned long long> FirstIndex{
+    "first-index", cl::desc{"The index of the first mutant in the campaign"},
+    cl::value_desc{"k"}, cl::init(0), cl::cat{MutObjCategory}};
+
+static cl::opt<unsigned> Order{
+    "order",
+    cl::desc{"Apply this many mutations per mutant (higher-order mutants)"},
+    cl::value_desc{"k"}, cl::init(1), cl::cat{MutObjCategory}};
+
+static cl::opt<bool> NoLink{
+    "no-link",
+    cl::desc{"Only emit the objects of the mutated functions of every mutant"},
+    cl::init(false), cl::cat{MutObjCategory}};
+
+static cl::opt<std::string> Linker{
+    "linker", cl::desc{"The compiler driver used to link mutants"},
+    cl::value_desc{"program"}, cl::init("cc"), cl::cat{MutObjCategory}};
+
+static cl::list<std::string> LinkArgs{
+    "link-arg", cl::desc{"Extra argument passed to the linker"},
+    cl::value_desc{"arg"}, cl::ZeroOrMore, cl::cat{MutObjCategory}};
+
+//===----------------------------------------------------------------------===//
+// Splitting
+//===----------------------------------------------------------------------===//
+// Gives every local symbol hidden external linkage (and every unnamed one a
+// name), so that a function compiled in one object can still refer to
+// static functions and globals defined in another one
+static void externalizeLocals(Module &M) {
+  unsigned NumUnnamed = 0;
+  auto Externalize = [&](GlobalValue &GV) {
+    if (GV.isDeclaration())
+      return;
+    if (!GV.hasName())
+      GV.setName("__fast_anon." + Twine(NumUnnamed++));
+    if (GV.hasLocalLinkage()) {
+      GV.setLinkage(GlobalValue::ExternalLinkage);
+      GV.setVisibility(GlobalValue::HiddenVisibility);
+    }
+  };
+
+  for (Function &F : M)
+    Externalize(F);
+  for (GlobalVariable &GV : M.globals())
+    Externalize(GV);
+  for (GlobalAlias &GA : M.aliases())
+    Externalize(GA);
+}
+
+// Maps every definition of a module to the part it is compiled in. Part 0
+// holds the global variables, the aliases and the functions they alias (an
+// alias has to be defined next to its aliasee); every other function gets a
+// part of its own.
+class ModuleParts {
+public:
+  explicit ModuleParts(Module &M) {
+    SmallPtrSet<const GlobalValue *, 8> Aliased;
+    for (GlobalAlias &GA : M.aliases())
+      if (auto *Base = GA.getBaseObject())
+        Aliased.insert(Base);
+
+    for (Function &F : M)
+      if (!F.isDeclaration() && !F.hasAvailableExternallyLinkage() &&
+          !Aliased.count(&F))
+        PartOf[&F] = NumParts++;
+  }
+
+  unsigned size() const { return NumParts; }
+  unsigned getPart(const GlobalValue *GV) const { return PartOf.lookup(GV); }
+
+  // Clones part P of M into a new module (in the same context). Everything
+  // defined in other parts is only declared.
+  std::unique_ptr<Module> extract(const Module &M, unsigned P) const {
+    ValueToValueMapTy VMap;
+    std::unique_ptr<Module> Part =
+        CloneModule(M, VMap, [&](const GlobalValue *GV) {
+          return getPart(GV) == P;
+        });
+
+    for (GlobalObject &GO : Part->global_objects())
+      if (GO.isDeclaration())
+        GO.setComdat(nullptr);
+
+    // `llvm.global_ctors` and friends only make sense as definitions, and
+    // they live in part 0
+    if (P != 0) {
+      SmallVector<GlobalVariable *, 4> Appending;
+      for (GlobalVariable &GV : Part->globals())
+        if (GV.isDeclaration() && GV.getName().startswith("llvm."))
+          Appending.push_back(&GV);
+      for (GlobalVariable *GV : Appending)
+        GV->eraseFromParent();
+    }
+    return Part;
+  }
+
+private:
+  DenseMap<const GlobalValue *, unsigned> PartOf;
+  unsigned NumParts = 1;
+};
+
+//===----------------------------------------------------------------------===//
+// Code generation
+//===----------------------------------------------------------------------===//
+static std::unique_ptr<TargetMachine> createTargetMachine(const Module &M) {
+  std::string Triple = M.getTargetTriple();
+  if (Triple.empty())
+    Triple = sys::getDefaultTargetTriple();
+
+  std::string Error;
+  const Target *T = TargetRegistry::lookupTarget(Triple, Error);
+  if (!T) {
+    errs() << "fast-mutobj: " << Error << "\n";
+    exit(1);
+  }
+
+  TargetOptions Options;
+  return std::unique_ptr<TargetMachine>(T->createTargetMachine(
+      Triple, "generic", "", Options, Reloc::PIC_));
+}
+
+// Compiles M to the object file Path (written to a temporary file and
+// renamed, so that concurrent builds never see half-written cache entries)
+static void compileToObject(Module &M, TargetMachine &TM, StringRef Path) {
+  SmallString<128> TmpPath;
+  int FD;
+  std::error_code EC =
+      sys::fs::createUniqueFile(Path + ".tmp%%%%%%", FD, TmpPath);
+  if (EC) {
+    errs() << "Failed to create " << Path << ": " << EC.message() << "\n";
+    exit(1);
+  }
+
+  {
+    raw_fd_ostream Out(FD, /*shouldClose=*/true);
+    legacy::PassManager PM;
+    M.setDataLayout(TM.createDataLayout());
+    if (TM.addPassesToEmitFile(PM, Out, nullptr,
+                               TargetMachine::CGFT_ObjectFile)) {
+      errs() << "The target cannot emit object files\n";
+      exit(1);
+    }
+    PM.run(M);
+  }
+
+  if ((EC = sys::fs::rename(TmpPath, Path))) {
+    errs() << "Failed to write " << Path << ": " << EC.message() << "\n";
+    exit(1);
+  }
+}
+
+// The cache path for a part whose bitcode is Bitcode
+static std::string getCachePath(StringRef Bitcode) {
+  MD5 Hash;
+  Hash.update(Bitcode);
+  MD5::MD5Result Result;
+  Hash.final(Result);
+
+  SmallString<128> Path(CacheDir);
+  sys::path::append(Path, Result.digest().str() + ".o");
+  return Path.str().str();
+}
+
+// Compiles all parts of M that are not in the cache yet and returns the
+// object of every part
+static std::vector<std::string> buildBaseObjects(const Module &M,
+                                                 const ModuleParts &Parts) {
+  std::vector<std::string> Objects(Parts.size());
+  // Parts that have to be compiled: (part, bitcode)
+  std::vector<std::pair<unsigned, SmallVector<char, 0>>> Missing;
+
+  for (unsigned P = 0; P < Parts.size(); P++) {
+    SmallVector<char, 0> Bitcode;
+    raw_svector_ostream OS(Bitcode);
+    WriteBitcodeToFile(*Parts.extract(M, P), OS);
+
+    Objects[P] = getCachePath(StringRef(Bitcode.data(), Bitcode.size()));
+    if (!sys::fs::exists(Objects[P]))
+      Missing.emplace_back(P, std::move(Bitcode));
+  }
+
+  // A context cannot be shared between threads, so every thread re-reads
+  // the parts it compiles into a context of its own
+  std::atomic<size_t> Next{0};
+  auto Compile = [&]() {
+    LLVMContext Ctx;
+    std::unique_ptr<TargetMachine> TM;
+    for (size_t Idx = Next++; Idx < Missing.size(); Idx = Next++) {
+      const SmallVector<char, 0> &Bitcode = Missing[Idx].second;
+      auto PartOrErr = parseBitcodeFile(
+          MemoryBufferRef(StringRef(Bitcode.data(), Bitcode.size()), ""),
+          Ctx);
+      if (!PartOrErr) {
+        errs() << toString(PartOrErr.takeError()) << "\n";
+        exit(1);
+      }
+      if (!TM)
+        TM = createTargetMachine(**PartOrErr);
+      compileToObject(**PartOrErr, *TM, Objects[Missing[Idx].first]);
+    }
+  };
+
+  unsigned Workers = NumThreads;
+  if (Workers == 0)
+    Workers = std::max(1u, std::thread::hardware_concurrency());
+  std::vector<std::thread> Threads;
+  for (unsigned W = 0; W < Workers; W++)
+    Threads.emplace_back(Compile);
+  for (std::thread &T : Threads)
+    T.join();
+
+  errs() << "Compiled " << Missing.size() << " of " << Parts.size()
+         << " base objects (" << Parts.size() - Missing.size()
+         << " cached)\n";
+  return Objects;
+}
+
+// Links the objects of all parts, i.e. the base objects with the mutated
+// parts replaced by their mutant objects
+static bool linkMutant(StringRef Output,
+                       const std::vector<std::string> &Objects) {
+  auto LinkerOrErr = sys::findProgramByName(Linker);
+  if (!LinkerOrErr) {
+    errs() << "Cannot find linker " << Linker << "\n";
+    exit(1);
+  }
+
+  // The object list goes into a response file, large programs have more
+  // functions than a command line has room for
+  std::string ResponsePath = (Output + ".rsp").str();
+  {
+    std::error_code EC;
+    raw_fd_ostream Response(ResponsePath, EC, sys::fs::OF_None);
+    if (EC) {
+      errs() << "Failed to open " << ResponsePath << "\n";
+      exit(1);
+    }
+    for (const std::string &Object : Objects)
+      Response << Object << "\n";
+  }
+
+  std::string ResponseArg = "@" + ResponsePath;
+  std::vector<StringRef> Args = {*LinkerOrErr, "-o", Output, ResponseArg};
+  for (const std::string &Arg : LinkArgs)
+    Args.push_back(Arg);
+
+  std::string Error;
+  int RC = sys::ExecuteAndWait(*LinkerOrErr, Args, None, {}, 0, 0, &Error);
+  sys::fs::remove(ResponsePath);
+  if (RC != 0) {
+    errs() << "Linking " << Output << " failed " << Error << "\n";
+    return false;
+  }
+  return true;
+}
+
+//===----------------------------------------------------------------------===//
+// Main driver code.
+//===----------------------------------------------------------------------===//
+int main(int Argc, char **Argv) {
+  cl::HideUnrelatedOptions(MutObjCategory);
+  cl::ParseCommandLineOptions(Argc, Argv,
+                              "Builds mutants by recompiling only the "
+                              "mutated function\n");
+  llvm_shutdown_obj SDO;
+
+  InitializeAllTargetInfos();
+  InitializeAllTargets();
+  InitializeAllTargetMCs();
+  InitializeAllAsmPrinters();
+
+  if (Order == 0) {
+    errs() << "-order has to be at least 1\n";
+    return -1;
+  }
+
+  uint64_t CampaignSeed = Seed;
+  if (!Seed.getNumOccurrences()) {
+    std::random_device Device;
+    CampaignSeed = (uint64_t(Device()) << 32) | Device();
+  }
+
+  std::vector<MutationPoint> Batch;
+  if (!BatchList.empty()) {
+    if (!readMutationPointFile(BatchList, Batch))
+      return -1;
+  } else {
+    MutationPointList Points;
+    if (!Points.open(PointFile))
+      return -1;
+    Batch = drawMutationPoints(Points, CampaignSeed, FirstIndex, NumMutants,
+                               Order);
+  }
+
+  LLVMContext Ctx;
+  SMDiagnostic Err;
+  std::unique_ptr<Module> M = parseIRFile(InputModule, Err, Ctx);
+  if (!M) {
+    errs() << "Error reading bitcode file: " << InputModule << "\n";
+    Err.print(Argv[0], errs());
+    return -1;
+  }
+
+  for (StringRef Dir : {StringRef(OutputDir), StringRef(CacheDir)})
+    if (std::error_code EC = sys::fs::create_directories(Dir)) {
+      errs() << "Failed to create " << Dir << "\n";
+      return -1;
+    }
+
+  // Externalizing renames nothing that has a name and does not move any
+  // instruction, so the mutation points stay valid
+  externalizeLocals(*M);
+  ModuleParts Parts(*M);
+  std::vector<std::string> Objects = buildBaseObjects(*M, Parts);
+
+  std::unique_ptr<TargetMachine> TM = createTargetMachine(*M);
+  MutationPointIndex Index(*M);
+  LoopInfoCache Loops;
+
+  SmallString<128> LogPath(OutputDir);
+  sys::path::append(LogPath, "mutants.txt");
+  std::error_code EC;
+  raw_fd_ostream Log(LogPath, EC, sys::fs::OF_None);
+  if (EC) {
+    errs() << "Failed to open " << LogPath << "\n";
+    return -1;
+  }
+  Log << "# seed " << CampaignSeed << " first-index " << FirstIndex << "\n";
+
+  // Every Order consecutive entries form one mutant
+  unsigned NumBuilt = 0;
+  for (uint64_t K = 0; K * Order < Batch.size(); K++) {
+    MutantPlan Plan;
+    for (size_t Idx = K * Order;
+         Idx < std::min<size_t>((K + 1) * Order, Batch.size()); Idx++)
+      Plan.Targets.emplace_back(Index.lookup(Batch[Idx]), Batch[Idx]);
+
+    MutantRNG RNG(CampaignSeed, FirstIndex + K);
+    std::string Error;
+    if (!selectMutations(Plan, RNG, &Loops, Error)) {
+      errs() << "Mutant " << K << " dropped: " << Error << "\n";
+      continue;
+    }
+
+    // The instructions may be replaced (and detached) by the mutations
+    std::vector<unsigned> MutatedParts;
+    for (const auto &Target : Plan.Targets)
+      MutatedParts.push_back(Parts.getPart(Target.first->getFunction()));
+    std::sort(MutatedParts.begin(), MutatedParts.end());
+    MutatedParts.erase(std::unique(MutatedParts.begin(), MutatedParts.end()),
+                       MutatedParts.end());
+
+    std::string Name = "mutant-" + std::to_string(K);
+    std::vector<std::string> MutantObjects;
+    for (size_t Idx = 0; Idx < MutatedParts.size(); Idx++) {
+      SmallString<128> ObjectPath(OutputDir);
+      sys::path::append(ObjectPath, Name +
+                                        (Idx ? "." + std::to_string(Idx) : "") +
+                                        ".o");
+      MutantObjects.push_back(ObjectPath.str().str());
+    }
+
+    // Only the parts of the mutated functions are compiled
+    std::vector<std::string> Applied;
+    {
+      MutationTransaction Txn;
+      applyMutations(Plan, Txn, &Loops, Applied);
+      std::vector<std::unique_ptr<Module>> Mutated;
+      for (unsigned P : MutatedParts) {
+        Mutated.push_back(Parts.extract(*M, P));
+        setMutantMetadata(*Mutated.back(), CampaignSeed, FirstIndex + K,
+                          Applied);
+      }
+      Txn.revert();
+      for (size_t Idx = 0; Idx < Mutated.size(); Idx++)
+        compileToObject(*Mutated[Idx], *TM, MutantObjects[Idx]);
+    }
+
+    if (!NoLink) {
+      std::vector<std::string> LinkObjects = Objects;
+      for (size_t Idx = 0; Idx < MutatedParts.size(); Idx++)
+        LinkObjects[MutatedParts[Idx]] = MutantObjects[Idx];
+
+      SmallString<128> ExePath(OutputDir);
+      sys::path::append(ExePath, Name);
+      if (!linkMutant(ExePath, LinkObjects))
+        continue;
+      for (const std::string &Object : MutantObjects)
+        sys::fs::remove(Object);
+    }
+
+    Log << Name;
+    for (const std::string &Mutation : Applied)
+      Log << " " << Mutation;
+    Log << "\n";
+    NumBuilt++;
+  }
+
+  errs() << "Built " << NumBuilt << " mutants (seed " << CampaignSeed
+         << ")\n";
+  return 0;
+}
@@ -0,0 +1,407 @@
+//========================================================================
+// FILE:
+//    MutantServer.cpp
+//
+// DESCRIPTION:
+//    A long-running mutation server. Base modules are parsed once and kept
+//    in memory together with their mutation point index, so a mutant costs
+//    a mutation, a serialization and a rollback instead of a whole `opt`
+//    run. The most recently used modules are kept in an LRU cache.
+//
+//    Requests are read one per line, from stdin or from the clients of a
+//    Unix socket:
+//    ```
+//      point  <bc|obj> <module> <point line>   e.g. point bc a.bc (0, 1, 2) 1
+//      mutant <bc|obj> <module> <k>            mutant k of the campaign
+//      quit
+//    ```
+//    where <point line> uses the syntax of point files (see MutationPoint.h)
+//    and mutant k is drawn from the point file given by -points exactly as
+//    in the batch mode of InjectFuncCall (-order points per mutant). Every
+//    request is answered with
+//    ```
+//      ok <size> <point> <operator> [<point> <operator> ...]\n
+//        <size bytes of bitcode or object>
+//      error <message>\n
+//    ```
+//    Only the mutants of `mutant` requests carry the campaign seed and index
+//    in `!fast.mutant`, the mutant of an explicit point belongs to no
+//    campaign.
+//
+// USAGE:
+//      <BUILD/DIR>/bin/fast-mutd [-points=fast_mutate.txt] [-seed=<seed>]
+//        [-order=<k>]
+//      <BUILD/DIR>/bin/fast-mutd -socket=/tmp/fast.sock [-cache-size=4]
+//
+// License: MIT
+//========================================================================
+#include "MutantRNG.h"
+#include "MutationOperators.h"
+#include "MutationPoint.h"
+#include "MutationTransaction.h"
+
+#include "llvm/ADT/SmallString.h"
+#include "llvm/ADT/StringMap.h"
+#include "llvm/Bitcode/BitcodeWriter.h"
+#include "llvm/IR/LLVMContext.h"
+#include "llvm/IR/LegacyPassManager.h"
+#include "llvm/IRReader/IRReader.h"
+#include "llvm/Support/CommandLine.h"
+#include "llvm/Support/Host.h"
+#include "llvm/Support/ManagedStatic.h"
+#include "llvm/Support/SourceMgr.h"
+#include "llvm/Support/TargetRegistry.h"
+#include "llvm/Support/TargetSelect.h"
+#include "llvm/Support/raw_ostream.h"
+#include "llvm/Target/TargetMachine.h"
+#include "llvm/Target/TargetOptions.h"
+#include "llvm/Transforms/Utils/Cloning.h"
+
+#include <list>
+#include <random>
+#include <string>
+
+#include <csignal>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+using namespace llvm;
+
+//===----------------------------------------------------------------------===//
+// Command line options
+//===----------------------------------------------------------------------===//
+static cl::OptionCategory ServerCategory{"mutation server options"};
+
+static cl::opt<std::string> SocketPath{
+    "socket",
+    cl::desc{"Listen on this Unix socket instead of serving stdin/stdout"},
+    cl::value_desc{"path"}, cl::init(""), cl::cat{ServerCategory}};
+
+static cl::opt<unsigned> CacheSize{
+    "cache-size", cl::desc{"Number of parsed base modules kept in memory"},
+    cl::value_desc{"N"}, cl::init(4), cl::cat{ServerCategory}};
+
+static cl::opt<std::string> PointFile{
+    "points", cl::desc{"The mutation point file `mutant` requests draw from"},
+    cl::value_desc{"filename"}, cl::init("fast_mutate.txt"),
+    cl::cat{ServerCategory}};
+
+static cl::opt<unsigned long long> Seed{
+    "seed",
+    cl::desc{"The campaign seed (a fresh one is drawn and printed if not "
+             "given)"},
+    cl::value_desc{"seed"}, cl::init(0), cl::cat{ServerCategory}};
+
+static cl::opt<unsigned> Order{
+    "order",
+    cl::desc{"Apply this many mutations per `mutant` (higher-order mutants)"},
+    cl::value_desc{"k"}, cl::init(1), cl::cat{ServerCategory}};
+
+//===----------------------------------------------------------------------===//
+// Module cache
+//===----------------------------------------------------------------------===//
+// A parsed base module and everything derived from it
+struct BaseModule {
+  std::unique_ptr<LLVMContext> Ctx;
+  std::unique_ptr<Module> M;
+  std::unique_ptr<MutationPointIndex> Index;
+  // Filled in as branch mutants are requested
+  LoopInfoCache Loops;
+  // Created on the first `obj` request
+  std::unique_ptr<TargetMachine> TM;
+};
+
+class ModuleCache {
+public:
+  explicit ModuleCache(unsigned Capacity) : Capacity(Capacity) {}
+
+  // Returns the module at Path, parsing it if it is not cached. Returns
+  // nullptr and sets Error if it cannot be parsed.
+  BaseModule *get(const std::string &Path, std::string &Error) {
+    auto It = Entries.find(Path);
+    if (It != Entries.end()) {
+      // Move to the front of the LRU list
+      LRU.splice(LRU.begin(), LRU, It->second);
+      return &LRU.front().second;
+    }
+
+    BaseModule Base;
+    Base.Ctx = std::make_unique<LLVMContext>();
+    SMDiagnostic Err;
+    Base.M = parseIRFile(Path, Err, *Base.Ctx);
+    if (!Base.M) {
+      Error = "cannot parse " + Path + ": " + Err.getMessage().str();
+      return nullptr;
+    }
+    Base.Index = std::make_unique<MutationPointIndex>(*Base.M);
+
+    if (LRU.size() >= Capacity) {
+      Entries.erase(LRU.back().first);
+      LRU.pop_back();
+    }
+    LRU.emplace_front(Path, std::move(Base));
+    Entries[Path] = LRU.begin();
+    return &LRU.front().second;
+  }
+
+private:
+  unsigned Capacity;
+  // Most recently used first
+  std::list<std::pair<std::string, BaseModule>> LRU;
+  StringMap<std::list<std::pair<std::string, BaseModule>>::iterator> Entries;
+};
+
+//===----------------------------------------------------------------------===//
+// Mutant generation
+//===----------------------------------------------------------------------===//
+static bool emitObject(BaseModule &Base, SmallVectorImpl<char> &Out,
+                       std::string &Error) {
+  if (!Base.TM) {
+    std::string Triple = Base.M->getTargetTriple();
+    if (Triple.empty())
+      Triple = sys::getDefaultTargetTriple();
+    const Target *T = TargetRegistry::lookupTarget(Triple, Error);
+    if (!T)
+      return false;
+    Base.TM.reset(T->createTargetMachine(Triple, "generic", "",
+                                         TargetOptions(), Reloc::PIC_));
+  }
+
+  // Code generation rewrites the IR, the resident module has to stay intact
+  std::unique_ptr<Module> Clone = CloneModule(*Base.M);
+
+  raw_svector_ostream OS(Out);
+  legacy::PassManager PM;
+  if (Base.TM->addPassesToEmitFile(PM, OS, nullptr,
+                                   TargetMachine::CGFT_ObjectFile)) {
+    Error = "the target cannot emit object files";
+    return false;
+  }
+  PM.run(*Clone);
+  return true;
+}
+
+// Applies the mutant of Points to Base, serializes it into Out and rolls the
+// mutations back. The applied mutations are stored in Applied. If IsDrawn,
+// the mutant is mutant RNG.getIndex() of the campaign and is marked as such
+// (`!fast.mutant`); a mutant of an explicit point is not. Returns false and
+// sets Error if the mutant cannot be generated.
+static bool generateMutant(BaseModule &Base, ArrayRef<MutationPoint> Points,
+                           MutantRNG &RNG, bool IsDrawn, bool Object,
+                           SmallVectorImpl<char> &Out,
+                           std::vector<std::string> &Applied,
+                           std::string &Error) {
+  MutantPlan Plan;
+  for (const MutationPoint &Point : Points)
+    Plan.Targets.emplace_back(Base.Index->lookup(Point), Point);
+  if (!selectMutations(Plan, RNG, &Base.Loops, Error))
+    return false;
+
+  MutationTransaction Txn;
+  applyMutations(Plan, Txn, &Base.Loops, Applied);
+  if (IsDrawn)
+    setMutantMetadata(*Base.M, RNG.getSeed(), RNG.getIndex(), Applied);
+
+  bool OK = true;
+  if (Object) {
+    OK = emitObject(Base, Out, Error);
+  } else {
+    raw_svector_ostream OS(Out);
+    WriteBitcodeToFile(*Base.M, OS);
+  }
+
+  eraseMutantMetadata(*Base.M);
+  Txn.revert();
+  return OK;
+}
+
+//===----------------------------------------------------------------------===//
+// Protocol
+//===----------------------------------------------------------------------===//
+class Server {
+public:
+  explicit Server(uint64_t CampaignSeed)
+      : Cache(CacheSize), CampaignSeed(CampaignSeed) {}
+
+  // Serves the requests read from InFD until `quit` or end of input.
+  // Returns false if the client asked the server to quit.
+  bool serve(int InFD, int OutFD);
+
+private:
+  void handle(StringRef Request, int OutFD);
+  void reply(int OutFD, StringRef Header, ArrayRef<char> Payload = None);
+
+  ModuleCache Cache;
+  uint64_t CampaignSeed;
+  // Loaded on the first `mutant` request
+  std::unique_ptr<MutationPointList> Points;
+};
+
+static bool writeAll(int FD, const char *Data, size_t Size) {
+  while (Size > 0) {
+    ssize_t Written = ::write(FD, Data, Size);
+    if (Written <= 0)
+      return false;
+    Data += Written;
+    Size -= Written;
+  }
+  return true;
+}
+
+void Server::reply(int OutFD, StringRef Header, ArrayRef<char> Payload) {
+  std::string Line = Header.str() + "\n";
+  writeAll(OutFD, Line.data(), Line.size());
+  writeAll(OutFD, Payload.data(), Payload.size());
+}
+
+void Server::handle(StringRef Request, int OutFD) {
+  StringRef Command, Format, ModulePath, Rest;
+  std::tie(Command, Rest) = Request.trim().split(' ');
+  std::tie(Format, Rest) = Rest.trim().split(' ');
+  std::tie(ModulePath, Rest) = Rest.trim().split(' ');
+  Rest = Rest.trim();
+
+  if ((Command != "point" && Command != "mutant") ||
+      (Format != "bc" && Format != "obj") || ModulePath.empty()) {
+    reply(OutFD, "error malformed request");
+    return;
+  }
+
+  std::vector<MutationPoint> Mutations;
+  uint64_t Index = 0;
+  if (Command == "point") {
+    MutationPoint Point;
+    if (!parseMutationPoint(Rest.str(), Point)) {
+      reply(OutFD, "error malformed point");
+      return;
+    }
+    Mutations.push_back(Point);
+  } else {
+    if (Rest.getAsInteger(10, Index)) {
+      reply(OutFD, "error malformed mutant index");
+      return;
+    }
+    if (!Points) {
+      Points = std::make_unique<MutationPointList>();
+      if (!Points->open(PointFile)) {
+        Points.reset();
+        reply(OutFD, "error cannot open " + PointFile);
+        return;
+      }
+    }
+    if (Points->empty()) {
+      reply(OutFD, "error no mutation point in " + PointFile);
+      return;
+    }
+    Mutations = drawMutationPoints(*Points, CampaignSeed, Index, 1, Order);
+  }
+
+  std::string Error;
+  BaseModule *Base = Cache.get(ModulePath.str(), Error);
+  if (!Base) {
+    reply(OutFD, "error " + Error);
+    return;
+  }
+
+  SmallVector<char, 0> Mutant;
+  std::vector<std::string> Applied;
+  MutantRNG RNG(CampaignSeed, Index);
+  if (!generateMutant(*Base, Mutations, RNG, Command == "mutant",
+                      Format == "obj", Mutant, Applied, Error)) {
+    reply(OutFD, "error " + Error);
+    return;
+  }
+
+  std::string Header = "ok " + std::to_string(Mutant.size());
+  for (const std::string &Mutation : Applied)
+    Header += " " + Mutation;
+  reply(OutFD, Header, Mutant);
+}
+
+bool Server::serve(int InFD, int OutFD) {
+  std::string Buffer;
+  char Chunk[4096];
+  for (;;) {
+    size_t EOL;
+    while ((EOL = Buffer.find('\n')) == std::string::npos) {
+      ssize_t Read = ::read(InFD, Chunk, sizeof(Chunk));
+      if (Read <= 0)
+        return true;
+      Buffer.append(Chunk, Read);
+    }
+
+    std::string Request = Buffer.substr(0, EOL);
+    Buffer.erase(0, EOL + 1);
+    if (StringRef(Request).trim() == "quit")
+      return false;
+    if (!StringRef(Request).trim().empty())
+      handle(Request, OutFD);
+  }
+}
+
+//===----------------------------------------------------------------------===//
+// Main driver code.
+//===----------------------------------------------------------------------===//
+int main(int Argc, char **Argv) {
+  cl::HideUnrelatedOptions(ServerCategory);
+  cl::ParseCommandLineOptions(Argc, Argv,
+                              "Serves mutants of resident base modules\n");
+  llvm_shutdown_obj SDO;
+
+  InitializeAllTargetInfos();
+  InitializeAllTargets();
+  InitializeAllTargetMCs();
+  InitializeAllAsmPrinters();
+
+  if (Order == 0) {
+    errs() << "-order has to be at least 1\n";
+    return -1;
+  }
+
+  uint64_t CampaignSeed = Seed;
+  if (!Seed.getNumOccurrences()) {
+    std::random_device Device;
+    CampaignSeed = (uint64_t(Device()) << 32) | Device();
+  }
+  errs() << "fast-mutd: seed " << CampaignSeed << "\n";
+
+  Server S(CampaignSeed);
+  if (SocketPath.empty()) {
+    S.serve(STDIN_FILENO, STDOUT_FILENO);
+    return 0;
+  }
+
+  // A client that disconnects early must not kill the server
+  signal(SIGPIPE, SIG_IGN);
+
+  sockaddr_un Addr = {};
+  Addr.sun_family = AF_UNIX;
+  if (SocketPath.size() >= sizeof(Addr.sun_path)) {
+    errs() << "Socket path too long: " << SocketPath << "\n";
+    return -1;
+  }
+  SocketPath.getValue().copy(Addr.sun_path, sizeof(Addr.sun_path) - 1);
+
+  int Listener = socket(AF_UNIX, SOCK_STREAM, 0);
+  unlink(SocketPath.c_str());
+  if (Listener < 0 ||
+      bind(Listener, reinterpret_cast<sockaddr *>(&Addr), sizeof(Addr)) < 0 ||
+      listen(Listener, 16) < 0) {
+    errs() << "Failed to listen on " << SocketPath << "\n";
+    return -1;
+  }
+
+  // Clients are served one at a time; the modules stay cached across them
+  for (bool Running = true; Running;) {
+    int Client = accept(Listener, nullptr, nullptr);
+    if (Client < 0)
+      continue;
+    Running = S.serve(Client, Client);
+    close(Client);
+  }
+
+  close(Listener);
+  unlink(SocketPath.c_str());
+  return 0;
+}
@@ -0,0 +1,90 @@
+//========================================================================
+// FILE:
+//    PointConvert.cpp
+//
+// DESCRIPTION:
+//    A command-line tool that converts a text mutation point file (e.g.
+//    `fast_mutate.txt`) into the binary point file format, which
+//    InjectFuncCall memory maps instead of parsing (see MutationPoint.h).
+//
+//    If the module the points belong to is given, the operator category of
+//    every point is looked up and stored as well, otherwise it is left as 0
+//    (unknown).
+//
+// USAGE:
+//      <BUILD/DIR>/bin/fast-mp-convert fast_mutate.txt -o fast_mutate.bin
+//      <BUILD/DIR>/bin/fast-mp-convert fast_mutate.txt -o fast_mutate.bin
+//        -module=<bitcode-file>
+//
+// License: MIT
+//========================================================================
+#include "MutationOperators.h"
+#include "MutationPoint.h"
+
+#include "llvm/IR/LLVMContext.h"
+#include "llvm/IRReader/IRReader.h"
+#include "llvm/Support/CommandLine.h"
+#include "llvm/Support/ManagedStatic.h"
+#include "llvm/Support/SourceMgr.h"
+#include "llvm/Support/raw_ostream.h"
+
+using namespace llvm;
+
+//===----------------------------------------------------------------------===//
+// Command line options
+//===----------------------------------------------------------------------===//
+static cl::OptionCategory ConvertCategory{"point file conversion options"};
+
+static cl::opt<std::string> InputFile{cl::Positional,
+                                      cl::desc{"<text point file>"},
+                                      cl::value_desc{"filename"},
+                                      cl::Required, cl::cat{ConvertCategory}};
+
+static cl::opt<std::string> OutputFile{"o", cl::desc{"Output binary file"},
+                                       cl::value_desc{"filename"},
+                                       cl::Required, cl::cat{ConvertCategory}};
+
+static cl::opt<std::string> ModuleFile{
+    "module", cl::desc{"The module the points belong to (fills categories)"},
+    cl::value_desc{"bitcode filename"}, cl::init(""),
+    cl::cat{ConvertCategory}};
+
+//===----------------------------------------------------------------------===//
+// Main driver code.
+//===----------------------------------------------------------------------===//
+int main(int Argc, char **Argv) {
+  cl::HideUnrelatedOptions(ConvertCategory);
+  cl::ParseCommandLineOptions(Argc, Argv,
+                              "Converts a text mutation point file into the "
+                              "binary point file format\n");
+  llvm_shutdown_obj SDO;
+
+  std::vector<MutationPoint> Points;
+  if (!readMutationPointFile(InputFile, Points))
+    return -1;
+
+  std::vector<uint32_t> Categories(Points.size(), MC_None);
+  if (!ModuleFile.empty()) {
+    SMDiagnostic Err;
+    LLVMContext Ctx;
+    std::unique_ptr<Module> M = parseIRFile(ModuleFile, Err, Ctx);
+    if (!M) {
+      errs() << "Error reading bitcode file: " << ModuleFile << "\n";
+      Err.print(Argv[0], errs());
+      return -1;
+    }
+
+    // The same categories as the point files written by StaticCallCounter
+    MutationPointIndex Index(*M);
+    LoopInfoCache Loops;
+    for (size_t Idx = 0; Idx < Points.size(); Idx++)
+      if (Instruction *Ins = Index.lookup(Points[Idx]))
+        Categories[Idx] = getMutationCategory(*Ins, &Loops);
+  }
+
+  if (!writeBinaryPointFile(OutputFile, Points, Categories))
+    return -1;
+
+  errs() << "Converted " << Points.size() << " mutation points\n";
+  return 0;
+}
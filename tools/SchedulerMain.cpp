@@ -0,0 +1,161 @@
+//========================================================================
+// FILE:
+//    SchedulerMain.cpp
+//
+// DESCRIPTION:
+//    A command-line tool that maintains the state file of the adaptive
+//    mutation scheduler (see MutationScheduler.h). It folds the outcomes of
+//    mutant runs into the state, which InjectFuncCall then uses to pick
+//    points and operators (`-fast-scheduler=<state-file>`).
+//
+//    Outcome files have one line per mutant run:
+//    ```
+//      <point> <operator> <killed|survived|timeout|crash> [<ms>]
+//    ```
+//    where <point> and <operator> are as in `mutants.txt` and <ms> is the
+//    time it took to kill the mutant.
+//
+// USAGE:
+//      <BUILD/DIR>/bin/fast-sched -state=sched.txt -record=outcomes.txt
+//      <BUILD/DIR>/bin/fast-sched -state=sched.txt -print
+//
+// License: MIT
+//========================================================================
+#include "MutationScheduler.h"
+
+#include "llvm/Support/CommandLine.h"
+#include "llvm/Support/Format.h"
+#include "llvm/Support/ManagedStatic.h"
+#include "llvm/Support/raw_ostream.h"
+
+#include <algorithm>
+#include <fstream>
+#include <regex>
+#include <string>
+#include <vector>
+
+using namespace llvm;
+
+//===----------------------------------------------------------------------===//
+// Command line options
+//===----------------------------------------------------------------------===//
+static cl::OptionCategory SchedCategory{"mutation scheduler options"};
+
+static cl::opt<std::string> StateFile{
+    "state", cl::desc{"The scheduler state file"}, cl::value_desc{"filename"},
+    cl::Required, cl::cat{SchedCategory}};
+
+static cl::list<std::string> OutcomeFiles{
+    "record", cl::desc{"Fold the outcomes in this file into the state"},
+    cl::value_desc{"filename"}, cl::ZeroOrMore, cl::cat{SchedCategory}};
+
+static cl::opt<double> Tau{
+    "tau",
+    cl::desc{"Kill time (ms) at which a killed mutant is worth 0.5"},
+    cl::value_desc{"ms"}, cl::init(100), cl::cat{SchedCategory}};
+
+static cl::opt<double> SurvivalReward{
+    "survival-reward",
+    cl::desc{"Reward of the first survival of a mutant (the n-th survival "
+             "is worth 1/n of it)"},
+    cl::value_desc{"reward"}, cl::init(0.5), cl::cat{SchedCategory}};
+
+static cl::opt<bool> Print{"print",
+                           cl::desc{"Print the points by mean reward"},
+                           cl::init(false), cl::cat{SchedCategory}};
+
+//===----------------------------------------------------------------------===//
+// Helpers
+//===----------------------------------------------------------------------===//
+static bool recordOutcomes(MutationScheduler &Scheduler, StringRef Path) {
+  static const std::regex Pattern(
+      "\\s*(\\(\\d+,\\s*\\d+,\\s*\\d+\\)|mp:\\d+)\\s+(\\d+)\\s+(\\w+)"
+      "(?:\\s+(\\S+))?\\s*");
+
+  std::ifstream File(Path.str());
+  if (!File.is_open()) {
+    errs() << "Failed to open " << Path << "\n";
+    return false;
+  }
+
+  std::string Line;
+  while (std::getline(File, Line)) {
+    if (Line.empty() || Line[0] == '#')
+      continue;
+
+    std::smatch Matches;
+    MutationPoint Point;
+    MutationScheduler::Outcome O;
+    if (!std::regex_match(Line, Matches, Pattern) ||
+        !parseMutationPoint(Matches[1], Point) ||
+        !MutationScheduler::parseOutcome(Matches[3].str(), O)) {
+      errs() << "Malformed outcome: " << Line << "\n";
+      return false;
+    }
+
+    double Millis = Matches[4].matched ? std::stod(Matches[4]) : 0;
+    if (!Scheduler.record(Point, std::stoul(Matches[2]), O, Millis))
+      return false;
+  }
+  return true;
+}
+
+static void printState(const MutationScheduler &Scheduler) {
+  // (mean reward, point key)
+  using Entry = std::pair<double, uint64_t>;
+  const auto &Stats = Scheduler.getStats();
+  std::vector<Entry> Points;
+  for (const auto &PS : Stats) {
+    const MutationScheduler::ArmStats &Total = PS.second.Total;
+    if (Total.getNumOutcomes())
+      Points.emplace_back(Total.Reward / Total.getNumOutcomes(), PS.first);
+  }
+  // Ties in point order, so that the output does not depend on the hash map
+  std::sort(Points.begin(), Points.end(), [](const Entry &A, const Entry &B) {
+    if (A.first != B.first)
+      return A.first > B.first;
+    return A.second < B.second;
+  });
+
+  outs() << "=================================================\n";
+  outs() << "point                  reward   killed survived  timeout"
+            "    crash\n";
+  outs() << "-------------------------------------------------\n";
+  for (const Entry &E : Points) {
+    const MutationScheduler::ArmStats &Total =
+        Stats.find(E.second)->second.Total;
+    std::string Point = formatPoint(MutationScheduler::getPoint(E.second));
+    outs() << format("%-20s %8.3f %8llu %8llu %8llu %8llu\n", Point.c_str(),
+                     E.first, (unsigned long long)Total.Killed,
+                     (unsigned long long)Total.Survived,
+                     (unsigned long long)Total.Timeouts,
+                     (unsigned long long)Total.Crashes);
+  }
+  outs() << "-------------------------------------------------\n\n";
+}
+
+//===----------------------------------------------------------------------===//
+// Main driver code.
+//===----------------------------------------------------------------------===//
+int main(int Argc, char **Argv) {
+  cl::HideUnrelatedOptions(SchedCategory);
+  cl::ParseCommandLineOptions(Argc, Argv,
+                              "Maintains the adaptive mutation scheduler "
+                              "state\n");
+  llvm_shutdown_obj SDO;
+
+  MutationScheduler Scheduler(MutationScheduler::UCB, Tau, SurvivalReward);
+  if (!Scheduler.load(StateFile))
+    return -1;
+
+  for (const std::string &Path : OutcomeFiles)
+    if (!recordOutcomes(Scheduler, Path))
+      return -1;
+
+  if (!OutcomeFiles.empty() && !Scheduler.save(StateFile))
+    return -1;
+
+  if (Print)
+    printState(Scheduler);
+  return 0;
+}
@@ -3,25 +3,60 @@
 //    StaticMain.cpp
 //
 // DESCRIPTION:
-//    A command-line tool that counts all static calls (i.e. calls as seen
-//    in the source code) in the input LLVM file. Internally it uses the
+//    A command-line tool that enumerates the mutation points of LLVM files
+//    and writes them as point files. Internally it uses the
 //    StaticCallCounter pass.
 //
+//    Given a single module, its points are enumerated on -j threads and
+//    written to the point file -o. Given several modules, a directory
+//    (searched recursively for .bc and .ll files) or a list file (-list),
+//    the modules are analysed on a pool of -j workers, each with its own
+//    LLVMContext and analysis manager that are reused for all the modules
+//    it takes. The results are aggregated into one report, in input order;
+//    with -o=<dir>, the points of the N-th module are written to
+//    <dir>/<N>.txt, and <dir>/index.txt indexes all of them as one program
+//    (see ProgramIndex.h).
+//
+//    Bitcode modules are loaded lazily (-lazy, the default): function bodies
+//    are only read when their window of functions is enumerated and are
+//    freed again afterwards, so neither load time nor memory grow with the
+//    size of the whole module. Textual IR is always parsed completely.
+//
 // USAGE:
 //    # First, generate an LLVM file:
 //      clang -emit-llvm <input-file> -o <output-llvm-file>
 //    # Now you can run this tool as follows:
-//      <BUILD/DIR>/bin/static <output-llvm-file>
+//      <BUILD/DIR>/bin/static <output-llvm-file> [-o fast_mutate.txt] [-j N]
+//    # With an enumeration cache, only the functions that changed since the
+//    # last run are enumerated:
+//      <BUILD/DIR>/bin/static <output-llvm-file> -cache=fast_enum.cache
+//    # Batch mode:
+//      <BUILD/DIR>/bin/static <dir-or-files...> [-list=<file>] [-j N]
+//        [-o <dir>] [-report=<file>]
 //
 // License: MIT
 //========================================================================
 #include "StaticCallCounter.h"
+#include "EnumerationCache.h"
+#include "MutationOperators.h"
+#include "ProgramIndex.h"
 
 #include "llvm/IRReader/IRReader.h"
 #include "llvm/Passes/PassBuilder.h"
+#include "llvm/Support/FileSystem.h"
+#include "llvm/Support/Format.h"
+#include "llvm/Support/ManagedStatic.h"
+#include "llvm/Support/Path.h"
 #include "llvm/Support/SourceMgr.h"
 #include "llvm/Support/raw_ostream.h"
 
+#include <algorithm>
+#include <atomic>
+#include <fstream>
+#include <string>
+#include <thread>
+#include <vector>
+
 using namespace llvm;
 
 //===----------------------------------------------------------------------===//
@@ -29,86 +64,322 @@ using namespace llvm;
 //===----------------------------------------------------------------------===//
 static cl::OptionCategory CallCounterCategory{"call counter options"};
 
-static cl::opt<std::string> InputModule{cl::Positional,
-                                        cl::desc{"<Module to analyze>"},
-                                        cl::value_desc{"bitcode filename"},
-                                        cl::init(""),
-                                        cl::Required,
-                                        cl::cat{CallCounterCategory}};
+static cl::list<std::string> InputPaths{
+    cl::Positional, cl::desc{"<Modules or directories to analyze>"},
+    cl::value_desc{"bitcode filename"}, cl::ZeroOrMore,
+    cl::cat{CallCounterCategory}};
+
+static cl::opt<std::string> InputList{
+    "list", cl::desc{"A file with more modules to analyze, one per line"},
+    cl::value_desc{"filename"}, cl::init(""), cl::cat{CallCounterCategory}};
+
+static cl::opt<std::string> OutputFile{
+    "o",
+    cl::desc{"The point file to write ('-' for stdout), or in batch mode "
+             "the directory to write one point file per module to"},
+    cl::value_desc{"filename"}, cl::init("fast_mutate.txt"),
+    cl::cat{CallCounterCategory}};
+
+static cl::opt<std::string> ReportFile{
+    "report", cl::desc{"The batch mode report ('-' for stdout)"},
+    cl::value_desc{"filename"}, cl::init("-"), cl::cat{CallCounterCategory}};
+
+static cl::opt<unsigned> NumThreads{
+    "j", cl::desc{"Number of worker threads (0: one per core)"},
+    cl::value_desc{"N"}, cl::init(0), cl::cat{CallCounterCategory}};
+
+static cl::opt<bool> LazyLoad{
+    "lazy",
+    cl::desc{"Read function bodies of bitcode modules only while they are "
+             "enumerated"},
+    cl::init(true), cl::cat{CallCounterCategory}};
+
+static cl::opt<std::string> CacheFile{
+    "cache",
+    cl::desc{"The enumeration cache to take unchanged functions from (and "
+             "to update)"},
+    cl::value_desc{"filename"}, cl::init(""), cl::cat{CallCounterCategory}};
 
 //===----------------------------------------------------------------------===//
-// StaticCountWrapper pass
-//
-// Runs StaticCallCounter and prints the result
+// Module analysis
 //===----------------------------------------------------------------------===//
-struct StaticCCWrapper : public PassInfoMixin<StaticCCWrapper> {
-  void print(llvm::raw_ostream &OutS) const;
-  ResultStaticCC DirectCalls;
-  llvm::PreservedAnalyses run(llvm::Module &M,
-                              llvm::ModuleAnalysisManager &MAM) {
-
-    DirectCalls = MAM.getResult<StaticCallCounter>(M);
-    printStaticCCResult(errs(), DirectCalls);
-    return llvm::PreservedAnalyses::all();
-  }
+// What the report says about one module
+struct ModuleSummary {
+  std::string Path;
+  // Empty if the module was analysed
+  std::string Error;
+  size_t NumFunctions = 0;
+  size_t NumPoints = 0;
+  uint64_t NumMutants = 0;
+  // Number of points per operator category
+  std::vector<uint64_t> Categories;
 };
 
-static void countStaticCalls(Module &M) {
-  // Create a module pass manager and add StaticCCWrapper to it.
-  ModulePassManager MPM;
-  StaticCCWrapper StaticWrapper;
-  MPM.addPass(StaticWrapper);
+// An LLVMContext and the analysis managers, set up once and reused for every
+// module analysed by one thread
+class ModuleAnalyzer {
+public:
+  ModuleAnalyzer(unsigned NumThreads, EnumerationCache *Cache) {
+    MAM.registerPass([=] { return StaticCallCounter(NumThreads, Cache); });
+    PB.registerModuleAnalyses(MAM);
+  }
 
-  // Create an analysis manager and register StaticCallCounter with it.
-  ModuleAnalysisManager MAM;
-  MAM.registerPass([&] { return StaticCallCounter(); });
+  // Enumerates the points of the module at Path, writes them to PointFile
+  // (unless it is empty) and fills in Summary
+  void analyze(const std::string &Path, const std::string &PointFile,
+               ModuleSummary &Summary);
 
-  // Register all available module analysis passes defined in PassRegisty.def.
-  // We only really need PassInstrumentationAnalysis (which is pulled by
-  // default by PassBuilder), but to keep this concise, let PassBuilder do all
-  // the _heavy-lifting_.
+private:
+  LLVMContext Ctx;
   PassBuilder PB;
-  PB.registerModuleAnalyses(MAM);
+  ModuleAnalysisManager MAM;
+};
+
+void ModuleAnalyzer::analyze(const std::string &Path,
+                             const std::string &PointFile,
+                             ModuleSummary &Summary) {
+  Summary.Path = Path;
+
+  SMDiagnostic Err;
+  std::unique_ptr<Module> M = LazyLoad ? getLazyIRFileModule(Path, Err, Ctx)
+                                       : parseIRFile(Path, Err, Ctx);
+  if (!M) {
+    Summary.Error = Err.getMessage().str();
+    return;
+  }
+
+  const ResultStaticCC &Points = MAM.getResult<StaticCallCounter>(*M);
+  Summary.NumFunctions = M->size();
+  Summary.NumPoints = Points.size();
+  Summary.Categories.assign(MC_SwapSelect + 1, 0);
+  for (const MutationPointRecord &Record : Points) {
+    Summary.NumMutants += Record.NumMutants;
+    if (Record.Category < Summary.Categories.size())
+      Summary.Categories[Record.Category]++;
+  }
 
-  // Finally, run the passes registered with MPM
-  MPM.run(M, MAM);
+  if (!PointFile.empty()) {
+    std::error_code EC;
+    raw_fd_ostream OutS(PointFile, EC, sys::fs::OF_Text);
+    if (EC)
+      Summary.Error = "cannot write " + PointFile + ": " + EC.message();
+    else
+      printStaticCCResult(OutS, Points);
+  }
+
+  // The results refer to the module, which is about to be freed
+  MAM.clear();
 }
 
 //===----------------------------------------------------------------------===//
-// Main driver code.
+// Batch mode
 //===----------------------------------------------------------------------===//
-int main(int Argc, char **Argv) {
+// Expands the inputs into the list of modules to analyse. Directories are
+// searched recursively for .bc and .ll files, in sorted order.
+static bool collectModules(std::vector<std::string> &Modules) {
+  std::vector<std::string> Inputs(InputPaths.begin(), InputPaths.end());
+  if (!InputList.empty()) {
+    std::ifstream List(InputList);
+    if (!List.is_open()) {
+      errs() << "Failed to open " << InputList << "\n";
+      return false;
+    }
+    std::string Line;
+    while (std::getline(List, Line))
+      if (!StringRef(Line).trim().empty())
+        Inputs.push_back(StringRef(Line).trim().str());
+  }
 
-  // errs() << "=== cyh ===\n";
-  // errs() << Argv[0] << "\n";
-  // errs() << Argv[1] << "\n";
-  // errs() << Argv[2] << "\n";
+  for (const std::string &Input : Inputs) {
+    if (!sys::fs::is_directory(Input)) {
+      Modules.push_back(Input);
+      continue;
+    }
 
+    std::vector<std::string> Found;
+    std::error_code EC;
+    for (sys::fs::recursive_directory_iterator It(Input, EC), End;
+         It != End && !EC; It.increment(EC)) {
+      StringRef Ext = sys::path::extension(It->path());
+      if ((Ext == ".bc" || Ext == ".ll") && !sys::fs::is_directory(It->path()))
+        Found.push_back(It->path());
+    }
+    if (EC) {
+      errs() << "Failed to read directory " << Input << ": " << EC.message()
+             << "\n";
+      return false;
+    }
+    std::sort(Found.begin(), Found.end());
+    Modules.insert(Modules.end(), Found.begin(), Found.end());
+  }
+  return true;
+}
+
+static void printReport(raw_ostream &OutS,
+                        const std::vector<ModuleSummary> &Summaries) {
+  ModuleSummary Total;
+  Total.Categories.assign(MC_SwapSelect + 1, 0);
+  unsigned NumErrors = 0;
+
+  OutS << "=================================================\n";
+  OutS << "LLVM-TUTOR: mutation points of " << Summaries.size()
+       << " modules\n";
+  OutS << "=================================================\n";
+  OutS << "    #FUNCS    #POINTS   #MUTANTS  MODULE\n";
+  OutS << "-------------------------------------------------\n";
+  for (const ModuleSummary &Summary : Summaries) {
+    if (!Summary.Error.empty()) {
+      OutS << "     error          -          -  " << Summary.Path << ": "
+           << Summary.Error << "\n";
+      NumErrors++;
+      continue;
+    }
+    OutS << format("%10zu %10zu %10llu  ", Summary.NumFunctions,
+                   Summary.NumPoints, (unsigned long long)Summary.NumMutants)
+         << Summary.Path << "\n";
+    Total.NumFunctions += Summary.NumFunctions;
+    Total.NumPoints += Summary.NumPoints;
+    Total.NumMutants += Summary.NumMutants;
+    for (size_t Cat = 0; Cat < Summary.Categories.size(); Cat++)
+      Total.Categories[Cat] += Summary.Categories[Cat];
+  }
+  OutS << "-------------------------------------------------\n";
+  OutS << format("%10zu %10zu %10llu  total (%u errors)\n",
+                 Total.NumFunctions, Total.NumPoints,
+                 (unsigned long long)Total.NumMutants, NumErrors);
+
+  OutS << "\n";
+  OutS << "  CATEGORY    #POINTS\n";
+  OutS << "-------------------------------------------------\n";
+  for (size_t Cat = 0; Cat < Total.Categories.size(); Cat++)
+    if (Total.Categories[Cat])
+      OutS << format("%10zu %10llu\n", Cat,
+                     (unsigned long long)Total.Categories[Cat]);
+}
+
+// Analyses Modules on a pool of threads. Returns false if any of them
+// could not be analysed.
+static bool runBatch(const std::vector<std::string> &Modules,
+                     EnumerationCache *Cache) {
+  std::string PointDir;
+  if (OutputFile.getNumOccurrences()) {
+    PointDir = OutputFile;
+    if (std::error_code EC = sys::fs::create_directories(PointDir)) {
+      errs() << "Failed to create " << PointDir << ": " << EC.message()
+             << "\n";
+      return false;
+    }
+  }
+
+  std::vector<ModuleSummary> Summaries(Modules.size());
+  std::atomic<size_t> NextModule{0};
+  auto Worker = [&]() {
+    // One module per thread at a time: the functions of a module are not
+    // split further
+    ModuleAnalyzer Analyzer(/*NumThreads=*/1, Cache);
+    for (size_t Idx; (Idx = NextModule++) < Modules.size();) {
+      std::string PointFile;
+      if (!PointDir.empty()) {
+        SmallString<128> Path(PointDir);
+        sys::path::append(Path, std::to_string(Idx) + ".txt");
+        PointFile = Path.str().str();
+      }
+      Analyzer.analyze(Modules[Idx], PointFile, Summaries[Idx]);
+    }
+  };
+
+  unsigned Threads = NumThreads;
+  if (Threads == 0)
+    Threads = std::max(1u, std::thread::hardware_concurrency());
+  Threads = std::max<size_t>(1, std::min<size_t>(Threads, Modules.size()));
+  std::vector<std::thread> Pool;
+  for (unsigned T = 1; T < Threads; T++)
+    Pool.emplace_back(Worker);
+  Worker();
+  for (std::thread &T : Pool)
+    T.join();
+
+  std::error_code EC;
+  raw_fd_ostream Report(ReportFile, EC, sys::fs::OF_Text);
+  if (EC) {
+    errs() << "Failed to open " << ReportFile << ": " << EC.message() << "\n";
+    return false;
+  }
+  printReport(Report, Summaries);
+
+  // Modules that could not be analysed are left out of the program
+  if (!PointDir.empty()) {
+    ProgramIndex Program;
+    for (size_t Idx = 0; Idx < Modules.size(); Idx++) {
+      if (!Summaries[Idx].Error.empty())
+        continue;
+      SmallString<128> ModulePath(Modules[Idx]);
+      sys::fs::make_absolute(ModulePath);
+      Program.addModule(ModulePath, std::to_string(Idx) + ".txt",
+                        Summaries[Idx].NumPoints);
+    }
+    SmallString<128> IndexPath(PointDir);
+    sys::path::append(IndexPath, "index.txt");
+    if (!Program.save(IndexPath))
+      return false;
+  }
+
+  return std::all_of(
+      Summaries.begin(), Summaries.end(),
+      [](const ModuleSummary &Summary) { return Summary.Error.empty(); });
+}
+
+//===----------------------------------------------------------------------===//
+// Main driver code.
+//===----------------------------------------------------------------------===//
+int main(int Argc, char **Argv) {
   // Hide all options apart from the ones specific to this tool
-  // TODO: 猜测这一行是用来决定命令行参数的数量的
-  cl::HideUnrelatedOptions(CallCounterCategory); 
+  cl::HideUnrelatedOptions(CallCounterCategory);
 
   cl::ParseCommandLineOptions(Argc, Argv,
-                              "Counts the number of static function "
-                              "calls in the input IR file\n");
+                              "Enumerates the mutation points of the "
+                              "input IR files\n");
 
   // Makes sure llvm_shutdown() is called (which cleans up LLVM objects)
   //  http://llvm.org/docs/ProgrammersManual.html#ending-execution-with-llvm-shutdown
   llvm_shutdown_obj SDO;
 
-  // Parse the IR file passed on the command line.
-  SMDiagnostic Err;
-  LLVMContext Ctx;
-  std::unique_ptr<Module> M = parseIRFile(InputModule.getValue(), Err, Ctx);
-
-  if (!M) {
-    errs() << "Error reading bitcode file: " << InputModule << "\n";
-    Err.print(Argv[0], errs());
+  std::vector<std::string> Modules;
+  if (!collectModules(Modules))
+    return -1;
+  if (Modules.empty()) {
+    errs() << "No module to analyze\n";
     return -1;
   }
 
-  // Run the analysis and print the results
-  countStaticCalls(*M);
+  EnumerationCache Cache;
+  if (!CacheFile.empty() && !Cache.load(CacheFile))
+    return -1;
+  EnumerationCache *CachePtr = CacheFile.empty() ? nullptr : &Cache;
 
-  return 0;
+  int Status = 0;
+  bool Batch = Modules.size() > 1 || !InputList.empty() ||
+               sys::fs::is_directory(InputPaths.front());
+  if (Batch) {
+    if (!runBatch(Modules, CachePtr))
+      Status = -1;
+  } else {
+    // A single module: its functions are enumerated on all threads
+    ModuleAnalyzer Analyzer(NumThreads, CachePtr);
+    ModuleSummary Summary;
+    Analyzer.analyze(Modules.front(), OutputFile, Summary);
+    if (!Summary.Error.empty()) {
+      errs() << Modules.front() << ": " << Summary.Error << "\n";
+      return -1;
+    }
+    errs() << "Enumerated " << Summary.NumPoints << " mutation points\n";
+  }
+
+  if (CachePtr) {
+    errs() << "Enumeration cache: " << Cache.getNumHits() << " hits, "
+           << Cache.getNumMisses() << " misses\n";
+    if (!Cache.save(CacheFile))
+      return -1;
+  }
+  return Status;
 }